@@ -0,0 +1,686 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "log.h"
+#include "os.h"
+#include "string.h"
+#include "hash.h"
+#include "inflate.h"
+#include "zstd.h"
+#include "archive.h"
+
+#define MODULE "Archive"
+
+#define ARCHIVE_NAME_MAX        256
+#define ARCHIVE_ROM_MAX         (16 * 1024 * 1024)  //far bigger than any iNES ROM, a bigger size is a damaged file
+
+#define ARCHIVE_GZIP_MAGIC      0x8B1F
+#define ARCHIVE_ZIP_LOCAL       0x04034B50
+#define ARCHIVE_ZIP_CENTRAL     0x02014B50
+#define ARCHIVE_ZIP_END         0x06054B50
+
+//a ROM in an archive, data points into the archive
+typedef struct {
+    char name[ARCHIVE_NAME_MAX];            //empty for gzip and zstd files
+    archive_method_t method;
+    const uint8_t *data;
+    size_t compressed_size;
+    size_t size;
+    uint32_t crc32;
+    bool has_crc32;                         //zstd files only have a checksum this doesn't check
+} archive_member_t;
+
+//returns false to stop listing
+typedef bool (*archive_member_func_t)(const archive_member_t *member, void *data);
+
+typedef struct {
+    const char *name;
+    archive_member_t member;
+    bool found;
+} archive_find_t;
+
+typedef struct {
+    FILE *f;
+    uint64_t offset;                        //where the next ROM goes
+    archive_pack_entry_t *entries;
+    char **names;
+    int count;
+    int capacity;
+    const char *file;                       //being added
+    bool success;
+} archive_writer_t;
+
+static uint32_t
+archive_get16(const uint8_t *in) {
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t
+archive_get32(const uint8_t *in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static bool
+archive_is_rom_name(const char *name) {
+    const char *extension;
+    int i;
+
+    extension = strrchr(name, '.');
+    if (extension == NULL || strlen(extension) != 4) {
+        return false;
+    }
+
+    for (i = 0; i < 4; i++) {
+        if (tolower((unsigned char)extension[i]) != ".nes"[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+archive_is_archive(const uint8_t *data, size_t size) {
+    if (size < 4) {
+        return false;
+    }
+
+    return archive_get16(data) == ARCHIVE_GZIP_MAGIC || archive_get32(data) == ARCHIVE_ZIP_LOCAL ||
+           archive_get32(data) == ARCHIVE_ZIP_END || archive_get32(data) == ZSTD_MAGIC || archive_get32(data) == ARCHIVE_PACK_MAGIC;
+}
+
+static bool
+archive_list_gzip(const uint8_t *data, size_t size, archive_member_func_t func, void *user) {
+    archive_member_t member;
+    size_t p;
+    int flags;
+
+    memset(&member, 0, sizeof(member));
+
+    //the header, then optional fields flags says are there
+    if (size < 18 || data[2] != 8) {
+        log_err(MODULE, "Not a deflated gzip file");
+        return false;
+    }
+
+    flags = data[3];
+    p = 10;
+    if (flags & 0x04) {
+        p += 2 + (p + 2 <= size ? archive_get16(data + p) : 0);
+    }
+    if (flags & 0x08) {
+        for (; p < size && data[p] != '\0'; p++);
+        p++;
+    }
+    if (flags & 0x10) {
+        for (; p < size && data[p] != '\0'; p++);
+        p++;
+    }
+    if (flags & 0x02) {
+        p += 2;
+    }
+
+    //followed by the CRC and size of what it decompresses to
+    if (p + 8 > size) {
+        log_err(MODULE, "gzip file is truncated");
+        return false;
+    }
+
+    member.method = ARCHIVE_METHOD_DEFLATE;
+    member.data = data + p;
+    member.compressed_size = size - p - 8;
+    member.crc32 = archive_get32(data + size - 8);
+    member.size = archive_get32(data + size - 4);
+    member.has_crc32 = true;
+
+    func(&member, user);
+
+    return true;
+}
+
+static bool
+archive_list_zstd(const uint8_t *data, size_t size, archive_member_func_t func, void *user) {
+    archive_member_t member;
+
+    memset(&member, 0, sizeof(member));
+
+    if (!zstd_get_size(data, size, &member.size)) {
+        log_err(MODULE, "zstd file is damaged or doesn't record its size");
+        return false;
+    }
+
+    member.method = ARCHIVE_METHOD_ZSTD;
+    member.data = data;
+    member.compressed_size = size;
+
+    func(&member, user);
+
+    return true;
+}
+
+static bool
+archive_list_zip(const uint8_t *data, size_t size, archive_member_func_t func, void *user) {
+    archive_member_t member;
+    const uint8_t *entry, *local;
+    size_t end, p, name_size, offset;
+    int entries, method, i;
+
+    //the end of the central directory is the last thing in the file, only a comment can follow it
+    if (size < 22) {
+        log_err(MODULE, "zip file is truncated");
+        return false;
+    }
+    for (end = size - 22; end > 0 && archive_get32(data + end) != ARCHIVE_ZIP_END && size - end < 0xFFFF + 22; end--);
+    if (archive_get32(data + end) != ARCHIVE_ZIP_END) {
+        log_err(MODULE, "zip file has no central directory");
+        return false;
+    }
+
+    entries = archive_get16(data + end + 10);
+    p = archive_get32(data + end + 16);
+
+    for (i = 0; i < entries; i++) {
+        if (p + 46 > size || archive_get32(data + p) != ARCHIVE_ZIP_CENTRAL) {
+            log_err(MODULE, "zip central directory is damaged");
+            return false;
+        }
+
+        entry = data + p;
+        name_size = archive_get16(entry + 28);
+        p += 46 + name_size + archive_get16(entry + 30) + archive_get16(entry + 32);
+        if (p > size) {
+            log_err(MODULE, "zip central directory is damaged");
+            return false;
+        }
+
+        memset(&member, 0, sizeof(member));
+        strlcpy(member.name, (const char *)entry + 46, name_size + 1 < sizeof(member.name) ? name_size + 1 : sizeof(member.name));
+        if (!archive_is_rom_name(member.name)) {
+            continue;
+        }
+
+        method = archive_get16(entry + 10);
+        if ((archive_get16(entry + 8) & 0x01) || (method != 0 && method != 8)) {
+            log_warn(MODULE, "Skipping '%s', it's encrypted or compressed with method %d", member.name, method);
+            continue;
+        }
+
+        //the data follows the local header, which can have its own extra field
+        offset = archive_get32(entry + 42);
+        if (offset + 30 > size || archive_get32(data + offset) != ARCHIVE_ZIP_LOCAL) {
+            log_err(MODULE, "zip entry '%s' is damaged", member.name);
+            return false;
+        }
+        local = data + offset;
+        offset += 30 + archive_get16(local + 26) + archive_get16(local + 28);
+
+        member.method = method == 8 ? ARCHIVE_METHOD_DEFLATE : ARCHIVE_METHOD_STORED;
+        member.compressed_size = archive_get32(entry + 20);
+        member.size = archive_get32(entry + 24);
+        member.crc32 = archive_get32(entry + 16);
+        member.has_crc32 = true;
+        if (offset > size || member.compressed_size > size - offset) {
+            log_err(MODULE, "zip entry '%s' is damaged", member.name);
+            return false;
+        }
+        member.data = data + offset;
+
+        if (!func(&member, user)) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+//the entries of a pack, false if they're not all inside it
+static const archive_pack_entry_t *
+archive_get_pack_entries(const uint8_t *data, size_t size, const archive_pack_header_t **header) {
+    const archive_pack_entry_t *entries;
+    uint32_t i;
+
+    *header = (const archive_pack_header_t *)data;
+    if (size < sizeof(archive_pack_header_t) || (*header)->version != ARCHIVE_PACK_VERSION || (*header)->index > size ||
+        (*header)->index % sizeof(uint64_t) != 0 ||
+        (size - (*header)->index) / sizeof(archive_pack_entry_t) < (*header)->count ||
+        size - (*header)->index - (uint64_t)(*header)->count * sizeof(archive_pack_entry_t) != (*header)->names_size ||
+        ((*header)->names_size > 0 && data[size - 1] != '\0')) {
+        log_err(MODULE, "Pack is damaged");
+        return NULL;
+    }
+
+    entries = (const archive_pack_entry_t *)(data + (*header)->index);
+    for (i = 0; i < (*header)->count; i++) {
+        if (entries[i].offset > (*header)->index || entries[i].compressed_size > (*header)->index - entries[i].offset ||
+            entries[i].name >= (*header)->names_size || entries[i].method > ARCHIVE_METHOD_ZSTD) {
+            log_err(MODULE, "Pack is damaged");
+            return NULL;
+        }
+    }
+
+    return entries;
+}
+
+static void
+archive_get_pack_member(const uint8_t *data, const archive_pack_header_t *header, const archive_pack_entry_t *entry, archive_member_t *member) {
+    const char *names;
+
+    names = (const char *)(data + header->index + header->count * sizeof(archive_pack_entry_t));
+
+    memset(member, 0, sizeof(*member));
+    strlcpy(member->name, names + entry->name, sizeof(member->name));
+    member->method = entry->method;
+    member->data = data + entry->offset;
+    member->compressed_size = entry->compressed_size;
+    member->size = entry->size;
+    member->crc32 = entry->crc32;
+    member->has_crc32 = true;
+}
+
+static bool
+archive_list_pack(const uint8_t *data, size_t size, archive_member_func_t func, void *user) {
+    const archive_pack_header_t *header;
+    const archive_pack_entry_t *entries;
+    archive_member_t member;
+    uint32_t i;
+
+    entries = archive_get_pack_entries(data, size, &header);
+    if (entries == NULL) {
+        return false;
+    }
+
+    for (i = 0; i < header->count; i++) {
+        archive_get_pack_member(data, header, &entries[i], &member);
+        if (!func(&member, user)) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+//calls func with every ROM in data, a bare ROM is one that's stored
+static bool
+archive_list(const uint8_t *data, size_t size, archive_member_func_t func, void *user) {
+    archive_member_t member;
+
+    if (size >= 4 && archive_get16(data) == ARCHIVE_GZIP_MAGIC) {
+        return archive_list_gzip(data, size, func, user);
+    }
+    if (size >= 4 && archive_get32(data) == ZSTD_MAGIC) {
+        return archive_list_zstd(data, size, func, user);
+    }
+    if (size >= 4 && (archive_get32(data) == ARCHIVE_ZIP_LOCAL || archive_get32(data) == ARCHIVE_ZIP_END)) {
+        return archive_list_zip(data, size, func, user);
+    }
+    if (size >= 4 && archive_get32(data) == ARCHIVE_PACK_MAGIC) {
+        return archive_list_pack(data, size, func, user);
+    }
+
+    memset(&member, 0, sizeof(member));
+    member.method = ARCHIVE_METHOD_STORED;
+    member.data = data;
+    member.compressed_size = size;
+    member.size = size;
+
+    func(&member, user);
+
+    return true;
+}
+
+//decompresses a ROM into out, which is member->size bytes
+static bool
+archive_decode(const archive_member_t *member, uint8_t *out) {
+    bool success;
+
+    switch (member->method) {
+        case ARCHIVE_METHOD_STORED:
+            success = member->compressed_size == member->size;
+            if (success) {
+                memcpy(out, member->data, member->size);
+            }
+            break;
+        case ARCHIVE_METHOD_DEFLATE:
+            success = inflate_decode(member->data, member->compressed_size, out, member->size, NULL);
+            break;
+        default:
+            success = zstd_decode(member->data, member->compressed_size, out, member->size);
+            break;
+    }
+
+    if (!success || (member->has_crc32 && hash_crc32(0, out, member->size) != member->crc32)) {
+        log_err(MODULE, "ROM '%s' is damaged", member->name);
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+archive_find_member(const archive_member_t *member, void *data) {
+    archive_find_t *find = data;
+    const char *base;
+
+    base = strrchr(member->name, '/');
+    base = base != NULL ? base + 1 : member->name;
+
+    if (find->name == NULL || strcmp(member->name, find->name) == 0 || strcmp(base, find->name) == 0) {
+        find->member = *member;
+        find->found = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool
+archive_extract(const uint8_t *data, size_t size, const char *name, uint8_t **image, size_t *image_size) {
+    const archive_pack_header_t *header;
+    const archive_pack_entry_t *entries;
+    archive_find_t find;
+    const char *names;
+    uint32_t low, high, middle;
+    int compare;
+
+    memset(&find, 0, sizeof(find));
+    find.name = name;
+
+    //a pack's entries are sorted, so a name is looked up without listing the rest
+    if (name != NULL && size >= 4 && archive_get32(data) == ARCHIVE_PACK_MAGIC) {
+        entries = archive_get_pack_entries(data, size, &header);
+        if (entries == NULL) {
+            return false;
+        }
+
+        names = (const char *)(entries + header->count);
+        low = 0;
+        high = header->count;
+        while (low < high && !find.found) {
+            middle = low + (high - low) / 2;
+            compare = strcmp(name, names + entries[middle].name);
+            if (compare == 0) {
+                archive_get_pack_member(data, header, &entries[middle], &find.member);
+                find.found = true;
+            }
+            else if (compare < 0) {
+                high = middle;
+            }
+            else {
+                low = middle + 1;
+            }
+        }
+    }
+    else if (!archive_list(data, size, archive_find_member, &find)) {
+        return false;
+    }
+
+    if (!find.found) {
+        log_err(MODULE, name != NULL ? "No ROM called '%s' in the archive" : "No ROM in the archive", name);
+        return false;
+    }
+
+    if (find.member.size == 0 || find.member.size > ARCHIVE_ROM_MAX) {
+        log_err(MODULE, "ROM '%s' can't be %zu bytes", find.member.name, find.member.size);
+        return false;
+    }
+
+    *image = malloc(find.member.size);
+    if (*image == NULL) {
+        log_err(MODULE, "Failed to allocate %zu bytes for ROM '%s'", find.member.size, find.member.name);
+        return false;
+    }
+
+    if (!archive_decode(&find.member, *image)) {
+        free(*image);
+        *image = NULL;
+        return false;
+    }
+
+    *image_size = find.member.size;
+
+    return true;
+}
+
+//copies a ROM into the pack once it's checked to decompress to one
+static bool
+archive_add_member(const archive_member_t *member, void *data) {
+    archive_writer_t *writer = data;
+    archive_pack_entry_t *entries;
+    archive_member_t checked;
+    const char *base;
+    uint8_t *image;
+    char **names;
+    char name[ARCHIVE_NAME_MAX];
+    size_t length;
+    int capacity;
+
+    //zip and pack entries keep their name without a directory, a gzip or zstd file is named after itself
+    if (member->name[0] != '\0') {
+        base = strrchr(member->name, '/');
+        strlcpy(name, base != NULL ? base + 1 : member->name, sizeof(name));
+    }
+    else {
+        base = strrchr(writer->file, '/');
+        strlcpy(name, base != NULL ? base + 1 : writer->file, sizeof(name));
+        length = strlen(name);
+        if (member->method == ARCHIVE_METHOD_DEFLATE && length > 3 && strcmp(name + length - 3, ".gz") == 0) {
+            name[length - 3] = '\0';
+        }
+        else if (member->method == ARCHIVE_METHOD_ZSTD && length > 4 && strcmp(name + length - 4, ".zst") == 0) {
+            name[length - 4] = '\0';
+        }
+    }
+
+    checked = *member;
+    strlcpy(checked.name, name, sizeof(checked.name));
+
+    if (member->size < 4 || member->size > ARCHIVE_ROM_MAX || member->compressed_size > UINT32_MAX) {
+        log_warn(MODULE, "Skipping '%s', it can't be a ROM", name);
+        return true;
+    }
+
+    image = malloc(member->size);
+    if (image == NULL) {
+        log_err(MODULE, "Failed to allocate %zu bytes for ROM '%s'", member->size, name);
+        writer->success = false;
+        return false;
+    }
+
+    if (!archive_decode(&checked, image) || memcmp(image, "NES\x1A", 4) != 0) {
+        log_warn(MODULE, "Skipping '%s', it isn't an iNES ROM", name);
+        free(image);
+        return true;
+    }
+
+    if (!checked.has_crc32) {
+        checked.crc32 = hash_crc32(0, image, checked.size);
+    }
+    free(image);
+
+    if (writer->count == writer->capacity) {
+        capacity = writer->capacity > 0 ? writer->capacity * 2 : 64;
+        entries = realloc(writer->entries, capacity * sizeof(archive_pack_entry_t));
+        if (entries != NULL) {
+            writer->entries = entries;
+        }
+        names = realloc(writer->names, capacity * sizeof(char *));
+        if (names != NULL) {
+            writer->names = names;
+        }
+        if (entries == NULL || names == NULL) {
+            log_err(MODULE, "Out of memory");
+            writer->success = false;
+            return false;
+        }
+        writer->capacity = capacity;
+    }
+
+    writer->names[writer->count] = malloc(strlen(name) + 1);
+    if (writer->names[writer->count] == NULL) {
+        log_err(MODULE, "Out of memory");
+        writer->success = false;
+        return false;
+    }
+    strlcpy(writer->names[writer->count], name, strlen(name) + 1);
+
+    memset(&writer->entries[writer->count], 0, sizeof(archive_pack_entry_t));
+    writer->entries[writer->count].offset = writer->offset;
+    writer->entries[writer->count].compressed_size = (uint32_t)checked.compressed_size;
+    writer->entries[writer->count].size = (uint32_t)checked.size;
+    writer->entries[writer->count].crc32 = checked.crc32;
+    writer->entries[writer->count].method = checked.method;
+    writer->count++;
+
+    if (fwrite(checked.data, 1, checked.compressed_size, writer->f) != checked.compressed_size) {
+        log_err(MODULE, "Failed to write ROM '%s': %s", name, strerror(errno));
+        writer->success = false;
+        return false;
+    }
+    writer->offset += checked.compressed_size;
+
+    return true;
+}
+
+//sorts entries by name through an array of their indices
+static archive_writer_t *archive_sorting;
+
+static int
+archive_compare_entries(const void *a, const void *b) {
+    int compare;
+
+    compare = strcmp(archive_sorting->names[*(const int *)a], archive_sorting->names[*(const int *)b]);
+
+    //the first of two ROMs with the same name wins
+    return compare != 0 ? compare : *(const int *)a - *(const int *)b;
+}
+
+static bool
+archive_write_index(archive_writer_t *writer, archive_pack_header_t *header) {
+    archive_pack_entry_t entry;
+    uint32_t names_size;
+    int *order, i, count, previous;
+
+    order = malloc((writer->count > 0 ? writer->count : 1) * sizeof(int));
+    if (order == NULL) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+
+    for (i = 0; i < writer->count; i++) {
+        order[i] = i;
+    }
+    archive_sorting = writer;
+    qsort(order, writer->count, sizeof(int), archive_compare_entries);
+
+    //the entries, then the names in the same order
+    count = 0;
+    names_size = 0;
+    previous = -1;
+    for (i = 0; i < writer->count; i++) {
+        if (previous != -1 && strcmp(writer->names[order[i]], writer->names[previous]) == 0) {
+            log_warn(MODULE, "Skipping a second ROM called '%s'", writer->names[order[i]]);
+            order[i] = -1;
+            continue;
+        }
+        previous = order[i];
+
+        entry = writer->entries[order[i]];
+        entry.name = names_size;
+        names_size += strlen(writer->names[order[i]]) + 1;
+        if (fwrite(&entry, sizeof(entry), 1, writer->f) != 1) {
+            free(order);
+            return false;
+        }
+        count++;
+    }
+
+    for (i = 0; i < writer->count; i++) {
+        if (order[i] != -1 && fwrite(writer->names[order[i]], strlen(writer->names[order[i]]) + 1, 1, writer->f) != 1) {
+            free(order);
+            return false;
+        }
+    }
+
+    free(order);
+
+    header->index = writer->offset;
+    header->count = count;
+    header->names_size = names_size;
+
+    return true;
+}
+
+bool
+archive_write_pack(const char *path, const char **files, int count) {
+    archive_pack_header_t header;
+    archive_writer_t writer;
+    const uint8_t *data;
+    char temp_path[ARCHIVE_NAME_MAX + 8];
+    size_t size;
+    int i;
+
+    memset(&writer, 0, sizeof(writer));
+    memset(&header, 0, sizeof(header));
+    header.magic = ARCHIVE_PACK_MAGIC;
+    header.version = ARCHIVE_PACK_VERSION;
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    writer.f = fopen(temp_path, "wb");
+    if (writer.f == NULL) {
+        log_err(MODULE, "Failed to open '%s': %s", temp_path, strerror(errno));
+        return false;
+    }
+
+    //the header is written again once the index is
+    writer.success = fwrite(&header, sizeof(header), 1, writer.f) == 1;
+    writer.offset = sizeof(header);
+
+    for (i = 0; writer.success && i < count; i++) {
+        data = os_map_file(files[i], &size);
+        if (data == NULL) {
+            log_warn(MODULE, "Skipping '%s': %s", files[i], strerror(errno));
+            continue;
+        }
+
+        writer.file = files[i];
+        if (!archive_list(data, size, archive_add_member, &writer)) {
+            log_warn(MODULE, "Skipping '%s'", files[i]);
+        }
+
+        os_unmap_file(data, size);
+    }
+
+    //the entries are read in place, so they're aligned
+    for (; writer.success && writer.offset % sizeof(uint64_t) != 0; writer.offset++) {
+        writer.success = fputc(0, writer.f) != EOF;
+    }
+
+    writer.success = writer.success && archive_write_index(&writer, &header) && fseek(writer.f, 0, SEEK_SET) == 0 &&
+                     fwrite(&header, sizeof(header), 1, writer.f) == 1;
+    writer.success = fclose(writer.f) == 0 && writer.success;
+
+    for (i = 0; i < writer.count; i++) {
+        free(writer.names[i]);
+    }
+    free(writer.names);
+    free(writer.entries);
+
+    if (!writer.success) {
+        log_err(MODULE, "Failed to write '%s'", temp_path);
+        remove(temp_path);
+        return false;
+    }
+
+    if (!os_replace_file(temp_path, path)) {
+        log_err(MODULE, "Failed to replace '%s': %s", path, strerror(errno));
+        remove(temp_path);
+        return false;
+    }
+
+    log_info(MODULE, "Packed %u ROMs into '%s'", header.count, path);
+
+    return true;
+}
\ No newline at end of file
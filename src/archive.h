@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARCHIVE_PACK_MAGIC      0x5053454E  //"NESP"
+#define ARCHIVE_PACK_VERSION    1
+
+//how a ROM is compressed in a pack
+typedef enum {
+    ARCHIVE_METHOD_STORED,
+    ARCHIVE_METHOD_DEFLATE,
+    ARCHIVE_METHOD_ZSTD
+} archive_method_t;
+
+//a pack is an archive_pack_header_t, the compressed ROMs, then at index, aligned to 8 bytes, the entries sorted by name
+//followed by their names, each with a terminator. like a library index it's read straight from the mapping, so it's in
+//the byte order of the host that wrote it and a ROM is found without reading any other
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t names_size;
+    uint64_t index;                         //offset of the entries
+} archive_pack_header_t;
+
+typedef struct {
+    uint64_t offset;                        //of the compressed ROM
+    uint32_t compressed_size;
+    uint32_t size;
+    uint32_t crc32;                         //of the ROM once it's decompressed
+    uint32_t name;                          //offset of the name in the names
+    uint8_t method;
+    uint8_t reserved[7];
+} archive_pack_entry_t;
+
+//whether data is a gzip, zip, zstd or pack file rather than a bare ROM
+bool archive_is_archive(const uint8_t *data, size_t size);
+
+//decompresses the ROM called name in an archive into a buffer it allocates for it, the first ROM in the archive if name
+//is NULL. a name matches a zip entry with or without its directory
+bool archive_extract(const uint8_t *data, size_t size, const char *name, uint8_t **image, size_t *image_size);
+
+//writes a pack of the ROMs in files, which can be bare, gzip or zstd compressed, or zips or packs of them. ROMs that are
+//already compressed are copied in as they are
+bool archive_write_pack(const char *path, const char **files, int count);
\ No newline at end of file
@@ -0,0 +1,622 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "log.h"
+#include "hash.h"
+#include "zstd.h"
+#include "archive.h"
+#include "archive_test.h"
+
+#define MODULE "ARCT"
+
+#define ARCHIVE_TEST_SIZE           4096
+#define ARCHIVE_TEST_CRC32          0xA54DBA02
+#define ARCHIVE_TEST_GZIP_HEADER    (10 + sizeof("test.nes"))   //the fixed fields, then the name
+#define ARCHIVE_TEST_DAMAGED        500                         //damaged copies of every sample
+#define ARCHIVE_TEST_SAMPLES        7
+
+typedef struct {
+    const char *name;
+    const uint8_t *data;
+    size_t size;
+    const char *rom;                        //the ROM to extract, NULL for the first one
+    bool checked;                           //the format has a CRC, a damaged copy either fails or still decodes to the ROM
+} archive_test_sample_t;
+
+typedef struct {
+    uint8_t rom[ARCHIVE_TEST_SIZE];         //what every sample decompresses to
+    uint8_t *stored;                        //gzip of stored deflate blocks
+    size_t stored_size;
+    uint8_t *blocks;                        //zstd frame of raw and RLE blocks
+    size_t blocks_size;
+    uint8_t *pack;
+    size_t pack_size;
+    archive_test_sample_t samples[ARCHIVE_TEST_SAMPLES];
+    uint32_t seed;
+} archive_test_t;
+
+static archive_test_t archive_test;
+
+//the samples were made from the ROM archive_test_build_rom() makes, by gzip, python's zipfile and zstd
+//gzip -9 with the name in its header, dynamic Huffman blocks
+static const uint8_t archive_test_gzip[] = {
+    0x1F, 0x8B, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x74, 0x65, 0x73, 0x74, 0x2E, 0x6E,
+    0x65, 0x73, 0x00, 0x85, 0x97, 0x59, 0x43, 0x1A, 0x31, 0x14, 0x85, 0x33, 0x74, 0x06, 0x06, 0x59,
+    0x05, 0x59, 0xA5, 0x02, 0x6A, 0xB1, 0xE2, 0x52, 0xC0, 0x16, 0x5B, 0x87, 0xC2, 0x93, 0xAF, 0x7D,
+    0xE9, 0xFF, 0xFF, 0x2F, 0xB5, 0x9A, 0xEF, 0x02, 0x07, 0x06, 0xCE, 0x4B, 0x48, 0x26, 0xB9, 0xCB,
+    0xB9, 0x4B, 0xC2, 0x9F, 0xD7, 0xBF, 0xDD, 0x20, 0x70, 0x86, 0x5E, 0x2D, 0xDB, 0x98, 0xCE, 0x2B,
+    0xAD, 0x9B, 0x51, 0xAE, 0x33, 0x8E, 0x17, 0x9D, 0xF0, 0x6C, 0xFE, 0xBB, 0xBF, 0xE8, 0x0D, 0x73,
+    0x7C, 0x78, 0xFC, 0xF4, 0xB3, 0x54, 0x7A, 0x59, 0x8E, 0xCA, 0xFD, 0x4E, 0xA7, 0xD2, 0x5F, 0xCD,
+    0x59, 0xEF, 0x5E, 0x67, 0xCB, 0xBD, 0xDB, 0x87, 0x72, 0x99, 0x03, 0xE1, 0xB8, 0x59, 0x4F, 0x6A,
+    0xD1, 0xB0, 0xDD, 0x8E, 0xAA, 0x51, 0xBE, 0x57, 0x2F, 0x35, 0x38, 0x72, 0xB5, 0x81, 0xA7, 0x37,
+    0xB0, 0xBE, 0x38, 0x6B, 0x7C, 0x7B, 0x7E, 0xFC, 0x72, 0x3E, 0x4E, 0xE2, 0x4E, 0xAD, 0x5E, 0xFB,
+    0x9C, 0x5D, 0x06, 0x77, 0x85, 0xE4, 0x32, 0x41, 0xE2, 0xFC, 0x1D, 0x58, 0x56, 0x40, 0x23, 0xDB,
+    0xE3, 0x55, 0x73, 0x38, 0x19, 0x24, 0x95, 0x69, 0xE8, 0xF8, 0xC5, 0xDE, 0xCC, 0x6D, 0x3A, 0x66,
+    0xA0, 0x74, 0x00, 0x29, 0x67, 0xF3, 0xB3, 0xE0, 0xE2, 0x7E, 0x16, 0x4F, 0xBB, 0x99, 0x5F, 0xED,
+    0xE2, 0x55, 0x77, 0x8E, 0x27, 0xAA, 0x1F, 0x0A, 0x30, 0x15, 0xD3, 0xF1, 0x8C, 0xFD, 0xC8, 0x31,
+    0x06, 0xFA, 0xE3, 0x1F, 0x99, 0x6C, 0xBD, 0xCD, 0x5C, 0xF5, 0x31, 0x27, 0x08, 0x4F, 0xDB, 0x80,
+    0x40, 0x46, 0x8E, 0xA1, 0x8E, 0xE3, 0xC1, 0x6A, 0x7A, 0xD1, 0x9C, 0x55, 0xCC, 0x0C, 0xE6, 0x98,
+    0x4F, 0xCC, 0x31, 0x47, 0xCD, 0x34, 0xF3, 0x3D, 0x46, 0x6B, 0x7C, 0xD0, 0xA7, 0x06, 0xE0, 0xFF,
+    0xD7, 0x43, 0xB0, 0xBC, 0x41, 0xFC, 0x64, 0x13, 0x24, 0x0B, 0xA2, 0xC9, 0x36, 0x42, 0x80, 0xCD,
+    0x48, 0x69, 0x1D, 0x01, 0xE7, 0x43, 0xB4, 0x29, 0x19, 0x38, 0x6F, 0x25, 0xA2, 0x2C, 0xA2, 0x09,
+    0x0B, 0x38, 0xA8, 0x73, 0xCB, 0x5B, 0xAF, 0x11, 0x4B, 0x95, 0x4D, 0x46, 0xF5, 0x04, 0x43, 0xF2,
+    0x08, 0xC2, 0x80, 0x9D, 0x2C, 0xF2, 0x0A, 0xA0, 0x4A, 0xB3, 0xC6, 0x11, 0x5F, 0x2C, 0xC3, 0xB3,
+    0xE7, 0x34, 0xA0, 0x41, 0x5D, 0x45, 0x72, 0x55, 0xA3, 0xB0, 0x41, 0xF0, 0xE0, 0x30, 0xAC, 0x78,
+    0xB1, 0x96, 0xDA, 0x40, 0x14, 0xF4, 0x30, 0x46, 0x40, 0xB3, 0x18, 0xAF, 0x62, 0x88, 0x53, 0xFF,
+    0x51, 0x85, 0x64, 0xF5, 0x42, 0xB3, 0x94, 0xF9, 0x70, 0x07, 0xD7, 0x06, 0xEB, 0x5D, 0x9E, 0x00,
+    0x74, 0xB8, 0xB4, 0xA6, 0x06, 0xD7, 0x50, 0xA9, 0x59, 0x71, 0xB9, 0x0D, 0x97, 0x0A, 0x6B, 0x2E,
+    0xF8, 0x5D, 0x84, 0x39, 0xC7, 0x17, 0x6C, 0x60, 0x0C, 0xF0, 0xD8, 0xEA, 0xD2, 0x2B, 0xD7, 0x14,
+    0x3D, 0xD1, 0x1E, 0xAB, 0x0D, 0x49, 0x53, 0x4E, 0xAB, 0x12, 0x9B, 0x18, 0xD9, 0xDF, 0x13, 0x78,
+    0x32, 0x38, 0x76, 0x82, 0x0B, 0xE8, 0x27, 0x94, 0xEF, 0x9B, 0xB5, 0x1D, 0xA9, 0x11, 0x7C, 0xCF,
+    0x6F, 0xA9, 0xB0, 0xF2, 0xA1, 0x29, 0xD2, 0xCC, 0xA4, 0x17, 0x6B, 0x59, 0xB2, 0xAE, 0xE7, 0x71,
+    0x29, 0x32, 0x9F, 0xA9, 0x4B, 0x9F, 0x8F, 0xAC, 0x5B, 0x2A, 0x20, 0x99, 0xD1, 0x55, 0xD1, 0xA1,
+    0x95, 0xA9, 0x37, 0x1F, 0xEB, 0xCB, 0x37, 0x68, 0xD5, 0x13, 0xB3, 0x3A, 0x42, 0x8A, 0x5A, 0xFF,
+    0xCC, 0x9D, 0x8A, 0x43, 0x8D, 0x75, 0x20, 0xA9, 0x5E, 0xE6, 0x4A, 0x15, 0xD1, 0x0F, 0x33, 0x7C,
+    0x41, 0x52, 0x75, 0x3F, 0xEC, 0xDE, 0xE2, 0x91, 0x20, 0x0A, 0xBE, 0x83, 0x58, 0xAF, 0x2C, 0x58,
+    0xD7, 0x26, 0xAB, 0xC5, 0xDE, 0x8C, 0xD6, 0x38, 0x96, 0x8C, 0x98, 0xCF, 0x1C, 0xD9, 0x37, 0x7B,
+    0xA0, 0x7B, 0x3F, 0x56, 0x95, 0x7B, 0x88, 0x7D, 0xF1, 0xC8, 0xA5, 0x41, 0x7B, 0xB8, 0x26, 0x1B,
+    0x6A, 0x30, 0x3D, 0x3C, 0xDD, 0xC4, 0xF9, 0x7E, 0xE4, 0x77, 0x80, 0x5D, 0xCA, 0x12, 0xBC, 0xC7,
+    0x18, 0xBC, 0x38, 0x88, 0x53, 0xEB, 0x24, 0x08, 0xB0, 0x78, 0xFB, 0xF1, 0x25, 0x1D, 0x6C, 0x31,
+    0x55, 0xDE, 0x25, 0xBD, 0xAD, 0x6A, 0x82, 0x00, 0xCA, 0xB7, 0xAF, 0x1E, 0x82, 0xDA, 0x39, 0x0C,
+    0x4D, 0x71, 0x88, 0x75, 0x1A, 0x7C, 0x22, 0x61, 0x0D, 0x5A, 0x1B, 0xB0, 0x36, 0xCD, 0x2A, 0xE4,
+    0xE5, 0xB4, 0xAD, 0x92, 0x5F, 0x2E, 0x4D, 0xB9, 0x46, 0xF9, 0x6E, 0x07, 0x4A, 0x16, 0x3B, 0xF5,
+    0xC2, 0xCD, 0x27, 0x0A, 0xFC, 0xD2, 0x36, 0x96, 0xC1, 0xAA, 0x18, 0xD9, 0x24, 0x03, 0xD6, 0x68,
+    0xFA, 0x6B, 0x83, 0x8B, 0xED, 0x5E, 0x14, 0xD1, 0xDA, 0xF0, 0x34, 0xBB, 0x5C, 0x19, 0x51, 0xF4,
+    0x75, 0xBD, 0xBB, 0x51, 0xA1, 0x6F, 0x2B, 0xDD, 0xC7, 0xF7, 0xFF, 0x7D, 0x8F, 0x33, 0x93, 0x23,
+    0xC0, 0x8A, 0x64, 0x3F, 0xEC, 0x09, 0xEE, 0xF3, 0xA9, 0xB4, 0x3C, 0x02, 0x7D, 0x1D, 0xD8, 0x83,
+    0x13, 0x5B, 0x69, 0x92, 0x7E, 0x9D, 0xFD, 0x56, 0x8C, 0xCA, 0xB7, 0xFE, 0x63, 0x42, 0xB0, 0xB7,
+    0x3F, 0xD4, 0x1E, 0xA0, 0x77, 0x20, 0xF1, 0x0A, 0x35, 0x39, 0xD8, 0x58, 0x48, 0xFB, 0x1B, 0x32,
+    0x38, 0x0E, 0x8B, 0x98, 0x37, 0xBA, 0xA5, 0x0D, 0x18, 0x59, 0xEB, 0xBF, 0x79, 0x42, 0xE8, 0x68,
+    0x1B, 0xE6, 0xAD, 0x5C, 0x71, 0x6D, 0x00, 0x6F, 0x7B, 0x5A, 0x88, 0xD6, 0xAC, 0xBE, 0xED, 0x03,
+    0x84, 0x9F, 0xA7, 0x02, 0x3F, 0x6A, 0x5A, 0xB4, 0xF7, 0x6B, 0x20, 0xC5, 0x5E, 0x00, 0xFA, 0xB8,
+    0xF1, 0xBC, 0x3E, 0x6C, 0xC0, 0xE9, 0x13, 0x6A, 0x71, 0x14, 0x2A, 0x5E, 0x6F, 0xE1, 0x92, 0xBE,
+    0x34, 0x42, 0x17, 0x09, 0xB4, 0xE3, 0xC4, 0xB8, 0xC7, 0x51, 0x0A, 0x46, 0x2F, 0xDC, 0x61, 0x1A,
+    0xFE, 0x01, 0x02, 0xBA, 0x4D, 0xA5, 0x00, 0x10, 0x00, 0x00
+};
+
+//fixed Huffman blocks and no name
+static const uint8_t archive_test_gzip_fixed[] = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xF3, 0x73, 0x0D, 0x96, 0x62, 0x64,
+    0x64, 0x80, 0x03, 0x19, 0x21, 0x36, 0x51, 0x43, 0x33, 0x7E, 0x71, 0x75, 0x35, 0x76, 0x49, 0x2D,
+    0x0E, 0x1B, 0x49, 0x16, 0x11, 0x33, 0x5B, 0x79, 0x1B, 0x19, 0x45, 0x76, 0x98, 0x84, 0x1E, 0xB3,
+    0x05, 0x2F, 0xAF, 0x95, 0x9D, 0x1A, 0x9F, 0xBC, 0xA4, 0x24, 0xBF, 0xBC, 0xBD, 0x19, 0x4C, 0x5C,
+    0x4A, 0x85, 0x8D, 0x4F, 0x46, 0x53, 0x97, 0x8F, 0x0F, 0xA6, 0x81, 0x45, 0x4B, 0x4C, 0xD8, 0x5A,
+    0x88, 0x55, 0x51, 0x42, 0x82, 0x55, 0x80, 0x95, 0x53, 0x46, 0x98, 0x57, 0x14, 0xA6, 0x45, 0x19,
+    0x09, 0x18, 0x03, 0x01, 0x4C, 0xDC, 0x46, 0x44, 0x54, 0xDF, 0x5C, 0x4F, 0x55, 0x5A, 0xCB, 0x9A,
+    0x43, 0x52, 0x48, 0x58, 0x48, 0x96, 0xCD, 0x8E, 0x51, 0x9B, 0xDB, 0x5A, 0xC9, 0x1A, 0x66, 0xA2,
+    0x19, 0x18, 0xC0, 0x5C, 0xC6, 0x0D, 0xB3, 0x11, 0xA6, 0x9C, 0xC3, 0x5E, 0x4C, 0xD1, 0x40, 0xC1,
+    0x9A, 0xDF, 0x90, 0x85, 0x01, 0xC6, 0x82, 0xA9, 0x65, 0xD2, 0xC4, 0x0D, 0x8C, 0x60, 0x80, 0x17,
+    0x0F, 0xC0, 0xA1, 0x97, 0xD3, 0x88, 0x51, 0x4E, 0xC7, 0x88, 0xC3, 0x50, 0x8A, 0xC9, 0x52, 0x82,
+    0x47, 0x59, 0xCA, 0x0C, 0xE6, 0x13, 0x74, 0xFB, 0x61, 0x41, 0x00, 0x73, 0x2A, 0xCC, 0xE9, 0x30,
+    0x9F, 0xC1, 0xD4, 0xC3, 0xCC, 0x81, 0x87, 0x80, 0xBC, 0x96, 0x29, 0x13, 0x9B, 0xB0, 0x04, 0x8C,
+    0x8F, 0x6E, 0x1F, 0x8C, 0x0F, 0x8B, 0x04, 0x63, 0x54, 0x00, 0x0B, 0x40, 0x18, 0x0D, 0xD3, 0x06,
+    0xB3, 0x0E, 0xA6, 0x9D, 0xD1, 0xDE, 0x50, 0x4E, 0xCC, 0x88, 0x1F, 0xEE, 0x0C, 0x18, 0x1F, 0xE6,
+    0x7C, 0x58, 0x9C, 0xC3, 0x9C, 0x83, 0xEE, 0x4C, 0xB8, 0xF3, 0xA1, 0x40, 0x0D, 0x01, 0x20, 0xC1,
+    0x87, 0xEE, 0x00, 0x98, 0xFF, 0x35, 0xF0, 0x01, 0x78, 0xBA, 0x81, 0x19, 0x6F, 0x80, 0x0C, 0x60,
+    0x89, 0x05, 0x66, 0x34, 0x2C, 0xB5, 0xC1, 0xA2, 0x00, 0xE6, 0x66, 0x98, 0x29, 0xE2, 0x04, 0x00,
+    0x4C, 0x3F, 0x0B, 0xCC, 0x36, 0xF4, 0xC0, 0x80, 0x79, 0x1E, 0x9E, 0x45, 0xD0, 0x43, 0x11, 0x66,
+    0x13, 0xCC, 0x05, 0x30, 0x8D, 0xE8, 0x7C, 0x78, 0xBA, 0x85, 0xDA, 0x08, 0x73, 0x29, 0x7A, 0x68,
+    0xC2, 0x68, 0x74, 0x9F, 0xC0, 0x1C, 0xC2, 0x09, 0x33, 0x08, 0xE6, 0x00, 0x8C, 0x54, 0x04, 0xB5,
+    0x00, 0x16, 0x54, 0xE8, 0xA9, 0x86, 0x01, 0x16, 0xBF, 0x30, 0x97, 0xC1, 0x7C, 0x66, 0x8E, 0x0B,
+    0xC0, 0x6C, 0x40, 0xF7, 0x2A, 0xCC, 0x64, 0x01, 0xF4, 0x58, 0x40, 0x0A, 0x60, 0x05, 0xFC, 0x00,
+    0x9E, 0x79, 0x61, 0xAE, 0x85, 0xE5, 0x0D, 0x98, 0x51, 0xB0, 0xE0, 0x81, 0xD1, 0xAC, 0x30, 0x80,
+    0x9E, 0x8A, 0x61, 0xBE, 0xE2, 0x80, 0x05, 0x1C, 0xBA, 0xFF, 0x61, 0x56, 0xC1, 0x4C, 0x46, 0xF7,
+    0x05, 0x7A, 0x2A, 0x85, 0xF1, 0x15, 0x31, 0x80, 0x0A, 0x1C, 0xC0, 0xCB, 0x2E, 0x68, 0x00, 0xC0,
+    0xEC, 0x60, 0xC0, 0x55, 0xA8, 0xC1, 0xC2, 0x1A, 0x16, 0x94, 0xE8, 0xA9, 0x42, 0x09, 0x15, 0x30,
+    0xE0, 0x04, 0xF0, 0xC2, 0x05, 0xE6, 0x6F, 0x1E, 0x58, 0xC8, 0x31, 0xC0, 0x64, 0x60, 0x6E, 0x80,
+    0xD1, 0x8C, 0x30, 0x1F, 0xC3, 0xF3, 0x25, 0xD4, 0x72, 0xF4, 0x24, 0xCA, 0x85, 0x5E, 0xC6, 0xA2,
+    0x17, 0x48, 0xE8, 0x49, 0x0E, 0x3D, 0x57, 0xC2, 0xDC, 0x04, 0xA3, 0x61, 0xEA, 0x65, 0xD0, 0x00,
+    0x34, 0x30, 0x60, 0xDA, 0xB8, 0x60, 0x5E, 0x80, 0xD9, 0x0F, 0x8B, 0x4A, 0xB0, 0x62, 0xF4, 0xE2,
+    0x08, 0xDD, 0x11, 0x30, 0x79, 0x4E, 0x14, 0x2B, 0xE0, 0xD9, 0x07, 0x56, 0x28, 0xC2, 0x0A, 0x33,
+    0xB4, 0xB2, 0x18, 0x3D, 0x5B, 0xC2, 0xC4, 0xD1, 0xF5, 0xC3, 0xBC, 0xC4, 0x0A, 0xF7, 0x33, 0x2C,
+    0x5F, 0x42, 0xD3, 0x23, 0x4C, 0x1C, 0x9E, 0x14, 0x60, 0x26, 0xC3, 0x68, 0x06, 0x01, 0x98, 0x1D,
+    0xE8, 0x39, 0x13, 0xBD, 0xE6, 0x83, 0x89, 0xDB, 0x01, 0x01, 0x7A, 0xAE, 0x87, 0xC5, 0x99, 0x30,
+    0xCC, 0x10, 0x1E, 0xF4, 0xFC, 0x0F, 0xE3, 0x33, 0xA0, 0x1B, 0x07, 0xB3, 0x06, 0x5E, 0x02, 0xA1,
+    0xE5, 0x5E, 0x18, 0x1F, 0x3D, 0xA8, 0x60, 0xB1, 0xCF, 0xC2, 0x04, 0x93, 0x81, 0x99, 0x24, 0x80,
+    0x1D, 0xC0, 0xEB, 0x2D, 0x58, 0x23, 0x01, 0xCD, 0x02, 0x13, 0x18, 0xE0, 0x40, 0xAF, 0xB2, 0x60,
+    0xA1, 0x8E, 0x5E, 0xC8, 0xA2, 0x67, 0x76, 0x31, 0x56, 0x04, 0x20, 0x94, 0x18, 0x61, 0xCE, 0x87,
+    0xF1, 0x61, 0x66, 0xAB, 0x63, 0x01, 0xE8, 0x6A, 0x21, 0xA2, 0xE8, 0x61, 0x0F, 0x0B, 0x58, 0x2B,
+    0x28, 0x60, 0xC7, 0x05, 0xD0, 0xCB, 0x70, 0xF4, 0xC4, 0x06, 0xB3, 0x06, 0xE6, 0x74, 0x16, 0x41,
+    0x64, 0x20, 0x8D, 0x1D, 0x70, 0x62, 0x00, 0x98, 0xBB, 0xD0, 0x43, 0x09, 0x16, 0xEE, 0x1C, 0x30,
+    0x07, 0xDB, 0xE0, 0x05, 0x82, 0xF0, 0x92, 0x04, 0x66, 0x00, 0x3C, 0xBE, 0xA1, 0xB4, 0x15, 0x6E,
+    0x00, 0x53, 0x02, 0xB7, 0x0A, 0xEA, 0x25, 0xF4, 0xDA, 0x4A, 0x08, 0x0D, 0x30, 0xC2, 0x82, 0x1C,
+    0xB5, 0xEA, 0x81, 0x45, 0xAA, 0x24, 0x7E, 0x80, 0x9E, 0xC4, 0x61, 0x01, 0xCB, 0x80, 0x1E, 0xF9,
+    0xB0, 0x98, 0x80, 0x17, 0xD0, 0xE8, 0x05, 0x30, 0x7A, 0xA1, 0x29, 0x00, 0x0B, 0x3C, 0x76, 0xF4,
+    0x62, 0x15, 0x96, 0xBE, 0x30, 0xF2, 0x17, 0x7A, 0xBE, 0x82, 0xF1, 0xB5, 0x31, 0x00, 0x7A, 0x60,
+    0xC1, 0x54, 0xA2, 0x57, 0xB8, 0x9C, 0xD6, 0xE8, 0x00, 0xE6, 0x2F, 0xF4, 0x62, 0x8C, 0x09, 0xE6,
+    0x2A, 0x0E, 0x98, 0xD9, 0xB0, 0xC4, 0x00, 0x73, 0x0D, 0x7A, 0xF2, 0x47, 0x2F, 0xE0, 0x38, 0xE0,
+    0xF5, 0x22, 0x9A, 0xD1, 0xE8, 0x05, 0x1E, 0x7A, 0xEA, 0x62, 0xE0, 0x83, 0x19, 0x05, 0x2B, 0xD7,
+    0xD1, 0xEB, 0x6E, 0x98, 0x15, 0xE8, 0x6D, 0x2B, 0x74, 0x75, 0x30, 0x79, 0x50, 0xB9, 0x07, 0xD3,
+    0x63, 0x40, 0x00, 0xC0, 0x5C, 0x81, 0x11, 0x52, 0x10, 0x00, 0x6F, 0x82, 0x43, 0xD3, 0x13, 0xAF,
+    0x1D, 0x01, 0x80, 0xDE, 0x3A, 0x80, 0x37, 0x38, 0x61, 0x6E, 0x85, 0x15, 0x92, 0x50, 0x71, 0x98,
+    0x7A, 0x78, 0x66, 0x44, 0x0F, 0x6F, 0xF4, 0x1E, 0x13, 0xCC, 0x60, 0xA8, 0xFB, 0x59, 0xD0, 0xCB,
+    0x00, 0xF4, 0x3A, 0x10, 0x16, 0x5F, 0x2C, 0xE8, 0x89, 0x03, 0xA6, 0x90, 0x1B, 0x57, 0x37, 0x84,
+    0x40, 0x13, 0x0C, 0x04, 0xE0, 0x31, 0x06, 0x75, 0xB4, 0x38, 0x7A, 0x01, 0x0C, 0x33, 0x0B, 0xD1,
+    0xCD, 0x43, 0x0B, 0x50, 0x35, 0x54, 0x00, 0xF7, 0x2D, 0x5A, 0x15, 0x27, 0x01, 0x03, 0xB0, 0x70,
+    0xC3, 0x52, 0x84, 0xA0, 0xE7, 0x59, 0xF4, 0xB6, 0x3D, 0x23, 0xCC, 0x70, 0x1C, 0x05, 0x23, 0x10,
+    0xC0, 0xFC, 0x21, 0x84, 0x9E, 0x69, 0x75, 0x10, 0x00, 0x66, 0x0A, 0xBC, 0x05, 0x80, 0xDE, 0xB8,
+    0x81, 0x86, 0xAB, 0x2E, 0x12, 0x60, 0x40, 0x6F, 0x42, 0xE1, 0x2F, 0x49, 0x41, 0x00, 0xDD, 0x78,
+    0xF4, 0x5A, 0x98, 0x17, 0xBD, 0xA5, 0xC1, 0xC2, 0xC0, 0x8A, 0x06, 0xD0, 0x4B, 0x1C, 0x0E, 0x98,
+    0xF7, 0x60, 0x5A, 0x61, 0x19, 0x06, 0xBD, 0xC2, 0xC5, 0x6C, 0xBA, 0x42, 0x01, 0x00, 0x02, 0xBA,
+    0x4D, 0xA5, 0x00, 0x10, 0x00, 0x00
+};
+
+//a stored readme.txt that isn't a ROM, then roms/test.nes deflated
+static const uint8_t archive_test_zip[] = {
+    0x50, 0x4B, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x4F, 0x92,
+    0x70, 0xF5, 0x0A, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x72, 0x65,
+    0x61, 0x64, 0x6D, 0x65, 0x2E, 0x74, 0x78, 0x74, 0x6E, 0x6F, 0x74, 0x20, 0x61, 0x20, 0x52, 0x4F,
+    0x4D, 0x0A, 0x50, 0x4B, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x21, 0x00,
+    0x02, 0xBA, 0x4D, 0xA5, 0x4E, 0x03, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x0D, 0x00, 0x00, 0x00,
+    0x72, 0x6F, 0x6D, 0x73, 0x2F, 0x74, 0x65, 0x73, 0x74, 0x2E, 0x6E, 0x65, 0x73, 0x85, 0xD6, 0x5B,
+    0x43, 0xDA, 0x40, 0x10, 0x05, 0xE0, 0x84, 0x06, 0x08, 0x2A, 0x17, 0x41, 0x11, 0x90, 0x8A, 0xA8,
+    0xD5, 0x7A, 0xAD, 0xD0, 0x16, 0x5B, 0xA1, 0xFA, 0xD4, 0xD7, 0xBE, 0xF4, 0xFF, 0xFF, 0x97, 0x2A,
+    0xE6, 0x8B, 0xB8, 0x20, 0x9D, 0x97, 0xCD, 0xEE, 0xCE, 0x9C, 0x39, 0x73, 0x66, 0xB3, 0xC9, 0x9F,
+    0xDF, 0x7F, 0x7B, 0x71, 0x1C, 0xE5, 0xD6, 0x6F, 0x96, 0x76, 0x47, 0x93, 0xFA, 0xDE, 0xD9, 0x69,
+    0xB9, 0x7B, 0x91, 0xCE, 0xBA, 0xC9, 0xCE, 0xE4, 0xD7, 0x60, 0xD6, 0x1F, 0x96, 0x6D, 0xDC, 0x7C,
+    0xF8, 0x51, 0xAD, 0xDE, 0x3F, 0x9C, 0xD6, 0x06, 0xDD, 0x6E, 0x7D, 0xF0, 0x38, 0xB1, 0xDE, 0x3B,
+    0x29, 0xD5, 0xFA, 0xE7, 0xD7, 0xB5, 0x9A, 0x80, 0xE4, 0xA2, 0xDD, 0x9A, 0x36, 0x8B, 0xC3, 0x4E,
+    0xA7, 0xD8, 0x28, 0x56, 0xFA, 0xAD, 0xEA, 0xAE, 0x90, 0xE3, 0x05, 0xFB, 0xFA, 0x64, 0xD6, 0x67,
+    0x3B, 0xBB, 0x5F, 0xEE, 0x6E, 0x3E, 0xED, 0x5F, 0x4C, 0xD3, 0x6E, 0xB3, 0xD5, 0xFC, 0x58, 0x7A,
+    0x88, 0x2F, 0x37, 0xA7, 0x47, 0x53, 0x88, 0x93, 0xB9, 0x61, 0xB6, 0x29, 0x23, 0xF7, 0xF4, 0xB1,
+    0x3D, 0xBC, 0x3D, 0x9C, 0xD6, 0x47, 0x49, 0xE4, 0x89, 0x6F, 0xE1, 0xFC, 0x7D, 0x1B, 0xB3, 0xEA,
+    0x1A, 0x7B, 0x27, 0xBC, 0x32, 0x8E, 0x0F, 0xAE, 0xC6, 0xE9, 0xA8, 0x57, 0xF8, 0xD9, 0xD9, 0x3A,
+    0xEE, 0x4D, 0x54, 0x12, 0xE6, 0x27, 0x01, 0xAA, 0xA8, 0xAB, 0x8C, 0x3F, 0x1C, 0x7E, 0xA5, 0xC1,
+    0xC5, 0xF7, 0x42, 0xA9, 0xD5, 0x31, 0x0F, 0xF3, 0x99, 0x6B, 0xC2, 0xB3, 0x9A, 0x0B, 0x46, 0x40,
+    0x23, 0x78, 0xE9, 0x84, 0xC7, 0x8F, 0xA3, 0x83, 0xF6, 0xB8, 0x5E, 0xB6, 0x6E, 0x4E, 0x3E, 0x3D,
+    0x47, 0x07, 0x0E, 0x5A, 0xE2, 0x7A, 0x99, 0x9D, 0xBE, 0xDA, 0x8B, 0xA6, 0x21, 0x01, 0xF5, 0x7F,
+    0x5E, 0x67, 0x44, 0xDB, 0x05, 0x7F, 0xBB, 0x68, 0x0E, 0x0B, 0x68, 0xA7, 0x4D, 0x0B, 0x70, 0x86,
+    0xB2, 0xF7, 0x1F, 0x13, 0x9F, 0xC8, 0x66, 0x24, 0x86, 0xE2, 0x23, 0x62, 0x73, 0xA0, 0xA2, 0x4C,
+    0x18, 0x08, 0x0C, 0xE7, 0x8A, 0x97, 0x11, 0xD3, 0x50, 0x4D, 0xF8, 0xF6, 0xE1, 0x23, 0x52, 0x01,
+    0x84, 0x80, 0x80, 0xBC, 0x3D, 0xD9, 0x0B, 0x48, 0x2A, 0xEB, 0xFC, 0x23, 0xFD, 0xC5, 0x54, 0x65,
+    0x77, 0xEF, 0x99, 0x0C, 0xA8, 0x28, 0x0D, 0x72, 0x43, 0x4D, 0x36, 0x16, 0x44, 0x3F, 0x5C, 0x6F,
+    0xA0, 0x13, 0x6C, 0xBD, 0x1B, 0xA0, 0xC8, 0x63, 0x2C, 0x32, 0xE5, 0xA8, 0x42, 0x55, 0x29, 0xE1,
+    0x20, 0x62, 0x29, 0x15, 0x64, 0xA3, 0xFD, 0x7C, 0xCC, 0xAE, 0x34, 0xF3, 0xE1, 0x92, 0x9D, 0xE4,
+    0x26, 0x07, 0x01, 0xE4, 0x88, 0xF2, 0x8D, 0xE0, 0x52, 0xA3, 0x35, 0x29, 0x35, 0x13, 0xC0, 0xD1,
+    0x5B, 0xCB, 0x2F, 0xE8, 0xA5, 0x87, 0x2E, 0x04, 0x75, 0x6F, 0x51, 0x2E, 0xB2, 0x83, 0x83, 0x31,
+    0x56, 0xB1, 0x97, 0x47, 0x72, 0x12, 0x9A, 0x6F, 0x78, 0x20, 0xBA, 0xB3, 0x67, 0xAE, 0x4C, 0x12,
+    0xC9, 0x00, 0x18, 0x27, 0x23, 0xFF, 0x7E, 0x60, 0xD9, 0x57, 0x47, 0xD8, 0x86, 0x12, 0xE4, 0xD7,
+    0xCA, 0x79, 0x98, 0x09, 0x32, 0x40, 0x91, 0xB0, 0x5F, 0x79, 0x93, 0x84, 0x18, 0x72, 0x88, 0x96,
+    0x42, 0x4A, 0x0D, 0x80, 0x62, 0x3D, 0x8C, 0x57, 0x52, 0x31, 0xAF, 0x39, 0xBB, 0xAC, 0x9D, 0x47,
+    0xEB, 0xE8, 0x45, 0x90, 0x8D, 0x51, 0x43, 0x0E, 0xCC, 0x85, 0xE2, 0x28, 0xB7, 0xF5, 0x87, 0x27,
+    0xC3, 0xD7, 0x9A, 0x9E, 0xB5, 0x80, 0x6C, 0x79, 0x90, 0xC7, 0x3C, 0x0A, 0xE1, 0xA4, 0x41, 0x43,
+    0x80, 0xE3, 0x61, 0x1E, 0x4A, 0xA5, 0xFB, 0x49, 0xC1, 0x0E, 0xA4, 0xC6, 0x6A, 0xC3, 0x15, 0xF7,
+    0x30, 0xC1, 0x37, 0x96, 0x02, 0x32, 0x52, 0x1D, 0x82, 0xB9, 0xAA, 0x75, 0xA1, 0xED, 0x36, 0x78,
+    0x1A, 0xD5, 0xAB, 0x01, 0xB0, 0xF8, 0xA2, 0x6F, 0x0E, 0xFB, 0x6C, 0x85, 0x85, 0xBE, 0x2F, 0x2E,
+    0x22, 0xB0, 0x20, 0xEC, 0x7D, 0x66, 0xE5, 0xF7, 0x0C, 0x7D, 0xBA, 0x51, 0x58, 0x07, 0x50, 0x42,
+    0x3D, 0xD9, 0x5E, 0xB4, 0xFD, 0xD5, 0x56, 0x59, 0x32, 0xBC, 0x8C, 0x60, 0xE9, 0x9E, 0x22, 0x3C,
+    0x5B, 0x6B, 0xDB, 0xDC, 0xF2, 0x2F, 0x05, 0xDE, 0x46, 0x05, 0xAF, 0x18, 0xB9, 0xC0, 0x50, 0x12,
+    0xED, 0xBC, 0x16, 0xCD, 0xC0, 0x62, 0x92, 0xBF, 0xFD, 0x08, 0x69, 0x6A, 0x77, 0xBD, 0xC9, 0x26,
+    0x0B, 0x61, 0xF3, 0x0A, 0xA0, 0xEB, 0x44, 0x7E, 0x41, 0x3B, 0x9B, 0x5A, 0x82, 0xAF, 0xB1, 0x41,
+    0xBC, 0xB2, 0x50, 0x3B, 0xCE, 0xD7, 0xD2, 0xFB, 0x25, 0x39, 0x48, 0xF3, 0xCB, 0x25, 0x0B, 0xC5,
+    0xE2, 0x49, 0x24, 0x29, 0x2B, 0xD3, 0xD0, 0xB4, 0x16, 0x7D, 0x02, 0x14, 0xB0, 0x4A, 0x61, 0x3B,
+    0x0C, 0xD8, 0x88, 0x24, 0x95, 0x1C, 0x79, 0xA0, 0x82, 0x43, 0xE8, 0xBC, 0xEE, 0xEC, 0xC2, 0x03,
+    0xC4, 0x3F, 0xAA, 0x81, 0xF2, 0x91, 0x23, 0xBA, 0x51, 0x0A, 0x94, 0x50, 0xB4, 0x6F, 0xB4, 0xFF,
+    0x7C, 0xEF, 0x89, 0x59, 0xFC, 0x09, 0x5C, 0xF5, 0x8C, 0x45, 0x28, 0x54, 0x36, 0x07, 0xED, 0x3C,
+    0x55, 0x9F, 0xB1, 0xD7, 0x19, 0x3C, 0x01, 0x78, 0x00, 0x22, 0xA7, 0x75, 0xFE, 0xF9, 0x4B, 0xC9,
+    0x81, 0x4C, 0x44, 0x21, 0x2B, 0xE0, 0xAC, 0x98, 0x84, 0x1F, 0x99, 0xF9, 0x39, 0x13, 0xFA, 0x95,
+    0xFF, 0xA9, 0x52, 0x9B, 0xE3, 0x26, 0x0A, 0x4E, 0x0F, 0xC4, 0xF5, 0x7F, 0x60, 0xF3, 0x5D, 0xE4,
+    0x90, 0xDE, 0x03, 0x2E, 0x2B, 0x2C, 0xE7, 0x2C, 0xA1, 0x83, 0x32, 0x5E, 0xFF, 0xFD, 0xE7, 0x4F,
+    0x00, 0x6D, 0xC3, 0xE9, 0x30, 0xBA, 0xAD, 0xB8, 0x42, 0xE4, 0x92, 0x42, 0x5D, 0x94, 0x88, 0x81,
+    0xAF, 0xBE, 0x17, 0x9F, 0x57, 0xD5, 0xD1, 0x54, 0x07, 0x55, 0xAF, 0x5E, 0x0D, 0x8A, 0x92, 0xA4,
+    0x23, 0x1F, 0x5D, 0xAF, 0x17, 0x2C, 0xC2, 0x05, 0xFD, 0xB5, 0x17, 0xE9, 0x7C, 0x33, 0x84, 0xA7,
+    0x04, 0x84, 0x2A, 0x07, 0x54, 0x93, 0x68, 0xE1, 0xA3, 0x36, 0x7F, 0x44, 0x5E, 0x48, 0xAA, 0x3C,
+    0xA1, 0x5E, 0x18, 0xD8, 0xA8, 0x2F, 0xFD, 0xB9, 0x5A, 0xF8, 0x07, 0x50, 0x4B, 0x01, 0x02, 0x14,
+    0x03, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x4F, 0x92, 0x70, 0xF5, 0x0A,
+    0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x72, 0x65, 0x61, 0x64, 0x6D, 0x65, 0x2E,
+    0x74, 0x78, 0x74, 0x50, 0x4B, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00,
+    0x00, 0x21, 0x00, 0x02, 0xBA, 0x4D, 0xA5, 0x4E, 0x03, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x0D,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x32, 0x00, 0x00,
+    0x00, 0x72, 0x6F, 0x6D, 0x73, 0x2F, 0x74, 0x65, 0x73, 0x74, 0x2E, 0x6E, 0x65, 0x73, 0x50, 0x4B,
+    0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x02, 0x00, 0x73, 0x00, 0x00, 0x00, 0xAB, 0x03,
+    0x00, 0x00, 0x00, 0x00
+};
+
+//the first half at level 19 with a checksum, then the second half at level 3 without one, as 2 frames
+static const uint8_t archive_test_zstd[] = {
+    0x28, 0xB5, 0x2F, 0xFD, 0x64, 0x00, 0x07, 0xC5, 0x0E, 0x00, 0x82, 0x4B, 0x28, 0x19, 0x80, 0xDC,
+    0x79, 0xB0, 0xDD, 0xE7, 0x54, 0xB2, 0x47, 0x56, 0x2C, 0xF0, 0x6B, 0x80, 0x07, 0xF2, 0x92, 0x14,
+    0xBC, 0xA4, 0x07, 0x8F, 0x3C, 0x64, 0x0A, 0x2F, 0xE5, 0x90, 0xFA, 0x9F, 0x56, 0xB0, 0x05, 0xF1,
+    0x25, 0xFD, 0x8A, 0x67, 0x6C, 0x75, 0xCA, 0x04, 0x95, 0x79, 0x2B, 0x0B, 0x96, 0xC7, 0xE5, 0xA6,
+    0xEF, 0x42, 0x78, 0x9E, 0x78, 0xC1, 0x32, 0x8D, 0x30, 0x9D, 0xC6, 0xB3, 0x85, 0x84, 0x6D, 0xA2,
+    0xCC, 0xAB, 0x9F, 0x04, 0x11, 0x3F, 0x7B, 0x3F, 0x48, 0xF4, 0xD2, 0x9B, 0x7A, 0xC2, 0xB2, 0x5D,
+    0x9E, 0x3A, 0xE0, 0x5D, 0xD1, 0x07, 0x91, 0x18, 0xD2, 0x43, 0x95, 0x2B, 0x5D, 0x7B, 0x67, 0x68,
+    0x50, 0x32, 0x15, 0x8B, 0x00, 0x5E, 0x16, 0xD6, 0xCD, 0xDB, 0x4E, 0x6A, 0x62, 0xD8, 0x36, 0xAB,
+    0x9E, 0xAF, 0x4E, 0x62, 0x3C, 0x81, 0x6C, 0x4C, 0x19, 0x19, 0xF7, 0x68, 0x93, 0xD6, 0x1A, 0xE6,
+    0x42, 0xCE, 0xBD, 0x1A, 0x00, 0x25, 0xB0, 0x6D, 0x50, 0xEB, 0x70, 0x82, 0xD4, 0x60, 0xED, 0x74,
+    0x80, 0x73, 0x14, 0x26, 0xEE, 0x59, 0xB4, 0xDA, 0x1F, 0x63, 0x16, 0xFA, 0x80, 0x02, 0x80, 0xB1,
+    0xA8, 0xC1, 0x3E, 0x65, 0x14, 0x14, 0x6A, 0xB4, 0x06, 0x30, 0xC4, 0x90, 0x99, 0x43, 0xF3, 0x21,
+    0x04, 0x08, 0x01, 0x02, 0x49, 0x44, 0x44, 0x24, 0x58, 0xCA, 0x49, 0x92, 0x0C, 0x07, 0xAA, 0x91,
+    0xD6, 0x04, 0x38, 0x40, 0x46, 0x32, 0xF5, 0x71, 0xC6, 0xDB, 0x94, 0xED, 0x7F, 0xE1, 0x3B, 0xCB,
+    0x70, 0x8A, 0x9B, 0x3B, 0x8B, 0xAE, 0xCD, 0x49, 0x92, 0x72, 0xF7, 0xE9, 0xC5, 0xD0, 0xAE, 0xA2,
+    0x79, 0xC7, 0x63, 0x0D, 0xC2, 0x29, 0xC4, 0x6B, 0x4D, 0x13, 0x1F, 0x51, 0x25, 0x49, 0x3E, 0xE1,
+    0x3B, 0xE3, 0x00, 0x18, 0xB5, 0x86, 0x10, 0x11, 0x08, 0x3B, 0xF1, 0xED, 0x45, 0xCB, 0x4C, 0xB5,
+    0x23, 0x4D, 0x4A, 0x52, 0x39, 0x34, 0x45, 0x00, 0x40, 0x6A, 0xDD, 0xBF, 0x3B, 0xA8, 0x5A, 0xF5,
+    0xC0, 0x1E, 0x29, 0xE4, 0x03, 0xFC, 0x51, 0x66, 0xD0, 0x4E, 0xFD, 0x86, 0x84, 0x60, 0x93, 0x81,
+    0xC0, 0xA7, 0xD8, 0x40, 0x33, 0xF5, 0x24, 0xA9, 0xEC, 0xA4, 0x76, 0xE6, 0xD2, 0x81, 0x96, 0x07,
+    0x94, 0x6B, 0x4A, 0x67, 0x14, 0x4E, 0x84, 0x9C, 0xFC, 0x11, 0xC4, 0xD8, 0x6B, 0x02, 0xA8, 0x22,
+    0xCB, 0x4A, 0xAC, 0xAE, 0xBB, 0xB7, 0x5C, 0x58, 0xDA, 0xC5, 0x4E, 0x1D, 0xAF, 0xE7, 0x58, 0x97,
+    0x4C, 0x8A, 0x24, 0x4A, 0xD0, 0x19, 0x63, 0x90, 0x66, 0x75, 0x3B, 0x2A, 0x5A, 0x55, 0x1B, 0x80,
+    0x65, 0x14, 0x5C, 0xA8, 0xD6, 0x26, 0x59, 0x61, 0x92, 0x00, 0x0F, 0x44, 0x18, 0x6B, 0xD8, 0xB0,
+    0x34, 0xA1, 0x9B, 0x0D, 0xC3, 0x38, 0xF0, 0x08, 0x18, 0x24, 0xAB, 0x8A, 0x6D, 0x3B, 0x88, 0x78,
+    0x37, 0x80, 0x12, 0xA0, 0xEC, 0xD6, 0x0E, 0x07, 0x4D, 0xF8, 0xAB, 0x2E, 0xE1, 0xF7, 0x10, 0x42,
+    0x19, 0x31, 0x0A, 0x20, 0xA8, 0xBC, 0xF5, 0xB3, 0x21, 0xEA, 0x16, 0x02, 0xF1, 0x3F, 0xB3, 0xE8,
+    0xA6, 0xA8, 0xC0, 0x2F, 0x72, 0xAE, 0x1B, 0x9F, 0x73, 0xDD, 0x40, 0x1C, 0x58, 0xA1, 0x39, 0xC7,
+    0xFF, 0xE8, 0x00, 0x48, 0x78, 0xEA, 0x7B, 0xED, 0x4E, 0x09, 0xAF, 0xD5, 0x61, 0x81, 0xFA, 0xA1,
+    0x6A, 0xAB, 0x18, 0x00, 0x80, 0x6A, 0xB2, 0x4F, 0xA5, 0x2F, 0xB5, 0xF1, 0x8F, 0x23, 0x2A, 0x11,
+    0xF8, 0x01, 0x12, 0x30, 0xB6, 0xDC, 0x28, 0xB5, 0x2F, 0xFD, 0x60, 0x00, 0x07, 0xBD, 0x0E, 0x00,
+    0xB2, 0x8B, 0x26, 0x12, 0x30, 0xE0, 0x3D, 0xEC, 0xB5, 0x80, 0x04, 0x07, 0x30, 0x94, 0xC7, 0xA5,
+    0xFD, 0x0B, 0x74, 0xEE, 0x10, 0x0A, 0x54, 0x75, 0xF1, 0xBA, 0x89, 0x44, 0x3F, 0x8D, 0x57, 0xD1,
+    0xA0, 0x08, 0xC4, 0xF8, 0xAF, 0xE5, 0xFF, 0xFF, 0x0D, 0x39, 0xBB, 0x0A, 0x53, 0x4B, 0xD8, 0x55,
+    0xE8, 0x6D, 0xC4, 0xD1, 0xC7, 0xF5, 0xCC, 0xD3, 0x57, 0xF6, 0x0A, 0x0B, 0x05, 0x75, 0xDC, 0x60,
+    0xAB, 0xF6, 0x30, 0x88, 0x54, 0xA3, 0x94, 0xB4, 0x4D, 0x9C, 0x8C, 0xF0, 0x38, 0x38, 0x28, 0x99,
+    0x4A, 0x81, 0xB0, 0x65, 0x11, 0x43, 0xC0, 0x37, 0x30, 0x92, 0x50, 0xDF, 0xAA, 0xD5, 0x69, 0xF5,
+    0xA0, 0x19, 0x83, 0x12, 0x57, 0xE7, 0xDD, 0x2D, 0x59, 0xF9, 0x48, 0x5E, 0x2F, 0x57, 0xC5, 0x24,
+    0x89, 0x87, 0xD9, 0xE7, 0xFD, 0x09, 0x23, 0x42, 0x6F, 0xDD, 0xAB, 0xB7, 0xF0, 0x04, 0x22, 0xE1,
+    0xD9, 0x88, 0xF8, 0x9E, 0x10, 0x63, 0x4D, 0x33, 0xEB, 0x4C, 0xB9, 0xF7, 0x09, 0x73, 0x4A, 0x6A,
+    0xBF, 0x21, 0xAB, 0xFA, 0xDA, 0xBD, 0x1A, 0x00, 0xC5, 0x2F, 0x7C, 0x20, 0x12, 0x80, 0xBB, 0xA8,
+    0xA1, 0xBA, 0x49, 0x51, 0x6A, 0x65, 0x39, 0x20, 0x02, 0x45, 0xA4, 0xE0, 0xD9, 0x06, 0x11, 0x24,
+    0x08, 0x42, 0x3A, 0x22, 0x22, 0x22, 0x24, 0x29, 0x48, 0x41, 0x49, 0x21, 0xAD, 0x01, 0xC4, 0x97,
+    0x5F, 0xA7, 0x39, 0x1E, 0x14, 0xB3, 0x0C, 0x2A, 0xA5, 0xDA, 0x60, 0xC7, 0x90, 0x8A, 0x69, 0x78,
+    0x17, 0xC5, 0x53, 0xAC, 0x4A, 0x55, 0xA8, 0x7B, 0xB0, 0x18, 0xBF, 0x85, 0xD0, 0x91, 0xDD, 0x5A,
+    0x92, 0x38, 0x68, 0x56, 0x83, 0x96, 0xF1, 0x70, 0x01, 0x8D, 0x42, 0x10, 0x1B, 0xB8, 0x95, 0xA6,
+    0xDF, 0x1F, 0x92, 0x3B, 0x07, 0xB2, 0x08, 0x11, 0x75, 0x99, 0x44, 0xD9, 0x2E, 0xE0, 0x35, 0xF6,
+    0x44, 0x6E, 0x9C, 0x3D, 0x6E, 0x50, 0xE4, 0xF3, 0xAA, 0x09, 0x66, 0xA0, 0xCC, 0x6E, 0x10, 0x72,
+    0x16, 0x5F, 0x90, 0x58, 0xCD, 0xAC, 0xE9, 0x59, 0xE3, 0xA4, 0x65, 0x31, 0x50, 0x85, 0x49, 0xC8,
+    0xCB, 0x6A, 0xBE, 0x56, 0x52, 0xC8, 0x7C, 0x21, 0x14, 0x4D, 0xE2, 0x04, 0xC5, 0x14, 0x79, 0x31,
+    0xA3, 0xA3, 0x92, 0x09, 0x0B, 0x41, 0xE5, 0xC5, 0x82, 0xED, 0x71, 0x93, 0x5B, 0x60, 0x52, 0xB6,
+    0x0C, 0x8F, 0xDE, 0x81, 0xF3, 0x0C, 0x9D, 0x35, 0xC8, 0xDA, 0xCB, 0x3D, 0xA1, 0xA7, 0xE5, 0x3B,
+    0xC9, 0x05, 0xBA, 0x47, 0x0A, 0x84, 0xF5, 0x73, 0x99, 0x38, 0x4C, 0x18, 0xB7, 0xC3, 0x4B, 0xD8,
+    0x43, 0xA1, 0xAD, 0x87, 0x31, 0x5F, 0x1E, 0x72, 0x6B, 0x3C, 0x40, 0x39, 0x66, 0xDB, 0xC2, 0x6B,
+    0xA0, 0xEF, 0xA6, 0x15, 0x4B, 0xEA, 0x93, 0xDA, 0x7C, 0xA3, 0xC2, 0x22, 0x45, 0xCA, 0x45, 0xBA,
+    0x31, 0xB2, 0xF9, 0xD8, 0x10, 0xC1, 0xB1, 0x23, 0xC3, 0xD3, 0x3F, 0x67, 0xC5, 0xC1, 0xCC, 0xEB,
+    0x88, 0x1E, 0x6F, 0x77, 0x97, 0xF8, 0x55, 0x10, 0x12, 0x68, 0xB5, 0x47, 0x0D, 0xBA, 0xDD, 0x0C,
+    0x59, 0x70, 0x86, 0xC9, 0x90, 0xBE, 0x6A, 0xB9, 0xD0, 0x95, 0xE1, 0x0E, 0x84, 0x75, 0x0E, 0x7E,
+    0x4E, 0x26, 0x5A, 0x0F, 0x23, 0x5E, 0x5E, 0xA2, 0xE9, 0xB7, 0x1A, 0x0B, 0xF5, 0xE1, 0xEA, 0x11,
+    0x42, 0xA1, 0x38, 0x7A, 0x05, 0x6C, 0x93, 0x89, 0x20, 0x25, 0x7D, 0x13, 0x17, 0x4C, 0x13, 0xD4,
+    0x2C, 0xD4, 0x56, 0xD5, 0x66, 0x51, 0x55
+};
+
+void
+archive_test_init() {
+    memset(&archive_test, 0, sizeof(archive_test));
+}
+
+void
+archive_test_free() {
+    free(archive_test.stored);
+    free(archive_test.blocks);
+    free(archive_test.pack);
+}
+
+static uint32_t
+archive_test_random() {
+    archive_test.seed = archive_test.seed * 1103515245 + 12345;
+
+    return archive_test.seed >> 16;
+}
+
+//a header, then 8 byte snippets picked from 16, single bytes and runs, over a small alphabet so zstd Huffman codes the
+//literals
+static void
+archive_test_build_rom() {
+    uint8_t snippets[16][8];
+    uint32_t r;
+    int p, i, length;
+
+    memset(archive_test.rom, 0, sizeof(archive_test.rom));
+    memcpy(archive_test.rom, "NES\x1A\x01\x01", 6);
+
+    archive_test.seed = 1;
+    for (i = 0; i < 16 * 8; i++) {
+        snippets[i / 8][i % 8] = archive_test_random() & 0x3F;
+    }
+
+    for (p = 16; p < ARCHIVE_TEST_SIZE; p += length) {
+        r = archive_test_random();
+        length = r % 16 < 12 ? 8 : (r % 16 < 14 ? 1 : (r >> 4) % 32 + 4);
+        if (length > ARCHIVE_TEST_SIZE - p) {
+            length = ARCHIVE_TEST_SIZE - p;
+        }
+
+        if (r % 16 < 12) {
+            memcpy(archive_test.rom + p, snippets[(r >> 4) % 16], length);
+        }
+        else if (r % 16 < 14) {
+            archive_test.rom[p] = (r >> 8) & (r >> 11) & 0x3F;
+        }
+        else {
+            memset(archive_test.rom + p, (r >> 10) & 0xFF, length);
+        }
+    }
+}
+
+static void
+archive_test_put16(uint8_t *out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+}
+
+static void
+archive_test_put32(uint8_t *out, uint32_t value) {
+    archive_test_put16(out, value);
+    archive_test_put16(out + 2, value >> 16);
+}
+
+//a gzip file of 2 stored deflate blocks
+static bool
+archive_test_build_stored() {
+    static const uint8_t header[] = {0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF};
+    uint8_t *out;
+    int i;
+
+    archive_test.stored_size = sizeof(header) + 2 * 5 + ARCHIVE_TEST_SIZE + 8;
+    archive_test.stored = out = malloc(archive_test.stored_size);
+    if (out == NULL) {
+        return false;
+    }
+
+    memcpy(out, header, sizeof(header));
+    out += sizeof(header);
+
+    for (i = 0; i < 2; i++) {
+        out[0] = i;                         //only the last block is final
+        archive_test_put16(out + 1, ARCHIVE_TEST_SIZE / 2);
+        archive_test_put16(out + 3, ~(ARCHIVE_TEST_SIZE / 2));
+        memcpy(out + 5, archive_test.rom + i * ARCHIVE_TEST_SIZE / 2, ARCHIVE_TEST_SIZE / 2);
+        out += 5 + ARCHIVE_TEST_SIZE / 2;
+    }
+
+    archive_test_put32(out, ARCHIVE_TEST_CRC32);
+    archive_test_put32(out + 4, ARCHIVE_TEST_SIZE);
+
+    return true;
+}
+
+//a zstd frame of a raw block, an RLE block for the ROM's first run and a raw block for the rest
+static bool
+archive_test_build_blocks() {
+    uint8_t *out;
+    int run, length;
+
+    for (run = 0; run + 4 <= ARCHIVE_TEST_SIZE && memcmp(archive_test.rom + run, archive_test.rom + run + 1, 3) != 0; run++);
+    for (length = 1; run + length < ARCHIVE_TEST_SIZE && archive_test.rom[run + length] == archive_test.rom[run]; length++);
+
+    archive_test.blocks_size = 4 + 1 + 2 + 3 + run + 3 + 1 + 3 + (ARCHIVE_TEST_SIZE - run - length);
+    archive_test.blocks = out = malloc(archive_test.blocks_size);
+    if (out == NULL) {
+        return false;
+    }
+
+    //a single segment with a 2 byte content size, which is stored less 256
+    archive_test_put32(out, ZSTD_MAGIC);
+    out[4] = 0x60;
+    archive_test_put16(out + 5, ARCHIVE_TEST_SIZE - 256);
+    out += 7;
+
+    //block headers are the last flag, then the type and the size
+    archive_test_put32(out, run << 3);
+    memcpy(out + 3, archive_test.rom, run);
+    out += 3 + run;
+
+    archive_test_put32(out, length << 3 | 1 << 1);
+    out[3] = archive_test.rom[run];
+    out += 4;
+
+    out[0] = (ARCHIVE_TEST_SIZE - run - length) << 3 | 1;
+    archive_test_put16(out + 1, (ARCHIVE_TEST_SIZE - run - length) >> 5);
+    memcpy(out + 3, archive_test.rom + run + length, ARCHIVE_TEST_SIZE - run - length);
+
+    return true;
+}
+
+//a pack of the deflated ROM out of the gzip sample and the zstd sample, the way archive_write_pack() copies them in
+static bool
+archive_test_build_pack() {
+    static const char names[] = "gzip.nes\0zstd.nes";
+    archive_pack_header_t header;
+    archive_pack_entry_t entries[2];
+    size_t deflated_size;
+
+    deflated_size = sizeof(archive_test_gzip) - ARCHIVE_TEST_GZIP_HEADER - 8;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = ARCHIVE_PACK_MAGIC;
+    header.version = ARCHIVE_PACK_VERSION;
+    header.count = 2;
+    header.names_size = sizeof(names);
+    header.index = (sizeof(header) + deflated_size + sizeof(archive_test_zstd) + 7) & ~7;
+
+    memset(entries, 0, sizeof(entries));
+    entries[0].offset = sizeof(header);
+    entries[0].compressed_size = deflated_size;
+    entries[0].method = ARCHIVE_METHOD_DEFLATE;
+    entries[1].offset = sizeof(header) + deflated_size;
+    entries[1].compressed_size = sizeof(archive_test_zstd);
+    entries[1].name = sizeof("gzip.nes");
+    entries[1].method = ARCHIVE_METHOD_ZSTD;
+    entries[0].size = entries[1].size = ARCHIVE_TEST_SIZE;
+    entries[0].crc32 = entries[1].crc32 = ARCHIVE_TEST_CRC32;
+
+    archive_test.pack_size = header.index + sizeof(entries) + sizeof(names);
+    archive_test.pack = calloc(1, archive_test.pack_size);
+    if (archive_test.pack == NULL) {
+        return false;
+    }
+
+    memcpy(archive_test.pack, &header, sizeof(header));
+    memcpy(archive_test.pack + entries[0].offset, archive_test_gzip + ARCHIVE_TEST_GZIP_HEADER, deflated_size);
+    memcpy(archive_test.pack + entries[1].offset, archive_test_zstd, sizeof(archive_test_zstd));
+    memcpy(archive_test.pack + header.index, entries, sizeof(entries));
+    memcpy(archive_test.pack + header.index + sizeof(entries), names, sizeof(names));
+
+    return true;
+}
+
+static void
+archive_test_add(int index, const char *name, const uint8_t *data, size_t size, const char *rom, bool checked) {
+    archive_test_sample_t *sample = &archive_test.samples[index];
+
+    sample->name = name;
+    sample->data = data;
+    sample->size = size;
+    sample->rom = rom;
+    sample->checked = checked;
+}
+
+static bool
+archive_test_build() {
+    archive_test_build_rom();
+    if (hash_crc32(0, archive_test.rom, ARCHIVE_TEST_SIZE) != ARCHIVE_TEST_CRC32) {
+        log_err(MODULE, "The ROM the samples were made from has CRC %08X instead of %08X", hash_crc32(0, archive_test.rom, ARCHIVE_TEST_SIZE), ARCHIVE_TEST_CRC32);
+        return false;
+    }
+
+    if (!archive_test_build_stored() || !archive_test_build_blocks() || !archive_test_build_pack()) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+
+    archive_test_add(0, "gzip", archive_test_gzip, sizeof(archive_test_gzip), NULL, true);
+    archive_test_add(1, "gzip fixed", archive_test_gzip_fixed, sizeof(archive_test_gzip_fixed), NULL, true);
+    archive_test_add(2, "gzip stored", archive_test.stored, archive_test.stored_size, NULL, true);
+    archive_test_add(3, "zip", archive_test_zip, sizeof(archive_test_zip), "test.nes", true);
+    archive_test_add(4, "zstd", archive_test_zstd, sizeof(archive_test_zstd), NULL, false);
+    archive_test_add(5, "zstd raw and RLE", archive_test.blocks, archive_test.blocks_size, NULL, false);
+    archive_test_add(6, "pack", archive_test.pack, archive_test.pack_size, "zstd.nes", true);
+
+    return true;
+}
+
+//extracts from size bytes of the sample copied into a buffer of their own, so a read past them is caught by the
+//sanitizers. like cartridge_load() it's only extracted from if it's still an archive or a ROM is named, and a copy that
+//decodes has to decode to the ROM if the format could tell it was damaged
+static bool
+archive_test_extract(const archive_test_sample_t *sample, const uint8_t *data, size_t size, bool *extracted) {
+    uint8_t *copy, *image;
+    size_t image_size;
+    bool success = true;
+
+    copy = malloc(size > 0 ? size : 1);
+    if (copy == NULL) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+    memcpy(copy, data, size);
+
+    *extracted = (sample->rom != NULL || archive_is_archive(copy, size)) && archive_extract(copy, size, sample->rom, &image, &image_size);
+    if (*extracted) {
+        success = !sample->checked || (image_size == ARCHIVE_TEST_SIZE && memcmp(image, archive_test.rom, ARCHIVE_TEST_SIZE) == 0);
+        free(image);
+    }
+
+    free(copy);
+
+    return success;
+}
+
+static bool
+archive_test_sample(const archive_test_sample_t *sample) {
+    log_level_t level;
+    uint8_t *damaged;
+    size_t size, p;
+    bool extracted, success;
+    int i, j;
+
+    if (!archive_is_archive(sample->data, sample->size) || !archive_test_extract(sample, sample->data, sample->size, &extracted) || !extracted) {
+        log_err(MODULE, "%s: doesn't extract", sample->name);
+        return false;
+    }
+
+    damaged = malloc(sample->size);
+    if (damaged == NULL) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+
+    //the errors are expected from here on
+    level = log_get_level();
+    log_set_level(LOG_LEVEL_NONE);
+    success = true;
+
+    //a zstd file cut between its frames is still whole, for every other cut the archive has to notice
+    for (size = 0; success && size < sample->size; size++) {
+        success = archive_test_extract(sample, sample->data, size, &extracted) && !(extracted && sample->checked);
+        if (!success) {
+            log_set_level(level);
+            log_err(MODULE, "%s: extracts when it's cut to %zu bytes", sample->name, size);
+        }
+    }
+
+    //headers and trailers are damaged more often, that's where the sizes and offsets are
+    archive_test.seed = 1;
+    for (i = 0; success && i < ARCHIVE_TEST_DAMAGED; i++) {
+        memcpy(damaged, sample->data, sample->size);
+        for (j = archive_test_random() % 4; j >= 0; j--) {
+            switch (archive_test_random() % 4) {
+                case 0:
+                    p = archive_test_random() % 64;
+                    break;
+                case 1:
+                    p = sample->size - 1 - archive_test_random() % 64;
+                    break;
+                default:
+                    p = archive_test_random();
+                    break;
+            }
+            p %= sample->size;
+            damaged[p] ^= 1 << (archive_test_random() % 8);
+        }
+        size = archive_test_random() % 8 == 0 ? archive_test_random() % sample->size : sample->size;
+
+        success = archive_test_extract(sample, damaged, size, &extracted);
+        if (!success) {
+            log_set_level(level);
+            log_err(MODULE, "%s: damaged copy %d extracts to something else", sample->name, i);
+        }
+    }
+
+    log_set_level(level);
+    free(damaged);
+
+    if (success) {
+        log_info(MODULE, "%s: extracts, and %zu cut and %d damaged copies fail or still extract the ROM", sample->name, sample->size, ARCHIVE_TEST_DAMAGED);
+    }
+
+    return success;
+}
+
+bool
+archive_test_formats() {
+    bool success;
+    int i;
+
+    success = archive_test_build();
+    for (i = 0; success && i < ARCHIVE_TEST_SAMPLES; i++) {
+        success = archive_test_sample(&archive_test.samples[i]);
+    }
+
+    return success;
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdbool.h>
+
+void archive_test_init();
+void archive_test_free();
+
+//extracts a ROM from a gzip, zip, zstd and pack file of every kind of block, then from truncated and damaged copies
+//of each, which have to fail rather than decode to something else
+bool archive_test_formats();
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <SDL2/SDL.h>
+#include "log.h"
+#include "os.h"
+#include "string.h"
+#include "battery.h"
+
+#define MODULE "Battery"
+
+//the RAM is the save file itself, so a write reaches the OS as soon as the game makes it. the background thread only
+//asks the OS to put the pages that were written on disk, the emulation never waits on it
+typedef struct {
+    char path[256];
+    uint8_t *data;
+    size_t size;
+    SDL_atomic_t *dirty;                    //one per page, set by the emulation thread, cleared when it's flushed
+    int pages;
+    SDL_atomic_t interval;
+    SDL_Thread *thread;
+    SDL_sem *wake;                          //posted to close
+} battery_t;
+
+static battery_t battery;
+
+void
+battery_init() {
+    memset(&battery, 0, sizeof(battery));
+    SDL_AtomicSet(&battery.interval, BATTERY_INTERVAL);
+}
+
+void
+battery_free() {
+    battery_close();
+}
+
+bool
+battery_flush() {
+    bool success = true;
+    int i, first;
+
+    for (i = 0; i < battery.pages; i++) {
+        if (SDL_AtomicSet(&battery.dirty[i], 0) == 0) {
+            continue;
+        }
+
+        //a run of written pages is flushed at once
+        first = i;
+        while (i + 1 < battery.pages && SDL_AtomicSet(&battery.dirty[i + 1], 0) != 0) {
+            i++;
+        }
+
+        if (!os_sync_file(battery.data, first * BATTERY_PAGE_SIZE, (i - first + 1) * BATTERY_PAGE_SIZE)) {
+            log_err(MODULE, "Failed to flush '%s': %s", battery.path, strerror(errno));
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+static int
+battery_thread(void *data) {
+    while (SDL_SemWaitTimeout(battery.wake, SDL_AtomicGet(&battery.interval)) == SDL_MUTEX_TIMEDOUT) {
+        battery_flush();
+    }
+
+    return 0;
+}
+
+uint8_t *
+battery_open(const char *path, size_t size) {
+    battery_close();
+
+    strlcpy(battery.path, path, sizeof(battery.path));
+    battery.size = size;
+    battery.pages = (size + BATTERY_PAGE_SIZE - 1) / BATTERY_PAGE_SIZE;
+
+    battery.data = os_map_file_shared(path, size);
+    if (battery.data == NULL) {
+        log_err(MODULE, "Failed to map '%s': %s", path, strerror(errno));
+        battery_close();
+        return NULL;
+    }
+
+    battery.dirty = calloc(battery.pages, sizeof(SDL_atomic_t));
+    if (battery.dirty == NULL) {
+        log_err(MODULE, "Out of memory");
+        battery_close();
+        return NULL;
+    }
+
+    battery.wake = SDL_CreateSemaphore(0);
+    if (battery.wake == NULL) {
+        log_err(MODULE, "Failed to create semaphore: %s", SDL_GetError());
+        battery_close();
+        return NULL;
+    }
+
+    battery.thread = SDL_CreateThread(battery_thread, "Battery", NULL);
+    if (battery.thread == NULL) {
+        log_err(MODULE, "Failed to create battery thread: %s", SDL_GetError());
+        battery_close();
+        return NULL;
+    }
+
+    log_info(MODULE, "Saving to '%s'", path);
+
+    return battery.data;
+}
+
+void
+battery_close() {
+    if (battery.thread != NULL) {
+        SDL_SemPost(battery.wake);
+        SDL_WaitThread(battery.thread, NULL);
+        battery.thread = NULL;
+    }
+    if (battery.wake != NULL) {
+        SDL_DestroySemaphore(battery.wake);
+        battery.wake = NULL;
+    }
+
+    if (battery.data != NULL) {
+        battery_flush();
+        os_unmap_file(battery.data, battery.size);
+        battery.data = NULL;
+    }
+
+    free(battery.dirty);
+    battery.dirty = NULL;
+    battery.pages = 0;
+}
+
+void
+battery_set_interval(unsigned int ms) {
+    SDL_AtomicSet(&battery.interval, ms);
+}
+
+void
+battery_write(size_t offset) {
+    SDL_atomic_t *page;
+
+    //most writes land on a page that's already waiting to be flushed, they don't need to pay for the exchange
+    page = &battery.dirty[offset / BATTERY_PAGE_SIZE];
+    if (SDL_AtomicGet(page) == 0) {
+        SDL_AtomicSet(page, 1);
+    }
+}
\ No newline at end of file
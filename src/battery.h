@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BATTERY_PAGE_SIZE       256         //writes are tracked and flushed in pages this big
+#define BATTERY_INTERVAL        1000        //default ms between background flushes
+
+void battery_init();
+void battery_free();
+
+//maps size bytes of the save file at path as battery backed RAM, creating the file if it doesn't exist, and starts
+//flushing written pages to disk in the background
+uint8_t * battery_open(const char *path, size_t size);
+
+//flushes every written page and unmaps the file
+void battery_close();
+
+void battery_set_interval(unsigned int ms);
+
+//runs on the emulation thread after every write to the RAM
+void battery_write(size_t offset);
+
+//waits until every page written so far is on disk
+bool battery_flush();
\ No newline at end of file
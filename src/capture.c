@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "log.h"
+#include "string.h"
+#include "capture.h"
+
+#define MODULE "Capture"
+
+#define CAPTURE_WIDTH   256
+#define CAPTURE_HEIGHT  240
+#define CAPTURE_SLOTS   8                   //frames the queue holds, about 2MB
+#define CAPTURE_BATCH   4                   //frames the writer gathers before writing them at once
+
+//the NES runs at 39375000 / 655171 frames a second
+#define CAPTURE_Y4M_HEADER  "YUV4MPEG2 W256 H240 F39375000:655171 Ip A1:1 C444\n"
+#define CAPTURE_Y4M_FRAME   "FRAME\n"
+
+//frames go through a single producer, single consumer ring from the emulation thread to the writer thread. the
+//semaphores are only there so neither side spins while it waits, the ring itself never takes a lock
+typedef struct {
+    capture_format_t format;
+    capture_policy_t policy;
+    char path[256];
+    FILE *f;
+    SDL_Thread *thread;
+
+    uint32_t *slots;                        //CAPTURE_SLOTS frames of CAPTURE_WIDTH x CAPTURE_HEIGHT ARGB8888
+    bool repeats[CAPTURE_SLOTS];            //the slot wasn't filled, it repeats the frame before
+    SDL_atomic_t head;                      //next slot filled by the emulation thread
+    SDL_atomic_t tail;                      //next slot emptied by the writer thread
+    SDL_sem *filled;                        //posted for every queued frame, and once more to close
+    SDL_sem *freed;                         //posted for every written frame
+    SDL_atomic_t closing;
+
+    uint8_t *batch;                         //converted frames waiting to be written
+    size_t batch_size;
+    uint8_t *last;                          //the last converted frame of the last batch written
+    size_t frame_size;                      //bytes of a converted frame
+
+    //emulation thread only
+    bool started;                           //a frame was queued, so there's one to repeat
+    unsigned int queued;
+    unsigned int dropped;
+    int max_depth;
+
+    //writer thread only, read after it's done
+    SDL_atomic_t written;
+    unsigned int files;
+    bool failed;
+} capture_t;
+
+static capture_t capture;
+
+void
+capture_init() {
+    memset(&capture, 0, sizeof(capture));
+}
+
+void
+capture_free() {
+    capture_close();
+}
+
+capture_format_t
+capture_find_format(const char *path) {
+    size_t len;
+
+    len = strlen(path);
+    if (len >= 4 && strcmp(path + len - 4, ".y4m") == 0) {
+        return CAPTURE_FORMAT_Y4M;
+    }
+    if (len >= 4 && strcmp(path + len - 4, ".ppm") == 0) {
+        return CAPTURE_FORMAT_PPM;
+    }
+
+    return CAPTURE_FORMAT_RGB;
+}
+
+static void
+capture_to_rgb(uint8_t *out, const uint32_t *in) {
+    int i;
+
+    for (i = 0; i < CAPTURE_WIDTH * CAPTURE_HEIGHT; i++) {
+        out[i * 3 + 0] = in[i] >> 16;
+        out[i * 3 + 1] = in[i] >> 8;
+        out[i * 3 + 2] = in[i];
+    }
+}
+
+//BT.601 studio swing, which is what ffmpeg assumes for Y4M
+static void
+capture_to_y4m(uint8_t *out, const uint32_t *in) {
+    uint8_t *y, *u, *v;
+    int i, r, g, b;
+
+    memcpy(out, CAPTURE_Y4M_FRAME, sizeof(CAPTURE_Y4M_FRAME) - 1);
+    y = out + sizeof(CAPTURE_Y4M_FRAME) - 1;
+    u = y + CAPTURE_WIDTH * CAPTURE_HEIGHT;
+    v = u + CAPTURE_WIDTH * CAPTURE_HEIGHT;
+
+    for (i = 0; i < CAPTURE_WIDTH * CAPTURE_HEIGHT; i++) {
+        r = (in[i] >> 16) & 0xFF;
+        g = (in[i] >> 8) & 0xFF;
+        b = in[i] & 0xFF;
+
+        y[i] = 16 + ((66 * r + 129 * g + 25 * b + 128) >> 8);
+        u[i] = 128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8);
+        v[i] = 128 + ((112 * r - 94 * g - 18 * b + 128) >> 8);
+    }
+}
+
+static void
+capture_write(FILE *f, const void *data, size_t size) {
+    if (!capture.failed && fwrite(data, 1, size, f) != size) {
+        log_err(MODULE, "Failed to write frames to '%s'", capture.path);
+        capture.failed = true;
+    }
+}
+
+static void
+capture_flush() {
+    if (capture.batch_size > 0) {
+        capture_write(capture.f, capture.batch, capture.batch_size);
+        memcpy(capture.last, capture.batch + capture.batch_size - capture.frame_size, capture.frame_size);
+        capture.batch_size = 0;
+    }
+}
+
+//the PPM path is handed to snprintf() as the format, so it may only hold one integer conversion for the frame number,
+//with flags and a width but no length, and %% for a literal %
+static bool
+capture_check_pattern(const char *path) {
+    int conversions = 0;
+
+    while (*path != '\0') {
+        if (*path++ != '%') {
+            continue;
+        }
+        if (*path == '%') {
+            path++;
+            continue;
+        }
+
+        while (*path != '\0' && strchr("-+ 0", *path) != NULL) {
+            path++;
+        }
+        while (*path >= '0' && *path <= '9') {
+            path++;
+        }
+        if (*path == '\0' || strchr("diuxX", *path) == NULL) {
+            return false;
+        }
+        path++;
+        conversions++;
+    }
+
+    return conversions == 1;
+}
+
+//in is NULL to write the last frame again
+static void
+capture_write_ppm(const uint32_t *in) {
+    char path[sizeof(capture.path) + 16], header[32];
+    FILE *f;
+    int len;
+
+    snprintf(path, sizeof(path), capture.path, capture.files++);
+
+    f = fopen(path, "wb");
+    if (f == NULL) {
+        if (!capture.failed) {
+            log_err(MODULE, "Failed to open '%s'", path);
+            capture.failed = true;
+        }
+        return;
+    }
+
+    len = sprintf(header, "P6\n%d %d\n255\n", CAPTURE_WIDTH, CAPTURE_HEIGHT);
+    memcpy(capture.batch, header, len);
+    if (in != NULL) {
+        capture_to_rgb(capture.batch + len, in);
+    }
+    capture_write(f, capture.batch, len + capture.frame_size);
+    fclose(f);
+}
+
+static void
+capture_convert(const uint32_t *slot) {
+    switch (capture.format) {
+        case CAPTURE_FORMAT_Y4M:
+            capture_to_y4m(capture.batch + capture.batch_size, slot);
+            capture.batch_size += capture.frame_size;
+            break;
+        case CAPTURE_FORMAT_RGB:
+            capture_to_rgb(capture.batch + capture.batch_size, slot);
+            capture.batch_size += capture.frame_size;
+            break;
+        case CAPTURE_FORMAT_PPM:
+            capture_write_ppm(slot);
+            break;
+    }
+}
+
+//copies the last converted frame rather than converting the same one again
+static void
+capture_repeat() {
+    const uint8_t *last;
+
+    if (capture.format == CAPTURE_FORMAT_PPM) {
+        capture_write_ppm(NULL);
+        return;
+    }
+
+    last = capture.batch_size > 0 ? capture.batch + capture.batch_size - capture.frame_size : capture.last;
+    memcpy(capture.batch + capture.batch_size, last, capture.frame_size);
+    capture.batch_size += capture.frame_size;
+}
+
+static int
+capture_thread(void *data) {
+    const uint32_t *slot;
+    int tail;
+
+    while (true) {
+        SDL_SemWait(capture.filled);
+
+        tail = SDL_AtomicGet(&capture.tail);
+        if (tail == SDL_AtomicGet(&capture.head)) {
+            if (SDL_AtomicGet(&capture.closing)) {
+                break;
+            }
+            continue;
+        }
+
+        SDL_MemoryBarrierAcquire();
+        slot = capture.slots + (tail % CAPTURE_SLOTS) * CAPTURE_WIDTH * CAPTURE_HEIGHT;
+
+        if (capture.repeats[tail % CAPTURE_SLOTS]) {
+            capture_repeat();
+        }
+        else {
+            capture_convert(slot);
+        }
+
+        //the slot is converted, hand it back before the slow part
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&capture.tail, tail + 1);
+        SDL_SemPost(capture.freed);
+        SDL_AtomicIncRef(&capture.written);
+
+        //write in batches while frames keep coming, but don't sit on frames when the queue runs dry
+        if (capture.batch_size >= CAPTURE_BATCH * capture.frame_size || tail + 1 == SDL_AtomicGet(&capture.head)) {
+            capture_flush();
+        }
+    }
+
+    capture_flush();
+
+    return 0;
+}
+
+bool
+capture_open(const char *path, capture_format_t format, capture_policy_t policy) {
+    capture_close();
+
+    if (format == CAPTURE_FORMAT_PPM && !capture_check_pattern(path)) {
+        log_err(MODULE, "'%s' needs exactly one integer conversion like %%05d for the frame number", path);
+        return false;
+    }
+
+    strlcpy(capture.path, path, sizeof(capture.path));
+    capture.format = format;
+    capture.policy = policy;
+    capture.started = false;
+    capture.queued = 0;
+    capture.dropped = 0;
+    capture.max_depth = 0;
+    capture.files = 0;
+    capture.failed = false;
+    SDL_AtomicSet(&capture.head, 0);
+    SDL_AtomicSet(&capture.tail, 0);
+    SDL_AtomicSet(&capture.written, 0);
+    SDL_AtomicSet(&capture.closing, 0);
+
+    capture.frame_size = CAPTURE_WIDTH * CAPTURE_HEIGHT * 3;
+    if (format == CAPTURE_FORMAT_Y4M) {
+        capture.frame_size += sizeof(CAPTURE_Y4M_FRAME) - 1;
+    }
+
+    capture.slots = malloc(CAPTURE_SLOTS * CAPTURE_WIDTH * CAPTURE_HEIGHT * sizeof(uint32_t));
+    capture.batch = malloc(CAPTURE_BATCH * capture.frame_size + 32);
+    capture.last = malloc(capture.frame_size);
+    if (capture.slots == NULL || capture.batch == NULL || capture.last == NULL) {
+        log_err(MODULE, "Out of memory");
+        capture_close();
+        return false;
+    }
+
+    if (format != CAPTURE_FORMAT_PPM) {
+        if (strcmp(path, "-") == 0) {
+            capture.f = stdout;
+        }
+        else {
+            capture.f = fopen(path, "wb");
+            if (capture.f == NULL) {
+                log_err(MODULE, "Failed to open '%s'", path);
+                capture_close();
+                return false;
+            }
+        }
+
+        //batches are already large, stdio buffering would only copy them again
+        setvbuf(capture.f, NULL, _IONBF, 0);
+
+        if (format == CAPTURE_FORMAT_Y4M) {
+            capture_write(capture.f, CAPTURE_Y4M_HEADER, sizeof(CAPTURE_Y4M_HEADER) - 1);
+        }
+    }
+
+    capture.filled = SDL_CreateSemaphore(0);
+    capture.freed = SDL_CreateSemaphore(0);
+    if (capture.filled == NULL || capture.freed == NULL) {
+        log_err(MODULE, "Failed to create semaphore: %s", SDL_GetError());
+        capture_close();
+        return false;
+    }
+
+    capture.thread = SDL_CreateThread(capture_thread, "Capture", NULL);
+    if (capture.thread == NULL) {
+        log_err(MODULE, "Failed to create capture thread: %s", SDL_GetError());
+        capture_close();
+        return false;
+    }
+
+    return true;
+}
+
+//writes out whatever is still queued
+void
+capture_close() {
+    capture_stats_t stats;
+
+    if (capture.thread != NULL) {
+        SDL_AtomicSet(&capture.closing, 1);
+        SDL_SemPost(capture.filled);
+        SDL_WaitThread(capture.thread, NULL);
+        capture.thread = NULL;
+
+        capture_get_stats(&stats);
+        log_info(MODULE, "Captured %u frames to '%s', %u dropped, queue peaked at %d of %d", stats.written, capture.path, stats.dropped, stats.max_depth, stats.size);
+    }
+
+    if (capture.f != NULL) {
+        if (capture.f != stdout) {
+            fclose(capture.f);
+        }
+        else {
+            fflush(capture.f);
+        }
+        capture.f = NULL;
+    }
+    if (capture.filled != NULL) {
+        SDL_DestroySemaphore(capture.filled);
+        capture.filled = NULL;
+    }
+    if (capture.freed != NULL) {
+        SDL_DestroySemaphore(capture.freed);
+        capture.freed = NULL;
+    }
+
+    free(capture.slots);
+    free(capture.batch);
+    free(capture.last);
+    capture.slots = NULL;
+    capture.batch = NULL;
+    capture.last = NULL;
+    capture.batch_size = 0;
+}
+
+//runs on the emulation thread, only copies the frame so the conversion and the writing stay off of it
+bool
+capture_frame(const void *frame, int pitch) {
+    uint32_t *slot;
+    int head, depth, y;
+
+    if (capture.thread == NULL || (frame == NULL && !capture.started)) {
+        return false;
+    }
+
+    head = SDL_AtomicGet(&capture.head);
+    while (head - SDL_AtomicGet(&capture.tail) == CAPTURE_SLOTS) {
+        if (capture.policy == CAPTURE_POLICY_DROP) {
+            capture.dropped++;
+            return false;
+        }
+
+        SDL_SemWait(capture.freed);
+    }
+
+    SDL_MemoryBarrierAcquire();
+    capture.repeats[head % CAPTURE_SLOTS] = frame == NULL;
+    if (frame != NULL) {
+        slot = capture.slots + (head % CAPTURE_SLOTS) * CAPTURE_WIDTH * CAPTURE_HEIGHT;
+        for (y = 0; y < CAPTURE_HEIGHT; y++) {
+            memcpy(slot + y * CAPTURE_WIDTH, (const uint8_t *)frame + y * pitch, CAPTURE_WIDTH * sizeof(uint32_t));
+        }
+    }
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&capture.head, head + 1);
+    SDL_SemPost(capture.filled);
+
+    capture.started = true;
+    capture.queued++;
+    depth = head + 1 - SDL_AtomicGet(&capture.tail);
+    if (depth > capture.max_depth) {
+        capture.max_depth = depth;
+    }
+
+    return true;
+}
+
+void
+capture_get_stats(capture_stats_t *stats) {
+    stats->queued = capture.queued;
+    stats->written = SDL_AtomicGet(&capture.written);
+    stats->dropped = capture.dropped;
+    stats->depth = SDL_AtomicGet(&capture.head) - SDL_AtomicGet(&capture.tail);
+    stats->max_depth = capture.max_depth;
+    stats->size = CAPTURE_SLOTS;
+}
\ No newline at end of file
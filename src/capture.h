@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+
+typedef enum {
+    CAPTURE_FORMAT_Y4M,                     //YUV4MPEG2 4:4:4 stream, what ffmpeg reads from a pipe
+    CAPTURE_FORMAT_RGB,                     //raw RGB24 frames back to back
+    CAPTURE_FORMAT_PPM                      //one numbered PPM per frame, the path is a printf pattern with exactly one integer conversion like "frame%05d.ppm"
+} capture_format_t;
+
+typedef enum {
+    CAPTURE_POLICY_DROP,                    //a frame that doesn't fit in the queue is dropped
+    CAPTURE_POLICY_BLOCK                    //the emulation waits for the writer to make room
+} capture_policy_t;
+
+typedef struct {
+    unsigned int queued;
+    unsigned int written;
+    unsigned int dropped;
+    int depth;                              //frames waiting in the queue right now
+    int max_depth;                          //most frames that were ever waiting
+    int size;                               //frames the queue holds
+} capture_stats_t;
+
+void capture_init();
+void capture_free();
+
+//"-" writes to stdout
+bool capture_open(const char *path, capture_format_t format, capture_policy_t policy);
+void capture_close();
+
+capture_format_t capture_find_format(const char *path);
+
+//queues a 256x240 ARGB8888 frame, returns false if it was dropped. a NULL frame repeats the one before without copying it
+bool capture_frame(const void *frame, int pitch);
+
+void capture_get_stats(capture_stats_t *stats);
\ No newline at end of file
@@ -5,42 +5,45 @@
 #include "log.h"
 #include "cpu.h"
 #include "ppu.h"
+#include "os.h"
+#include "string.h"
+#include "battery.h"
+#include "archive.h"
+#include "image.h"
+#include "mapper.h"
 #include "cartridge.h"
 
 #define MODULE "Cartridge"
 
 #define CARTRIDGE_HEADER_SIZE 16
 
+//indexed by mapper number
+static const mapper_t * const mappers[] = {
+    &mapper0,
+    &mapper1,
+    NULL,
+    &mapper3,
+    &mapper4
+};
+
 typedef struct {
-    int mapper;
-    unsigned char *data;
+    int number;
+    const unsigned char *data;      //the ROM image, never written to
+    const image_t *image;           //data's reference in the image cache, NULL if the caller lent it to us
     unsigned int prg_size;
-    unsigned char *prg;     //pointer to the PRG section of data, do not free me
+    const unsigned char *prg;       //pointer to the PRG section of data, do not free me
     unsigned int chr_size;
-    unsigned char *chr;     //pointer to the CHR section data.. need to free if i'm CHR ram
+    unsigned char *chr;     //pointer to the CHR section of data, or allocated if i'm CHR ram. only written to when i'm CHR ram
     bool chr_is_ram;
     unsigned int prg_ram_size;
-    unsigned char *prg_ram;
-    uint32_t prg_map[4];
-    uint32_t chr_map[8];
+    unsigned char *prg_ram;         //mapped from the save file if i'm battery backed
+    bool battery;
+    const unsigned char *prg_banks[4];      //8KB banks at $8000-$FFFF, pointers into prg
+    unsigned char *chr_banks[8];            //1KB banks at $0000-$1FFF, pointers into chr
+    unsigned int generation;                //bumped whenever a bank is mapped somewhere else
     bool nes_test;
-    struct {
-        int write_n;
-        uint8_t register_tmp;
-        uint8_t registers[4];
-    } mapper1;
-    struct {
-        bool prg_size_16k;
-        uint8_t registers[1];
-    } mapper3;
-    struct {
-        uint8_t register8000;
-        uint8_t registers[8];
-        bool horizontal_mirroring;
-        uint8_t irq_period;
-        uint8_t irq_counter;
-        bool irq_enabled;
-    } mapper4;
+    const mapper_t *mapper;
+    mapper_state_t state;
 } cartridge_t;
 
 static cartridge_t cartridge;
@@ -50,12 +53,14 @@ cartridge_init() {
     memset(&cartridge, 0, sizeof(cartridge));
 }
 
-void 
-cartridge_free() {
-    if (cartridge.data != NULL) {
-        free(cartridge.data);
+static void
+cartridge_release() {
+    //other cartridges can still be reading the image, the last one to let go frees it
+    image_release(cartridge.image);
+    if (cartridge.battery) {
+        battery_close();
     }
-    if (cartridge.prg_ram != NULL) {
+    else if (cartridge.prg_ram != NULL) {
         free(cartridge.prg_ram);
     }
     if (cartridge.chr_is_ram && cartridge.chr != NULL) {
@@ -63,194 +68,178 @@ cartridge_free() {
     }
 }
 
+void 
+cartridge_free() {
+    cartridge_release();
+}
+
 bool
 cartridge_is_nes_test() {
     return cartridge.nes_test;
 }
 
-static void
+void
 cartridge_map_prg(int page_kbs, int slot, int bank) {
-    int i;
+    const unsigned char *data;
+    int i, page;
 
     if (bank < 0) {
         bank = (cartridge.prg_size / (0x400 * page_kbs)) + bank;
     }
 
     for (i = 0; i < page_kbs / 8; i++) {
-        cartridge.prg_map[(page_kbs / 8) * slot + i] = (page_kbs * 0x400 * bank + 0x2000 * i) % cartridge.prg_size;
+        page = (page_kbs / 8) * slot + i;
+        data = cartridge.prg + (page_kbs * 0x400 * bank + 0x2000 * i) % cartridge.prg_size;
+
+        if (cartridge.prg_banks[page] != data) {
+            cartridge.prg_banks[page] = data;
+            cartridge.generation++;
+        }
     }
 }
 
-static void
+void
 cartridge_map_chr(int page_kbs, int slot, int bank) {
-    int i;
+    unsigned char *data;
+    int i, page;
 
     for (i = 0; i < page_kbs; i++) {
-        cartridge.chr_map[page_kbs * slot + i] = (page_kbs * 0x400 * bank + 0x400 * i) % cartridge.chr_size;
-    }
-}
+        page = page_kbs * slot + i;
+        data = cartridge.chr + (page_kbs * 0x400 * bank + 0x400 * i) % cartridge.chr_size;
 
-static void
-cartridge_apply_mapper1() {
-    //PRG
-    if (cartridge.mapper1.registers[0] & 0b1000) {
-        //16KB PRG
-        if (cartridge.mapper1.registers[0] & 0b100) {
-            cartridge_map_prg(16, 0, cartridge.mapper1.registers[3] & 0xF);
-            cartridge_map_prg(16, 1, 0xF);
-        }
-        else {
-            cartridge_map_prg(16, 0, 0);
-            cartridge_map_prg(16, 1, cartridge.mapper1.registers[3] & 0xF);
+        if (cartridge.chr_banks[page] != data) {
+            cartridge.chr_banks[page] = data;
+            cartridge.generation++;
+            ppu_set_chr_page(page, data);
         }
     }
-    else {
-        //32KB PRG
-        cartridge_map_prg(32, 0, (cartridge.mapper1.registers[3] & 0xF) >> 1);
-    }
+}
 
-    //CHR
-    if (cartridge.mapper1.registers[0] & 0b10000) {
-        //4KB CHR
-        cartridge_map_chr(4, 0, cartridge.mapper1.registers[1]);
-        cartridge_map_chr(4, 1, cartridge.mapper1.registers[2]);
-    }
-    else {
-        //8KB CHR
-        cartridge_map_chr(8, 0, cartridge.mapper1.registers[1] >> 1);
-    }
-
-    //mirroring
-    switch (cartridge.mapper1.registers[0] & 0b11) {
-        case 2:
-            ppu_set_mirroring(PPU_MIRRORING_VERTICAL);
-            break;
-        case 3:
-            ppu_set_mirroring(PPU_MIRRORING_HORIZONTAL);
-            break;
-        default:
-            log_err(MODULE, "Error setting mirroring for mapper 1: Invalid register value %u (%u)", cartridge.mapper1.registers[0], cartridge.mapper1.registers[0] & 0b11);
-            break;
-    }
+unsigned int
+cartridge_get_generation() {
+    return cartridge.generation;
 }
 
-static void
-cartridge_apply_mapper3() {
-    if (cartridge.mapper3.prg_size_16k) {
-        cartridge_map_prg(16, 0, 0);
-        cartridge_map_prg(16, 1, 0);
-    }
-    else {
-        cartridge_map_prg(16, 0, 0);
-        cartridge_map_prg(16, 1, 1);
-    }
+const unsigned char * const *
+cartridge_get_prg_banks() {
+    return cartridge.prg_banks;
+}
 
-    cartridge_map_chr(8, cartridge.mapper3.registers[0] & 0b11, 0);
+mapper_state_t *
+cartridge_get_mapper_state() {
+    return &cartridge.state;
 }
 
+//the ROM's path with a .sav extension
 static void
-cartridge_apply_mapper4() {
-    int i;
-
-    cartridge_map_prg(8, 1, cartridge.mapper4.registers[7]);
+cartridge_get_save_path(char *save_path, size_t size, const char *path) {
+    char *end, *extension, *c;
 
-    if (!(cartridge.mapper4.register8000 & 1 << 6)) {
-        //PRG mode 0
-        cartridge_map_prg(8, 0, cartridge.mapper4.registers[6]);
-        cartridge_map_prg(8, 2, -2);
-    }
-    else {
-        //PRG mode 
-        cartridge_map_prg(8, 2, -2);
-        cartridge_map_prg(8, 0, cartridge.mapper4.registers[6]);
-    }
+    //leaves room for the extension
+    strlcpy(save_path, path, size - 4);
 
-    if (!(cartridge.mapper4.register8000 & (1 << 7))) {
-        //CHR mode 0
-        cartridge_map_chr(2, 0, cartridge.mapper4.registers[0] >> 1);
-        cartridge_map_chr(2, 1, cartridge.mapper4.registers[1] >> 1);
-        for (i = 0; i < 4; i++) {
-            cartridge_map_chr(1, 4 + i, cartridge.mapper4.registers[2 + i]);
+    //a ROM in an archive saves next to the archive, its directory in the archive is part of the name
+    c = strrchr(save_path, '#');
+    for (; c != NULL && *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') {
+            *c = '_';
         }
     }
-    else {
-        //CHR mode 1
-        for (i = 0; i < 4; i++) {
-            cartridge_map_chr(1, i, cartridge.mapper4.registers[2 + i]);
-        }
-        cartridge_map_chr(2, 2, cartridge.mapper4.registers[0] >> 1);
-        cartridge_map_chr(2, 3, cartridge.mapper4.registers[1] >> 1);
+
+    end = save_path + strlen(save_path);
+    extension = strrchr(save_path, '.');
+    if (extension != NULL && strpbrk(extension, "/\\") == NULL) {
+        end = extension;
     }
 
-    ppu_set_mirroring(cartridge.mapper4.horizontal_mirroring ? PPU_MIRRORING_HORIZONTAL : PPU_MIRRORING_VERTICAL);
+    strlcpy(end, ".sav", 5);
 }
 
-//TODO: Handle reloading cartridges
 bool
-cartridge_load(const char *path) {
+cartridge_read_info(const void *data, size_t size, cartridge_info_t *info) {
+    const unsigned char *header = data;
     unsigned int data_size;
-    bool trainer;
-    char header[CARTRIDGE_HEADER_SIZE];
-    bool success = false;
-    size_t count;
-    FILE *f;
-
-    log_info(MODULE, "Loading ROM %s", path);
 
-    f = fopen(path, "rb");
-    if (f == NULL) {
-        log_err(MODULE, "Error opening ROM: %s", strerror(errno));
+    if (size < CARTRIDGE_HEADER_SIZE) {
+        log_err(MODULE, "Error reading ROM: Tried to read %d bytes for the file's header but only read %zu", CARTRIDGE_HEADER_SIZE, size);
         return false;
     }
 
-    count = fread(header, sizeof(char), sizeof(header), f);
-    if (count != sizeof(header)) {
-        log_err(MODULE, "Error reading ROM: Tried to read %zu bytes for the file's header but only read %zu", sizeof(header), count);
-        goto done;
-    }
-
     if (memcmp(header, "NES\x1A", 4) != 0) {
         log_err(MODULE, "Error reading ROM: Not a valid iNES format");
-        goto done;
+        return false;
     }
 
     if ((header[7] & 0x0C) == 0x08) {
         log_err(MODULE, "Error reading ROM: iNES version 2 not supported");
-        goto done;
+        return false;
     }
 
     //header[4] is the number of 16KB blocks of PRG ROM
-    cartridge.prg_size = header[4] * 0x4000;
+    info->prg_size = header[4] * 0x4000;
 
     //header[5] is the number of 8KB blocks of CHR ROM
-    cartridge.chr_size = header[5] * 0x2000;
+    info->chr_size = header[5] * 0x2000;
 
     //if a trainer is present, then the data is a 512 byte block between the header and the PRG ROM
-    trainer = (header[6] >> 3) & 0x01;
+    info->trainer = (header[6] >> 3) & 0x01;
+    info->prg_offset = CARTRIDGE_HEADER_SIZE + (info->trainer ? 512 : 0);
 
-    cartridge.mapper = (header[7] & 0xF0) | (header[6] >> 4);
+    info->mapper = (header[7] & 0xF0) | (header[6] >> 4);
 
-    //PRG RAM size, if any exists
-    cartridge.prg_ram_size = header[8];
+    //PRG RAM is kept alive by a battery
+    info->battery = (header[6] >> 1) & 0x01;
 
-    log_info(MODULE, "Mapper %d, PRG Size: %d, CHR Size: %d, Trainer: %s, PRG RAM Size; %d", cartridge.mapper, cartridge.prg_size, cartridge.chr_size, trainer ? "Yes" : "No", cartridge.prg_ram_size);
+    //header[8] is the number of 8KB blocks of PRG RAM, 0 means 1 for compatibility with the dumps that never set it
+    info->prg_ram_size = (header[8] ? header[8] : 1) * 0x2000;
 
-    data_size = CARTRIDGE_HEADER_SIZE + (trainer ? 512 : 0) + cartridge.prg_size + cartridge.chr_size;
-    cartridge.data = malloc(data_size);
-    if (cartridge.data == NULL) {
-        log_err(MODULE, "Failed to allocate %u bytes for data storage", data_size);
-        goto done;
+    data_size = info->prg_offset + info->prg_size + info->chr_size;
+    if (size < data_size) {
+        log_err(MODULE, "Tried to read %u bytes but only read %zu", data_size, size);
+        return false;
     }
 
-    rewind(f);
-    count = fread(cartridge.data, sizeof(uint8_t), data_size, f);
-    if (count != data_size) {
-        log_err(MODULE, "Tried to read %zu bytes but only read %zu", data_size, count);
+    return true;
+}
+
+bool
+cartridge_is_supported(int mapper) {
+    return mapper < (int)(sizeof(mappers) / sizeof(mappers[0])) && mappers[mapper] != NULL;
+}
+
+//TODO: Handle reloading cartridges
+//image is the cache's reference to data, NULL if it's borrowed. path is where the image came from, NULL if it came
+//from memory
+static bool
+cartridge_load_image(const unsigned char *data, size_t size, const image_t *image, unsigned int flags, const char *path) {
+    char save_path[256];
+    cartridge_info_t info;
+    bool success = false;
+
+    //from here on cartridge_unload() drops the reference
+    cartridge.data = data;
+    cartridge.image = image;
+
+    if (!cartridge_read_info(data, size, &info)) {
         goto done;
     }
 
-    if (cartridge.prg_ram_size > 0) {
-        cartridge.prg_ram = malloc(cartridge.prg_ram_size);
+    cartridge.number = info.mapper;
+    cartridge.prg_size = info.prg_size;
+    cartridge.chr_size = info.chr_size;
+    cartridge.prg_ram_size = info.prg_ram_size;
+
+    log_info(MODULE, "Mapper %d, PRG Size: %d, CHR Size: %d, Trainer: %s, PRG RAM Size; %d, Battery: %s", cartridge.number, cartridge.prg_size, cartridge.chr_size, info.trainer ? "Yes" : "No", cartridge.prg_ram_size, info.battery ? "Yes" : "No");
+
+    //battery backed RAM is the save file next to the ROM, an image from memory has nowhere to save to
+    if (info.battery && path != NULL && !(flags & CARTRIDGE_LOAD_NO_SAVE) && cartridge.prg_ram_size > 0) {
+        cartridge_get_save_path(save_path, sizeof(save_path), path);
+        cartridge.prg_ram = battery_open(save_path, cartridge.prg_ram_size);
+        cartridge.battery = cartridge.prg_ram != NULL;
+    }
+
+    if (cartridge.prg_ram == NULL && cartridge.prg_ram_size > 0) {
+        cartridge.prg_ram = calloc(1, cartridge.prg_ram_size);
         if (cartridge.prg_ram == NULL) {
             log_err(MODULE, "Failed to allocate %u bytes for PRG RAM", cartridge.prg_ram_size);
             goto done;
@@ -258,45 +247,32 @@ cartridge_load(const char *path) {
     }
 
     //set pointers to specific data regions
-    cartridge.prg = cartridge.data + CARTRIDGE_HEADER_SIZE + (trainer ? 512 : 0);
+    cartridge.prg = cartridge.data + info.prg_offset;
 
     if (cartridge.chr_size > 0) {
-        cartridge.chr = cartridge.prg + cartridge.prg_size;
+        //the PPU only reads through its pages, writes to CHR ROM are dropped in cartridge_write_chr()
+        cartridge.chr = (unsigned char *)cartridge.prg + cartridge.prg_size;
     }
     else {
         cartridge.chr_size = 0x2000;
         cartridge.chr = malloc(0x2000);
+        if (cartridge.chr == NULL) {
+            log_err(MODULE, "Failed to allocate %u bytes for CHR RAM", cartridge.chr_size);
+            goto done;
+        }
         cartridge.chr_is_ram = true;
     }
 
-    switch (cartridge.mapper) {
-        case 0:            
-            cartridge_map_prg(32, 0, 0);
-            cartridge_map_chr(8, 0, 0);
-
-            ppu_set_mirroring(header[6] & 0x01 ? PPU_MIRRORING_VERTICAL : PPU_MIRRORING_HORIZONTAL);
-            break;
-        case 1:
-            cartridge.mapper1.registers[0] = 0x0C;
-            cartridge_apply_mapper1();
-            break;
-        case 3:
-            cartridge.mapper3.prg_size_16k = header[4] == 1;
-            ppu_set_mirroring(header[6] & 0x01 ? PPU_MIRRORING_VERTICAL : PPU_MIRRORING_HORIZONTAL);
-            cartridge_apply_mapper3();
-            break;
-        case 4:
-            cartridge.mapper4.horizontal_mirroring = true;
-            cartridge_map_prg(8, 3, -1);
-            cartridge_apply_mapper4();
-            break;
-        default:
-            log_err(MODULE, "Mapper %d not supported", cartridge.mapper);
-            goto done;
-            break;
+    if (!cartridge_is_supported(cartridge.number)) {
+        log_err(MODULE, "Mapper %d not supported", cartridge.number);
+        goto done;
     }
 
-    cartridge.nes_test = strstr(path, "nestest.nes") != NULL;
+    cartridge.mapper = mappers[cartridge.number];
+    cartridge.mapper->reset(&cartridge.state, cartridge.data);
+    cpu_set_mapper(cartridge.number);
+
+    cartridge.nes_test = (flags & CARTRIDGE_LOAD_TEST) != 0;
     if (cartridge.nes_test) {
         log_info(MODULE, "Using test cartridge");
     }
@@ -309,166 +285,156 @@ done:
         cartridge_unload();
     }
 
-    fclose(f);
-
     return success;
 }
 
-void
-cartridge_unload() {
-    if (cartridge.data != NULL) {
-        free(cartridge.data);
+bool
+cartridge_load_memory(const void *data, size_t size, unsigned int flags) {
+    const image_t *image;
+    uint8_t *extracted;
+    size_t extracted_size;
+
+    log_info(MODULE, "Loading ROM from %zu bytes in memory", size);
+
+    //a compressed ROM is decompressed into its own buffer, the caller's is left alone
+    if (archive_is_archive(data, size)) {
+        if (!archive_extract(data, size, NULL, &extracted, &extracted_size)) {
+            return false;
+        }
+        image = image_add(extracted, extracted_size, IMAGE_STORAGE_ALLOCATED, NULL, 0, 0);
     }
-    if (cartridge.prg_ram != NULL) {
-        free(cartridge.prg_ram);
+    else if (flags & CARTRIDGE_LOAD_COPY) {
+        //only copied if no other cartridge has the same ROM already
+        image = image_add(data, size, IMAGE_STORAGE_COPY, NULL, 0, 0);
     }
-    if (cartridge.chr_is_ram && cartridge.chr != NULL) {
-        free(cartridge.chr);
+    else {
+        return cartridge_load_image(data, size, NULL, flags, NULL);
     }
 
-    memset(&cartridge, 0, sizeof(cartridge));
+    if (image == NULL) {
+        return false;
+    }
+
+    return cartridge_load_image(image->data, image->size, image, flags, NULL);
 }
 
-uint8_t
-cartridge_read(uint16_t address) {
-    switch (cartridge.mapper) {
-        case 0:
-        case 1:
-        case 3:
-        case 4:
-            if (address >= 0x8000) {
-                return cartridge.prg[cartridge.prg_map[(address - 0x8000) / 0x2000] + ((address - 0x8000) % 0x2000)];
-            }
+bool
+cartridge_load(const char *path, unsigned int flags) {
+    char archive_path[256];
+    const char *file = path, *name = NULL;
+    const image_t *image;
+    os_file_info_t info;
+    const void *data;
+    uint8_t *extracted;
+    size_t size, extracted_size;
+    bool success;
 
-            return cartridge.prg_ram[address - 0x6000];
+    log_info(MODULE, "Loading ROM %s", path);
 
-            break;
+    //archive.zip#name.nes is the ROM called name.nes in archive.zip
+    success = os_get_file_info(path, &info);
+    if (!success && strrchr(path, '#') != NULL) {
+        strlcpy(archive_path, path, sizeof(archive_path));
+        *strrchr(archive_path, '#') = '\0';
+        file = archive_path;
+        name = strrchr(path, '#') + 1;
+        success = os_get_file_info(file, &info);
     }
-    
-    return 0;
+
+    if (!success) {
+        log_err(MODULE, "Error opening ROM: %s", strerror(errno));
+        return false;
+    }
+
+    //a file that hasn't changed since a cartridge loaded it is shared without reading it again
+    image = image_find_file(path, info.size, info.mtime);
+    if (image == NULL) {
+        //PRG and CHR ROM are read straight out of the page cache, only the RAM the cartridge has is allocated
+        data = os_map_file(file, &size);
+        if (data == NULL) {
+            log_err(MODULE, "Error opening ROM: %s", strerror(errno));
+            return false;
+        }
+
+        //a compressed ROM is decompressed once, straight into the buffer the cache keeps
+        if (name != NULL || archive_is_archive(data, size)) {
+            success = archive_extract(data, size, name, &extracted, &extracted_size);
+            os_unmap_file(data, size);
+            if (!success) {
+                return false;
+            }
+            image = image_add(extracted, extracted_size, IMAGE_STORAGE_ALLOCATED, path, info.size, info.mtime);
+        }
+        else {
+            //the mapping is already private to us, copying it would only cost memory
+            image = image_add(data, size, IMAGE_STORAGE_MAPPED, path, info.size, info.mtime);
+        }
+
+        if (image == NULL) {
+            return false;
+        }
+    }
+    else {
+        log_info(MODULE, "Sharing the image already loaded from %s", path);
+    }
+
+    return cartridge_load_image(image->data, image->size, image, flags, path);
+}
+
+void
+cartridge_unload() {
+    unsigned int generation;
+
+    cartridge_release();
+
+    //the next cartridge starts from a new generation, a cache can't take its banks for the last one's
+    generation = cartridge.generation;
+    memset(&cartridge, 0, sizeof(cartridge));
+    cartridge.generation = generation + 1;
 }
 
 uint8_t
-cartridge_read_chr(uint16_t address) {
-    switch (cartridge.mapper) {
-        case 0:
-        case 1:
-        case 3:
-        case 4:
-            return cartridge.chr[cartridge.chr_map[address / 0x400] + (address % 0x400)];
+cartridge_read(uint16_t address) {
+    if (address >= 0x8000) {
+        return cartridge.prg_banks[(address >> 13) & 0x03][address & 0x1FFF];
+    }
+    if (address >= 0x6000 && cartridge.prg_ram != NULL) {
+        return cartridge.prg_ram[address - 0x6000];
     }
 
     return 0;
 }
 
+uint8_t
+cartridge_read_chr(uint16_t address) {
+    return cartridge.chr_banks[address >> 10][address & 0x3FF];
+}
+
 void
 cartridge_write(uint16_t address, uint8_t value) {
-    switch (cartridge.mapper) {
-        case 0:
-            //mapper 0 is read only
-            break;
-        case 1:
-            if (address < 0x8000) {
-                cartridge.prg_ram[address - 0x6000] = value;
-            }
-            else if (address & 0x8000) {
-                if (value & 0x80) {
-                    cartridge.mapper1.write_n = 0;
-                    cartridge.mapper1.register_tmp = 0;
-                    cartridge.mapper1.registers[0] |= 0x0C;
-                    cartridge_apply_mapper1();
-                }
-                else {
-                    cartridge.mapper1.register_tmp = ((value & 1) << 4) | (cartridge.mapper1.register_tmp >> 1);
-                    if (++cartridge.mapper1.write_n == 5) {
-                        cartridge.mapper1.registers[(address >> 13) & 0xb11] = cartridge.mapper1.register_tmp;
-                        cartridge.mapper1.write_n = 0;
-                        cartridge.mapper1.register_tmp = 0;
-                        cartridge_apply_mapper1();
-                    }
-                }
-            }
-
-            break;
-        case 3:
-            if (address & 0x8000) {
-                cartridge.mapper3.registers[0] = value;
-                cartridge_apply_mapper3();
-            }
-
-            break;
-        case 4:
-            if (address < 0x8000) {
-                cartridge.prg_ram[address - 0x6000] = value;
-            }
-            else if (address & 0x8000) {
-                switch (address & 0xE001) {
-                    case 0x8000:
-                        cartridge.mapper4.register8000 = value;
-                        break;
-                    case 0x8001:
-                        cartridge.mapper4.registers[cartridge.mapper4.register8000 & 0b111] = value;
-                        break;
-                    case 0xA000:
-                        cartridge.mapper4.horizontal_mirroring = value & 1;
-                        break;
-                    case 0xC000:
-                        cartridge.mapper4.irq_period = value;
-                        break;
-                    case 0xC001:
-                        cartridge.mapper4.irq_counter = 0;
-                        break;
-                    case 0xE000:
-                        cpu_set_irq();
-                        break;
-                    case 0xE001:
-                        cartridge.mapper4.irq_enabled = true;
-                        break;
-                    default:
-                        log_err(MODULE, "Error writing to mapper4 address 0x%04X: Unhandled address", address);
-                        break;
-                }
-
-                cartridge_apply_mapper4();
-            }
+    if (address >= 0x8000) {
+        cartridge.mapper->write(&cartridge.state, address, value);
+    }
+    else if (address >= 0x6000 && cartridge.prg_ram != NULL) {
+        cartridge.prg_ram[address - 0x6000] = value;
 
-            break;
+        if (cartridge.battery) {
+            battery_write(address - 0x6000);
+        }
     }
 }
 
 void
 cartridge_write_chr(uint16_t address, uint8_t value) {
-    switch (cartridge.mapper) {
-        case 0:
-            //mapper 0 is read only
-            break;
-        case 1:
-        case 3:
-        case 4:
-            cartridge.chr[address] = value;
-            break;
+    //CHR ROM is mapped read only
+    if (cartridge.chr_is_ram) {
+        cartridge.chr[address] = value;
     }
 }
 
 void
 cartridge_signal_scanline() {
-    switch (cartridge.mapper) {
-        case 0:
-        case 1:
-        case 3:
-            break;
-        case 4:
-            if (cartridge.mapper4.irq_counter == 0) {
-                cartridge.mapper4.irq_counter = cartridge.mapper4.irq_period;
-            }
-            else {
-                --cartridge.mapper4.irq_counter;
-            }
-
-            if (cartridge.mapper4.irq_enabled && cartridge.mapper4.irq_counter == 0) {
-                cpu_set_irq();
-            }
-
-            break;
+    if (cartridge.mapper->signal_scanline != NULL) {
+        cartridge.mapper->signal_scanline(&cartridge.state);
     }
 }
\ No newline at end of file
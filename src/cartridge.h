@@ -1,20 +1,46 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+//flags for cartridge_load() and cartridge_load_memory()
+#define CARTRIDGE_LOAD_COPY     (1 << 0)    //share the image through the cache, copied if it's new, otherwise it's borrowed and has to outlive the cartridge
+#define CARTRIDGE_LOAD_TEST     (1 << 1)    //run nestest.nes in automation mode, the CPU starts at $C000 and traces every instruction
+#define CARTRIDGE_LOAD_NO_SAVE  (1 << 2)    //battery backed RAM starts cleared and isn't saved, so every run starts the same
+
+//what an iNES header says about a ROM image
+typedef struct {
+    int mapper;
+    unsigned int prg_offset;                //where PRG ROM starts in the image, after the header and trainer
+    unsigned int prg_size;
+    unsigned int chr_size;                  //0 when the cartridge has CHR RAM instead
+    unsigned int prg_ram_size;
+    bool trainer;
+    bool battery;
+} cartridge_info_t;
+
 void cartridge_init();
 void cartridge_free();
 
 bool cartridge_is_nes_test();
 
-bool cartridge_load(const char *path);
+bool cartridge_load(const char *path, unsigned int flags);
+bool cartridge_load_memory(const void *data, size_t size, unsigned int flags);
 void cartridge_unload();
 
+//reads the header of an image with the rules cartridge_load() uses, false if it couldn't be loaded
+bool cartridge_read_info(const void *data, size_t size, cartridge_info_t *info);
+bool cartridge_is_supported(int mapper);
+
 uint8_t cartridge_read(uint16_t address);
 uint8_t cartridge_read_chr(uint16_t address);
 
 void cartridge_write(uint16_t address, uint8_t value);
 void cartridge_write_chr(uint16_t address, uint8_t value);
 
-void cartridge_signal_scanline();
\ No newline at end of file
+void cartridge_signal_scanline();
+
+//changes whenever a PRG or CHR bank is remapped, anything caching what it read from the cartridge compares it to
+//know the cache is stale
+unsigned int cartridge_get_generation();
\ No newline at end of file
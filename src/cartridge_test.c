@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "log.h"
+#include "cartridge.h"
+#include "cartridge_test.h"
+
+#define MODULE "CRTT"
+
+#define CARTRIDGE_TEST_PRG_BANKS    8           //16KB banks
+#define CARTRIDGE_TEST_CHR_BANKS    4           //4KB banks
+#define CARTRIDGE_TEST_SIZE         (16 + CARTRIDGE_TEST_PRG_BANKS * 0x4000 + CARTRIDGE_TEST_CHR_BANKS * 0x1000)
+
+typedef struct {
+    uint8_t *image;
+} cartridge_test_t;
+
+static cartridge_test_t cartridge_test;
+
+void
+cartridge_test_init() {
+    memset(&cartridge_test, 0, sizeof(cartridge_test));
+}
+
+void
+cartridge_test_free() {
+    free(cartridge_test.image);
+}
+
+//an iNES image for mapper whose every PRG and CHR bank is filled with its own number
+static bool
+cartridge_test_build(int mapper) {
+    uint8_t *data;
+    int i;
+
+    cartridge_test.image = realloc(cartridge_test.image, CARTRIDGE_TEST_SIZE);
+    if (cartridge_test.image == NULL) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+
+    data = cartridge_test.image;
+    memset(data, 0, 16);
+    memcpy(data, "NES\x1A", 4);
+    data[4] = CARTRIDGE_TEST_PRG_BANKS;
+    data[5] = CARTRIDGE_TEST_CHR_BANKS / 2;
+    data[6] = (mapper & 0x0F) << 4;
+    data[7] = mapper & 0xF0;
+    data += 16;
+
+    for (i = 0; i < CARTRIDGE_TEST_PRG_BANKS; i++) {
+        memset(data + i * 0x4000, i, 0x4000);
+    }
+    data += CARTRIDGE_TEST_PRG_BANKS * 0x4000;
+
+    for (i = 0; i < CARTRIDGE_TEST_CHR_BANKS; i++) {
+        memset(data + i * 0x1000, i, 0x1000);
+    }
+
+    return true;
+}
+
+static bool
+cartridge_test_expect(const char *what, int value, int expected) {
+    if (value != expected) {
+        log_err(MODULE, "%s is bank %d instead of %d", what, value, expected);
+        return false;
+    }
+
+    return true;
+}
+
+//remapping a bank has to change the generation, mapping the same one again must not
+static bool
+cartridge_test_generation(const char *what, unsigned int before, bool changed) {
+    if ((cartridge_get_generation() != before) != changed) {
+        log_err(MODULE, "%s %s the generation", what, changed ? "doesn't change" : "changes");
+        return false;
+    }
+
+    return true;
+}
+
+//MMC1 takes a register 1 bit at a time, the fifth write picks the register from its address
+static void
+cartridge_test_mmc1_write(uint16_t address, uint8_t value) {
+    int i;
+
+    for (i = 0; i < 5; i++) {
+        cartridge_write(address, (value >> i) & 1);
+    }
+}
+
+static bool
+cartridge_test_mmc1() {
+    unsigned int generation;
+    bool success = true;
+
+    if (!cartridge_test_build(1) || !cartridge_load_memory(cartridge_test.image, CARTRIDGE_TEST_SIZE, 0)) {
+        return false;
+    }
+
+    //4KB CHR, 16KB PRG with the last bank fixed at $C000, vertical mirroring
+    cartridge_test_mmc1_write(0x8000, 0x1E);
+    success &= cartridge_test_expect("MMC1 $C000", cartridge_read(0xC000), CARTRIDGE_TEST_PRG_BANKS - 1);
+
+    cartridge_test_mmc1_write(0xA000, 2);
+    success &= cartridge_test_expect("MMC1 CHR $0000 after writing $A000", cartridge_read_chr(0x0000), 2);
+
+    cartridge_test_mmc1_write(0xC000, 3);
+    success &= cartridge_test_expect("MMC1 CHR $1000 after writing $C000", cartridge_read_chr(0x1000), 3);
+
+    generation = cartridge_get_generation();
+    cartridge_test_mmc1_write(0xE000, 5);
+    success &= cartridge_test_expect("MMC1 $8000 after writing $E000", cartridge_read(0x8000), 5);
+    success &= cartridge_test_expect("MMC1 $C000 after writing $E000", cartridge_read(0xC000), CARTRIDGE_TEST_PRG_BANKS - 1);
+    success &= cartridge_test_generation("MMC1 switching the $8000 bank", generation, true);
+
+    generation = cartridge_get_generation();
+    cartridge_test_mmc1_write(0xE000, 5);
+    success &= cartridge_test_generation("MMC1 writing the same $8000 bank again", generation, false);
+
+    //32KB PRG ignores the low bit of the bank
+    cartridge_test_mmc1_write(0x8000, 0x12);
+    success &= cartridge_test_expect("MMC1 32KB $8000", cartridge_read(0x8000), 4);
+    success &= cartridge_test_expect("MMC1 32KB $C000", cartridge_read(0xC000), 5);
+
+    cartridge_unload();
+
+    return success;
+}
+
+bool
+cartridge_test_mappers() {
+    bool success;
+
+    success = cartridge_test_mmc1();
+    if (success) {
+        log_info(MODULE, "Mapper registers land where they should");
+    }
+
+    return success;
+}
\ No newline at end of file
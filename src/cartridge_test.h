@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdbool.h>
+
+void cartridge_test_init();
+void cartridge_test_free();
+
+//loads images built in memory and checks every mapper register the mappers decode lands where it should
+bool cartridge_test_mappers();
\ No newline at end of file
@@ -12,5 +12,15 @@ void cpu_pause();
 
 void cpu_set_nmi();
 void cpu_set_irq();
+void cpu_clear_irq();
 
-void cpu_run_frame();
\ No newline at end of file
+void cpu_run_frame();
+
+//the 2KB of internal RAM at $0000-$07FF, for tests comparing runs
+const uint8_t * cpu_get_ram();
+
+//called by cartridge_load() to run the mapper with the core compiled for it, if there's one
+void cpu_set_mapper(int mapper);
+
+//runs every mapper with the generic core instead, to compare them
+void cpu_set_generic(bool generic);
\ No newline at end of file
@@ -0,0 +1,1553 @@
+//the bus, the instructions and the run loop. cpu.c includes me once per core it compiles, after defining
+//  CPU_CORE_PREFIX         what the core's functions are named with instead of cpu, e.g. cpu_mapper4
+//  CPU_CORE_GENERIC        to read and write through the cartridge's mapper interface, so any mapper works
+//  CPU_CORE_MAPPER_WRITE   otherwise the mapper's register write, left undefined if the mapper has no registers
+//  CPU_CORE_IRQ            1 if the cartridge can raise IRQs
+//they're all undefined again at the end
+
+#define CPU_CORE_PASTE(prefix, name) prefix##_##name
+#define CPU_CORE_NAME(prefix, name) CPU_CORE_PASTE(prefix, name)
+
+
+#define cpu_read_cartridge    CPU_CORE_NAME(CPU_CORE_PREFIX, read_cartridge)
+#define cpu_write_cartridge   CPU_CORE_NAME(CPU_CORE_PREFIX, write_cartridge)
+#define cpu_read              CPU_CORE_NAME(CPU_CORE_PREFIX, read)
+#define cpu_read_uint16       CPU_CORE_NAME(CPU_CORE_PREFIX, read_uint16)
+#define cpu_write             CPU_CORE_NAME(CPU_CORE_PREFIX, write)
+#define cpu_stack_push        CPU_CORE_NAME(CPU_CORE_PREFIX, stack_push)
+#define cpu_stack_push_uint16 CPU_CORE_NAME(CPU_CORE_PREFIX, stack_push_uint16)
+#define cpu_stack_pop         CPU_CORE_NAME(CPU_CORE_PREFIX, stack_pop)
+#define cpu_stack_pop_uint16  CPU_CORE_NAME(CPU_CORE_PREFIX, stack_pop_uint16)
+#define cpu_interrupt         CPU_CORE_NAME(CPU_CORE_PREFIX, interrupt)
+#define cpu_read_address      CPU_CORE_NAME(CPU_CORE_PREFIX, read_address)
+#define cpu_execute_adc_sbc   CPU_CORE_NAME(CPU_CORE_PREFIX, execute_adc_sbc)
+#define cpu_execute_adc       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_adc)
+#define cpu_execute_sbc       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sbc)
+#define cpu_execute_bitwise   CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bitwise)
+#define cpu_execute_and       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_and)
+#define cpu_execute_eor       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_eor)
+#define cpu_execute_ora       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_ora)
+#define cpu_execute_shift     CPU_CORE_NAME(CPU_CORE_PREFIX, execute_shift)
+#define cpu_execute_asl       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_asl)
+#define cpu_execute_lsr       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_lsr)
+#define cpu_execute_branch    CPU_CORE_NAME(CPU_CORE_PREFIX, execute_branch)
+#define cpu_execute_bcc       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bcc)
+#define cpu_execute_bcs       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bcs)
+#define cpu_execute_beq       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_beq)
+#define cpu_execute_bmi       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bmi)
+#define cpu_execute_bne       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bne)
+#define cpu_execute_bpl       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bpl)
+#define cpu_execute_bvc       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bvc)
+#define cpu_execute_bvs       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bvs)
+#define cpu_execute_bit       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_bit)
+#define cpu_execute_brk       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_brk)
+#define cpu_execute_clc       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_clc)
+#define cpu_execute_cld       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_cld)
+#define cpu_execute_cli       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_cli)
+#define cpu_execute_clv       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_clv)
+#define cpu_execute_compare   CPU_CORE_NAME(CPU_CORE_PREFIX, execute_compare)
+#define cpu_execute_cmp       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_cmp)
+#define cpu_execute_cpx       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_cpx)
+#define cpu_execute_cpy       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_cpy)
+#define cpu_execute_dcp       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_dcp)
+#define cpu_execute_ign       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_ign)
+#define cpu_execute_inc_dec   CPU_CORE_NAME(CPU_CORE_PREFIX, execute_inc_dec)
+#define cpu_execute_dec       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_dec)
+#define cpu_execute_dex       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_dex)
+#define cpu_execute_dey       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_dey)
+#define cpu_execute_inc       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_inc)
+#define cpu_execute_inx       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_inx)
+#define cpu_execute_iny       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_iny)
+#define cpu_execute_isc       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_isc)
+#define cpu_execute_jmp       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_jmp)
+#define cpu_execute_jsr       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_jsr)
+#define cpu_execute_lax       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_lax)
+#define cpu_execute_load      CPU_CORE_NAME(CPU_CORE_PREFIX, execute_load)
+#define cpu_execute_lda       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_lda)
+#define cpu_execute_ldx       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_ldx)
+#define cpu_execute_ldy       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_ldy)
+#define cpu_execute_nop       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_nop)
+#define cpu_execute_pha       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_pha)
+#define cpu_execute_php       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_php)
+#define cpu_execute_pla       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_pla)
+#define cpu_execute_plp       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_plp)
+#define cpu_execute_rla       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_rla)
+#define cpu_execute_rotate    CPU_CORE_NAME(CPU_CORE_PREFIX, execute_rotate)
+#define cpu_execute_rol       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_rol)
+#define cpu_execute_ror       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_ror)
+#define cpu_execute_rra       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_rra)
+#define cpu_execute_rti       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_rti)
+#define cpu_execute_rts       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_rts)
+#define cpu_execute_sax       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sax)
+#define cpu_execute_sec       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sec)
+#define cpu_execute_sed       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sed)
+#define cpu_execute_sei       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sei)
+#define cpu_execute_skb       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_skb)
+#define cpu_execute_slo       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_slo)
+#define cpu_execute_sre       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sre)
+#define cpu_execute_store     CPU_CORE_NAME(CPU_CORE_PREFIX, execute_store)
+#define cpu_execute_sta       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sta)
+#define cpu_execute_stx       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_stx)
+#define cpu_execute_sty       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_sty)
+#define cpu_execute_transfer  CPU_CORE_NAME(CPU_CORE_PREFIX, execute_transfer)
+#define cpu_execute_tax       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_tax)
+#define cpu_execute_tay       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_tay)
+#define cpu_execute_tsx       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_tsx)
+#define cpu_execute_txa       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_txa)
+#define cpu_execute_txs       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_txs)
+#define cpu_execute_tya       CPU_CORE_NAME(CPU_CORE_PREFIX, execute_tya)
+#define cpu_instructions      CPU_CORE_NAME(CPU_CORE_PREFIX, instructions)
+#define cpu_run_frame         CPU_CORE_NAME(CPU_CORE_PREFIX, run_frame)
+
+static uint8_t
+cpu_read_cartridge(uint16_t address) {
+#if !defined(CPU_CORE_GENERIC)
+    //PRG ROM straight from the banks the mapper has mapped
+    if (address >= 0x8000) {
+        return cpu.core.prg_banks[(address >> 13) & 0x03][address & 0x1FFF];
+    }
+#endif
+
+    return cartridge_read(address);
+}
+
+static void
+cpu_write_cartridge(uint16_t address, uint8_t value) {
+#if defined(CPU_CORE_GENERIC)
+    cartridge_write(address, value);
+#else
+    if (address < 0x8000) {
+        cartridge_write(address, value);
+    }
+# if defined(CPU_CORE_MAPPER_WRITE)
+    else {
+        CPU_CORE_MAPPER_WRITE(cpu.core.mapper_state, address, value);
+    }
+# endif
+#endif
+}
+
+static uint8_t
+cpu_read(uint16_t address) {
+    if (address >= 0x0000 && address <= 0x1FFF) {
+        return cpu.memory[address];
+    }
+    if (address >= 0x2000 && address <= 0x3FFF) {
+        return ppu_read_register(address % 8);
+    }
+    if (address >= 0x4000 && address <= 0x4013) {
+        //apu
+        return 0;
+    }
+    if (address == 0x4014) {
+        log_warn(MODULE, "DMA READ?");
+        return 0;
+    }
+    if (address == 0x4015) {
+        //apu
+        return 0;
+    }
+    if (address == 0x4016) {
+        //joypad
+        return 0;
+    }
+    if (address == 0x4017) {
+        //apu
+        return 0;
+    }
+    if (address >= 0x4018 && address <= 0xFFFF) {
+        return cpu_read_cartridge(address);
+    }
+
+    log_err(MODULE, "Tried to read memory at invalid address 0x%04X", address);
+
+    return 0;
+}
+
+//we can't just pass one address and read 2 bytes from the beginning because if this is a zero
+//page 2 byte address, address1 could be the last address of the zero page and then address2
+//would wrap to the first address of the zero page
+static uint16_t
+cpu_read_uint16(uint16_t address1, uint16_t address2) {
+    return cpu_read(address1) | (cpu_read(address2) << 8);
+}
+
+static void
+cpu_write(uint16_t address, uint8_t value) {
+    uint8_t page[0x100];
+    int i;
+
+    if (address >= 0x0000 && address <= 0x1FFF) {
+        cpu.memory[address] = value;
+        return;
+    }
+    if (address >= 0x2000 && address <= 0x3FFF) {
+        ppu_write_register(address % 8, value);
+        return;
+    }
+    if (address >= 0x4000 && address <= 0x4013) {
+        //apu
+        return;
+    }
+    if (address == 0x4014) {
+        //DMA OAM
+        for (i = 0; i < 256; i++) {
+            page[i] = cpu_read(value * 0x100 + i);
+        }
+
+        ppu_write_oam_dma(page);
+
+        return;
+    }
+    if (address == 0x4015) {
+        //apu
+        return;
+    }
+    if (address == 0x4016) {
+        //joypad
+        return;
+    }
+    if (address == 0x4017) {
+        //apu
+        return;
+    }
+    if (address >= 0x4018 && address <= 0xFFFF) {
+        cpu_write_cartridge(address, value);
+        return;
+    }
+
+    log_err(MODULE, "Tried to write memory at invalid address 0x%04X", address);
+}
+
+static void
+cpu_stack_push(uint8_t value) {
+    cpu_write(0x100 + cpu.SP--, value);
+}
+
+static void
+cpu_stack_push_uint16(uint16_t value) {
+    //stack grows down so we can't use cpu_write_uint16()
+    cpu_write(0x100 + cpu.SP--, value >> 8);
+    cpu_write(0x100 + cpu.SP--, value);
+}
+
+static uint8_t
+cpu_stack_pop() {
+    return cpu_read(0x100 + ++cpu.SP);
+}
+
+static uint16_t
+cpu_stack_pop_uint16() {
+    uint16_t value;
+
+    //stack grows down so we can't use cpu_read_uint16()
+    value = cpu_read(0x100 + ++cpu.SP);
+    value |= cpu_read(0x100 + ++cpu.SP) << 8;
+
+    return value;
+}
+
+static void
+cpu_interrupt(cpu_interrupt_t type) {
+    static uint16_t vector[] = {0xFFFA, 0xFFFC, 0xFFFE, 0xFFFE};
+    uint8_t flags;
+
+    if (type != CPU_INTERRUPT_RESET) {
+        flags = cpu.flags;
+
+        //only modify a copy of the flags
+        if (type == CPU_INTERRUPT_BRK) {
+            flags |= CPU_FLAG_BREAK_COMMAND;
+        }
+
+        cpu_stack_push_uint16(cpu.PC);
+        cpu_stack_push(flags);
+    }
+    else {
+        cpu.SP -= 3;
+    }
+
+    cpu_flag_set(CPU_FLAG_INTERRUPT_DISABLE, true);
+
+    if (cartridge_is_nes_test()) {
+        cpu.PC = 0xC000;
+    }
+    else {
+        cpu.PC = cpu_read_uint16(vector[type], vector[type] + 1);
+    }
+
+    if (type == CPU_INTERRUPT_NMI) {
+        cpu.nmi = false;
+    }
+
+    //the BRK cycle maintenance is handled in the instructon map function (even though it's the same value)
+    if (type != CPU_INTERRUPT_BRK) {
+        cpu_cycle(7);
+    }
+}
+
+static uint16_t
+cpu_read_address(cpu_addr_mode_t mode, bool *page_crossed) {
+    uint16_t address = 0;
+
+    if (page_crossed != NULL) {
+        *page_crossed = false;
+    }
+
+    switch (mode) {
+        case CPU_ADDR_MODE_ABS:
+            //memory location is the 16 bit value in the instruction
+            address = cpu_read_uint16(cpu.PC, cpu.PC + 1);
+            cpu.PC += sizeof(address);
+            break;
+        case CPU_ADDR_MODE_ABX:
+            //memory location is the 16 bit value in the instruction
+            address = cpu_read_uint16(cpu.PC, cpu.PC + 1);
+            cpu.PC += sizeof(address);
+            
+            if (page_crossed != NULL && cpu_page_cross(address, cpu.X)) {
+                *page_crossed = true;
+            }
+
+            address += cpu.X;
+            break;
+        case CPU_ADDR_MODE_ABY:
+            //memory location is the 16 bit value in the instruction
+            address = cpu_read_uint16(cpu.PC, cpu.PC + 1);
+            cpu.PC += sizeof(address);
+
+            if (page_crossed != NULL && cpu_page_cross(address, cpu.Y)) {
+                *page_crossed = true;
+            }
+
+            address += cpu.Y;
+            break;
+        case CPU_ADDR_MODE_ACC:
+            //do nothing
+            break;
+        case CPU_ADDR_MODE_IDX:
+            //zero page address comes from the instruction, which is the location of another 16 bit address in the zero page
+            //the X register is applied before reading the indirect address
+            //the address must wrap if there's overflow so it stays in the zero page
+            address = (cpu_read(cpu.PC++) + cpu.X) & 0xFF;
+            address = cpu_read_uint16(address, (address + 1) & 0xFF);
+            break;
+        case CPU_ADDR_MODE_IDY:
+            //zero page address comes from the instruction, which is the location of another 16 bit address in the zero page
+            //the Y register is applied after reading the indirect address
+            address = cpu_read(cpu.PC++);
+            address = cpu_read_uint16(address, (address + 1) & 0xFF);
+
+            if (page_crossed != NULL && cpu_page_cross(address, cpu.Y)) {
+                *page_crossed = true;
+            }
+
+            //Y register is applied after
+            address = address + cpu.Y;
+            break;
+        case CPU_ADDR_MODE_IMM:
+            address = cpu.PC++;
+            break;
+        case CPU_ADDR_MODE_IMP:
+            //do nothing
+            break;
+        case CPU_ADDR_MODE_IND:
+            //memory location is the 16 bit value in the instruction
+            address = cpu_read_uint16(cpu.PC, cpu.PC + 1);
+            cpu.PC += sizeof(address);
+
+            //read the address at that address
+            address = cpu_read_uint16(address, (address & 0xFF00) | ((address + 1) & 0xFF));
+            break;
+        case CPU_ADDR_MODE_REL:
+            //the offset for the branch instructions comes from the instruction, which is the next byte
+            address = cpu.PC++;
+            break;
+        case CPU_ADDR_MODE_ZPG:
+            //zero page address comes from the instruction
+            address = cpu_read(cpu.PC++);
+            break;
+        case CPU_ADDR_MODE_ZPX:
+            //zero page address comes from the instruction
+            //the address wraps if it's passed the zero page addressable space
+            address = (cpu_read(cpu.PC++) + cpu.X) & 0xFF;
+            break;
+        case CPU_ADDR_MODE_ZPY:
+            //zero page address comes from the instruction
+            //the address wraps if it's passed the zero page addressable space
+            address = (cpu_read(cpu.PC++) + cpu.Y) & 0xFF;
+            break;
+        default:
+            log_err(MODULE, "Unhandled addressing mode %d", mode);
+            break;
+    }
+
+    return address;
+}
+
+static void
+cpu_execute_adc_sbc(cpu_addr_mode_t mode, int cycles, bool subtract) {
+    uint16_t address;
+    uint8_t value;
+    int16_t value2;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+
+    value = cpu_read(address);
+    if (subtract) {
+        value ^= 0xFF;
+    }
+
+    value2 = cpu.A + value;
+    if (cpu_flag_is_set(CPU_FLAG_CARRY)) {
+        ++value2;
+    }
+
+    cpu_flag_set(CPU_FLAG_CARRY, value2 > 0xFF);
+    cpu_flag_set(CPU_FLAG_OVERFLOW, ~(cpu.A ^ value) & (cpu.A ^ value2) & 0x80);
+
+    cpu.A = value2;
+
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//add with carry
+static void
+cpu_execute_adc(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_adc_sbc(mode, cycles, false);
+}
+
+//subtract with carry
+static void
+cpu_execute_sbc(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_adc_sbc(mode, cycles, true);
+}
+
+//bitwise AND (and)
+//exclusive OR (eor)
+//include OR (ora)
+static void
+cpu_execute_bitwise(uint8_t value, int cycles, bool page_crossed) {
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//bitwise AND
+static void
+cpu_execute_and(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    cpu_execute_bitwise(cpu.A &= cpu_read(address), cycles, page_crossed);
+}
+
+//exclusive OR
+static void
+cpu_execute_eor(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    cpu_execute_bitwise(cpu.A ^= cpu_read(address), cycles, page_crossed);
+}
+
+//logical inclusive OR
+static void
+cpu_execute_ora(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    cpu_execute_bitwise(cpu.A |= cpu_read(address), cycles, page_crossed);
+}
+
+//logical shift left (asl)
+//logical shift right (lsr)
+static void
+cpu_execute_shift(cpu_addr_mode_t mode, int cycles, bool left) {
+    uint16_t address;
+    uint8_t value;
+    bool page_crossed;
+
+    if (mode == CPU_ADDR_MODE_ACC) {
+        page_crossed = false;
+
+        cpu_flag_set(CPU_FLAG_CARRY, cpu.A & (left ? 0x80 : 0x01));
+
+        cpu.A = left ? (cpu.A << 1) : (cpu.A >> 1);
+        value = cpu.A;
+    }
+    else {
+        address = cpu_read_address(mode, &page_crossed);
+        value = cpu_read(address);
+
+        cpu_flag_set(CPU_FLAG_CARRY, value & (left ? 0x80 : 0x01));
+
+        value = left ? (value << 1) : (value >> 1);
+        cpu_write(address, value);
+    }
+
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//shift left
+static void
+cpu_execute_asl(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_shift(mode, cycles, true);
+}
+
+//logical shift right
+static void
+cpu_execute_lsr(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_shift(mode, cycles, false);
+}
+
+//branch if carry clear (bcc)
+//branch if carry set (bcs)
+//branch if equal (beq)
+//branch if minus (bmi)
+//branch if not equal (bne)
+//branch if positive (bpl)
+//branch if overflow clear (bvc)
+//branch if overflow set (bvs)
+static void
+cpu_execute_branch(cpu_addr_mode_t mode, int cycles, uint8_t flag, bool flag_value) {
+    uint16_t address;
+    int8_t value;
+
+    address = cpu_read_address(mode, NULL);
+
+    //important that value is signed to support going backwards
+    if (cpu_flag_is_set(flag) == flag_value) {
+        value = cpu_read(address);
+
+        cpu_cycle(1);
+
+        //this page check has to support going backwards!!
+        if (cpu_page_cross2(cpu.PC, cpu.PC + value)) {
+            cpu_cycle(1);
+        }
+
+        cpu.PC += value;
+    }
+
+    cpu_cycle(cycles);
+}
+
+//branch if carry clear
+static void
+cpu_execute_bcc(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_CARRY, false);
+}
+
+//branch if carry set
+static void
+cpu_execute_bcs(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_CARRY, true);
+}
+
+//branch if equal
+static void
+cpu_execute_beq(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_ZERO, true);
+}
+
+//branch if minus
+static void
+cpu_execute_bmi(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_NEGATIVE, true);
+}
+
+//branch if not equal
+static void
+cpu_execute_bne(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_ZERO, false);
+}
+
+//branch if positive
+static void
+cpu_execute_bpl(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_NEGATIVE, false);
+}
+
+//branch if overflow clear
+static void
+cpu_execute_bvc(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_OVERFLOW, false);
+}
+
+//branch if overflow set
+static void
+cpu_execute_bvs(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_branch(mode, cycles, CPU_FLAG_OVERFLOW, true);
+}
+
+//bit test
+static void
+cpu_execute_bit(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    uint16_t value;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    value = cpu_read(address);
+
+    cpu_flag_set(CPU_FLAG_ZERO, (cpu.A & value) == 0);
+    cpu_flag_set(CPU_FLAG_OVERFLOW, value & 0x40);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    cpu_cycle(cycles);
+}
+
+//force interrupt
+static void
+cpu_execute_brk(cpu_addr_mode_t mode, int cycles) {
+    cpu_interrupt(CPU_INTERRUPT_BRK);
+
+    cpu_flag_set(CPU_FLAG_BREAK_COMMAND, true);
+
+    cpu_cycle(cycles);
+}
+
+//clear carry flag
+static void
+cpu_execute_clc(cpu_addr_mode_t mode, int cycles) {
+    cpu_flag_set(CPU_FLAG_CARRY, false);
+    cpu_cycle(cycles);
+}
+
+//clear decimal mode
+static void
+cpu_execute_cld(cpu_addr_mode_t mode, int cycles) {
+    cpu_flag_set(CPU_FLAG_DECIMAL_MODE, false);
+    cpu_cycle(cycles);
+}
+
+//clear interrupt disable
+static void
+cpu_execute_cli(cpu_addr_mode_t mode, int cycles) {
+    cpu_flag_set(CPU_FLAG_INTERRUPT_DISABLE, false);
+    cpu_cycle(cycles);
+}
+
+//clear overflow flag
+static void
+cpu_execute_clv(cpu_addr_mode_t mode, int cycles) {
+    cpu_flag_set(CPU_FLAG_OVERFLOW, false);
+    cpu_cycle(cycles);
+}
+
+//compare (cmp)
+//compare x register (cpx)
+//compare y register (cpy)
+static void
+cpu_execute_compare(cpu_addr_mode_t mode, int cycles, uint8_t value_compare) {
+    uint16_t address;
+    uint8_t value;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    value = cpu_read(address);
+
+    cpu_flag_set(CPU_FLAG_CARRY, value_compare >= value);
+    cpu_flag_set(CPU_FLAG_ZERO, value_compare == value);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, (value_compare - value) & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//compare
+static void
+cpu_execute_cmp(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_compare(mode, cycles, cpu.A);
+}
+
+//compare x register
+static void
+cpu_execute_cpx(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_compare(mode, cycles, cpu.X);
+}
+
+//compare y register
+static void
+cpu_execute_cpy(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_compare(mode, cycles, cpu.Y);
+}
+
+//decrement and compare (DEC + CMP)
+static void
+cpu_execute_dcp(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    uint8_t value;
+
+    address = cpu_read_address(mode, NULL);
+    value = cpu_read(address) - 1;
+
+    cpu_write(address, value);
+
+    //TODO: do we need to check these?
+    cpu_flag_set(CPU_FLAG_CARRY, cpu.A >= value);
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == value);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, (cpu.A - value) & 0x80);
+
+    cpu_cycle(cycles);
+}
+
+//ignore value
+static void
+cpu_execute_ign(cpu_addr_mode_t mode, int cycles) {
+    bool page_crossed;
+    uint16_t address;
+
+    address = cpu_read_address(mode, &page_crossed);
+    cpu_read(address);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//decrement memory (dec)
+//decrement x register (dex)
+//decrement y register (dey)
+//increment memory (inc)
+//increment x register (inx)
+//increment y register (iny)
+static void
+cpu_execute_inc_dec(cpu_addr_mode_t mode, int cycles, uint8_t *register_value, bool inc) {
+    uint16_t address;
+    uint8_t value;
+    bool page_crossed;
+
+    //are we setting a register or a memory value?
+    if (register_value == NULL) {
+        address = cpu_read_address(mode, &page_crossed);
+        value = cpu_read(address);
+        value = inc ? (value + 1) : (value - 1);
+
+        cpu_write(address, value);
+    }
+    else {
+        page_crossed = false;
+        value = inc ? ++(*register_value) : --(*register_value);
+    }
+
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//decrement memory
+static void
+cpu_execute_dec(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_inc_dec(mode, cycles, NULL, false);
+}
+
+//decrement x register
+static void
+cpu_execute_dex(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_inc_dec(mode, cycles, &cpu.X, false);
+}
+
+//decrement y register
+static void
+cpu_execute_dey(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_inc_dec(mode, cycles, &cpu.Y, false);
+}
+
+//increment memory
+static void
+cpu_execute_inc(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_inc_dec(mode, cycles, NULL, true);
+}
+
+//increment x register
+static void
+cpu_execute_inx(cpu_addr_mode_t mode, int cycles) {
+   cpu_execute_inc_dec(mode, cycles, &cpu.X, true);
+}
+
+//increment y register
+static void
+cpu_execute_iny(cpu_addr_mode_t mode, int cycles) {
+   cpu_execute_inc_dec(mode, cycles, &cpu.Y, true);
+}
+
+//INC + SBC
+//TODO: are the flags set correctly?
+static void
+cpu_execute_isc(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    int16_t value2;
+    uint8_t value;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    value = cpu_read(address);
+
+    //inc
+    ++value;
+    cpu_write(address, value);
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    //sbc
+    value2 = cpu.A + (value ^ 0xFF);
+    if (cpu_flag_is_set(CPU_FLAG_CARRY)) {
+        ++value2;
+    }
+
+    cpu_flag_set(CPU_FLAG_CARRY, value2 > 0xFF);
+    cpu_flag_set(CPU_FLAG_OVERFLOW, ~(cpu.A ^ value) & (cpu.A ^ value2) & 0x80);
+        
+    cpu.A = value2;
+
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        //TODO: don't care about page crossing?
+        //cpu_cycle(1);
+    }
+}
+
+//jump
+static void
+cpu_execute_jmp(cpu_addr_mode_t mode, int cycles) {
+    cpu.PC = cpu_read_address(mode, NULL);
+
+    cpu_cycle(cycles);
+}
+
+//jump to subroutine
+static void
+cpu_execute_jsr(cpu_addr_mode_t mode, int cycles) {
+    cpu_stack_push_uint16(cpu.PC + 1);
+
+    cpu.PC = cpu_read_address(mode, NULL);
+
+    cpu_cycle(cycles);
+}
+
+//load accumulator and X in one instruction
+static void
+cpu_execute_lax(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    cpu.A = cpu.X = cpu_read(address);
+
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//load accumulator (lda)
+//load x register (ldx)
+//load y register (ldy)
+static void
+cpu_execute_load(cpu_addr_mode_t mode, int cycles, uint8_t *reg) {
+    uint16_t address;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    *reg = cpu_read(address);
+
+    cpu_flag_set(CPU_FLAG_ZERO, *reg == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, *reg & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//load accumulator
+static void
+cpu_execute_lda(cpu_addr_mode_t mode, int cycles) {
+   cpu_execute_load(mode, cycles, &cpu.A);
+}
+
+//load x register
+static void
+cpu_execute_ldx(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_load(mode, cycles, &cpu.X);
+}
+
+//load y register
+static void
+cpu_execute_ldy(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_load(mode, cycles, &cpu.Y);
+}
+
+//no operation
+static void
+cpu_execute_nop(cpu_addr_mode_t mode, int cycles) {
+    cpu_cycle(cycles);
+}
+
+//push accumulator
+static void
+cpu_execute_pha(cpu_addr_mode_t mode, int cycles) {
+    cpu_stack_push(cpu.A);
+
+    cpu_cycle(cycles);
+}
+
+//push processor status
+static void
+cpu_execute_php(cpu_addr_mode_t mode, int cycles) {
+    //this flag aways get set, and don't modify the original
+    cpu_stack_push(cpu.flags | CPU_FLAG_BREAK_COMMAND);
+
+    cpu_cycle(cycles);
+}
+
+//pull accumulator
+static void
+cpu_execute_pla(cpu_addr_mode_t mode, int cycles) {
+    cpu.A = cpu_stack_pop();
+
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+
+    cpu_cycle(cycles);
+}
+
+//pull processor status
+static void
+cpu_execute_plp(cpu_addr_mode_t mode, int cycles) {
+    uint8_t flags = cpu_stack_pop();
+
+    cpu_flag_set(CPU_FLAG_CARRY, flags & CPU_FLAG_CARRY);
+    cpu_flag_set(CPU_FLAG_ZERO, flags & CPU_FLAG_ZERO);
+    cpu_flag_set(CPU_FLAG_INTERRUPT_DISABLE, flags & CPU_FLAG_INTERRUPT_DISABLE);
+    cpu_flag_set(CPU_FLAG_DECIMAL_MODE, flags & CPU_FLAG_DECIMAL_MODE);
+    //don't mess with 4 or 5
+    cpu_flag_set(CPU_FLAG_OVERFLOW, flags & CPU_FLAG_OVERFLOW);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, flags & CPU_FLAG_NEGATIVE);
+
+    cpu_cycle(cycles);
+}
+
+//ROL + AND
+//TODO: are these flags are correctly?
+static void
+cpu_execute_rla(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    uint8_t value, wrap;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    value = cpu_read(address);
+
+    //rol
+    wrap = cpu_flag_is_set(CPU_FLAG_CARRY);
+    cpu_flag_set(CPU_FLAG_CARRY, value & 0x80);
+
+    value = (value << 1) | wrap;
+
+    cpu_write(address, value);
+
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    //and
+    cpu.A &= value;
+
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        //cpu_cycle(1);
+        //TODO: ignore page crossing?
+    }
+}
+
+//rotate left (rol)
+//rotate right (ror)
+static void
+cpu_execute_rotate(cpu_addr_mode_t mode, int cycles, bool left) {
+    uint16_t address;
+    uint8_t value, wrap;
+    bool page_crossed;
+
+    wrap = cpu_flag_is_set(CPU_FLAG_CARRY);
+    if (!left) {
+        wrap <<= 7;
+    }
+
+    if (mode == CPU_ADDR_MODE_ACC) {
+        page_crossed = false;
+
+        cpu_flag_set(CPU_FLAG_CARRY, cpu.A & (left ? 0x80 : 0x01));
+
+        cpu.A = left ? ((cpu.A << 1) | wrap) : (wrap | (cpu.A >> 1));
+        value = cpu.A;
+    }
+    else {
+        address = cpu_read_address(mode, &page_crossed);
+        value = cpu_read(address);
+
+        cpu_flag_set(CPU_FLAG_CARRY, value & (left ? 0x80 : 0x01));
+
+        value = left ? ((value << 1) | wrap) : (wrap | (value >> 1));
+        cpu_write(address, value);
+    }
+
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//rotate left
+static void
+cpu_execute_rol(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_rotate(mode, cycles, true);
+}
+
+//rotate right
+static void
+cpu_execute_ror(cpu_addr_mode_t mode, int cycles) {
+   cpu_execute_rotate(mode, cycles, false);
+}
+
+//ROR + ADC
+//TODO: are these flags set correctly?
+static void
+cpu_execute_rra(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    uint8_t value, wrap;
+    int16_t value2;
+    bool page_crossed;
+
+     address = cpu_read_address(mode, &page_crossed);
+     value = cpu_read(address);
+
+    //ror
+    wrap = cpu_flag_is_set(CPU_FLAG_CARRY) << 7;
+
+    cpu_flag_set(CPU_FLAG_CARRY, value & 0x01);
+
+    value =  wrap | (value >> 1);
+    cpu_write(address, value);
+
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    //adc
+    value2 = cpu.A + value;
+    if (cpu_flag_is_set(CPU_FLAG_CARRY)) {
+        ++value2;
+    }
+
+    cpu_flag_set(CPU_FLAG_CARRY, value2 > 0xFF);
+    cpu_flag_set(CPU_FLAG_OVERFLOW, ~(cpu.A ^ value) & (cpu.A ^ value2) & 0x80);
+
+    cpu.A = value2;
+
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+    
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        //cpu_cycle(1);
+        //TODO: is this ignored?
+    }
+}
+
+//return from interrupt
+static void
+cpu_execute_rti(cpu_addr_mode_t mode, int cycles) {
+    uint8_t flags = cpu_stack_pop();
+
+    cpu_flag_set(CPU_FLAG_CARRY, flags & CPU_FLAG_CARRY);
+    cpu_flag_set(CPU_FLAG_ZERO, flags & CPU_FLAG_ZERO);
+    cpu_flag_set(CPU_FLAG_INTERRUPT_DISABLE, flags & CPU_FLAG_INTERRUPT_DISABLE);
+    cpu_flag_set(CPU_FLAG_DECIMAL_MODE, flags & CPU_FLAG_DECIMAL_MODE);
+    //don't mess with 4 or 5
+    cpu_flag_set(CPU_FLAG_OVERFLOW, flags & CPU_FLAG_OVERFLOW);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, flags & CPU_FLAG_NEGATIVE);
+
+    cpu.PC = cpu_stack_pop_uint16();
+
+    cpu_cycle(cycles);
+}
+
+//return from subroutine
+static void
+cpu_execute_rts(cpu_addr_mode_t mode, int cycles) {
+    cpu.PC = cpu_stack_pop_uint16() + 1;
+
+    cpu_cycle(cycles);
+}
+
+//bitwise AND of A and X (AND + STX)
+static void
+cpu_execute_sax(cpu_addr_mode_t mode, int cycles) {
+    bool page_crossed;
+    uint16_t address;
+
+    address = cpu_read_address(mode, &page_crossed);
+    cpu_write(address, cpu.A & cpu.X);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//set carry flag
+static void
+cpu_execute_sec(cpu_addr_mode_t mode, int cycles) {
+    cpu_flag_set(CPU_FLAG_CARRY, true);
+
+    cpu_cycle(cycles);
+}
+
+//set decimal flag
+static void
+cpu_execute_sed(cpu_addr_mode_t mode, int cycles) {
+    cpu_flag_set(CPU_FLAG_DECIMAL_MODE, true);
+
+    cpu_cycle(cycles);
+}
+
+//set interrupt disable
+static void
+cpu_execute_sei(cpu_addr_mode_t mode, int cycles) {
+    cpu_flag_set(CPU_FLAG_INTERRUPT_DISABLE, true);
+
+    cpu_cycle(cycles);
+}
+
+//skb??
+static void
+cpu_execute_skb(cpu_addr_mode_t mode, int cycles) {
+    bool page_crossed;
+    uint16_t address;
+
+    address = cpu_read_address(mode, &page_crossed);
+    cpu_read(address);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        cpu_cycle(1);
+    }
+}
+
+//ASL + ORA
+//TODO: Are these flags set correctly?
+static void
+cpu_execute_slo(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    uint8_t value;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    value = cpu_read(address);
+
+    //asl
+    cpu_flag_set(CPU_FLAG_CARRY, value & 0x80);
+    value <<= 1;
+    cpu_write(address, value);
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    //ora
+    cpu.A |= value;
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        //cpu_cycle(1);
+        //TODO: ignore page crossing?
+    }
+}
+
+//LSR + EOR
+//TODO: are these flags set correctly?
+static void
+cpu_execute_sre(cpu_addr_mode_t mode, int cycles) {
+    uint16_t address;
+    uint8_t value;
+    bool page_crossed;
+
+    address = cpu_read_address(mode, &page_crossed);
+    value = cpu_read(address);
+
+    //lsr
+    cpu_flag_set(CPU_FLAG_CARRY, value & 0x01);
+    value >>= 1;
+    cpu_write(address, value);
+    cpu_flag_set(CPU_FLAG_ZERO, value == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, value & 0x80);
+
+    //eor
+    cpu.A ^= value;
+    cpu_flag_set(CPU_FLAG_ZERO, cpu.A == 0);
+    cpu_flag_set(CPU_FLAG_NEGATIVE, cpu.A & 0x80);
+
+    cpu_cycle(cycles);
+    if (page_crossed) {
+        //cpu_cycle(1);
+        //TODO: ignore page crossing?
+    }
+}
+
+//store accumulator (sta)
+//store x register (stx)
+//store y register (sty)
+static void
+cpu_execute_store(cpu_addr_mode_t mode, int cycles, uint8_t value) {
+    uint16_t address;
+
+    address = cpu_read_address(mode, NULL);
+    cpu_write(address, value);
+
+    cpu_cycle(cycles);
+}
+
+//store accumulator
+static void
+cpu_execute_sta(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_store(mode, cycles, cpu.A);
+}
+
+//store x register
+static void
+cpu_execute_stx(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_store(mode, cycles, cpu.X);
+}
+
+//store y register
+static void
+cpu_execute_sty(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_store(mode, cycles, cpu.Y);
+}
+
+//transfer accumulator to x (tax)
+//transfer accumulator to y (tay)
+//transfer stack pointer to x (tsx)
+//transfer x to accumulator (txa)
+//transfer x to stack pointer (txs)
+//transfer y to accumulator (tya)
+static void
+cpu_execute_transfer(cpu_addr_mode_t mode, int cycles, uint8_t from, uint8_t *to) {
+    *to = from;
+
+    //don't check flags for TAX
+    if (to != &cpu.SP) {
+        cpu_flag_set(CPU_FLAG_ZERO, *to == 0);
+        cpu_flag_set(CPU_FLAG_NEGATIVE, *to & 0x80);
+    }
+
+    cpu_cycle(cycles);
+}
+
+//transfer accumulator to x
+static void
+cpu_execute_tax(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_transfer(mode, cycles, cpu.A, &cpu.X);
+}
+
+//transfer accumulator to y
+static void
+cpu_execute_tay(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_transfer(mode, cycles, cpu.A, &cpu.Y);
+}
+
+//transfer stack pointer to x
+static void
+cpu_execute_tsx(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_transfer(mode, cycles, cpu.SP, &cpu.X);
+}
+
+//transfer x to accumulator
+static void
+cpu_execute_txa(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_transfer(mode, cycles, cpu.X, &cpu.A);
+}
+
+//transfer x to stack pointer
+static void
+cpu_execute_txs(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_transfer(mode, cycles, cpu.X, &cpu.SP);
+}
+
+//transfer y to accumulator
+static void
+cpu_execute_tya(cpu_addr_mode_t mode, int cycles) {
+    cpu_execute_transfer(mode, cycles, cpu.Y, &cpu.A);
+}
+
+static void (* const cpu_instructions[])(cpu_addr_mode_t mode, int cycles) = {
+    [CPU_INSTRUCTION_ADC] = cpu_execute_adc,
+    [CPU_INSTRUCTION_AND] = cpu_execute_and,
+    [CPU_INSTRUCTION_ASL] = cpu_execute_asl,
+    [CPU_INSTRUCTION_BCC] = cpu_execute_bcc,
+    [CPU_INSTRUCTION_BCS] = cpu_execute_bcs,
+    [CPU_INSTRUCTION_BEQ] = cpu_execute_beq,
+    [CPU_INSTRUCTION_BIT] = cpu_execute_bit,
+    [CPU_INSTRUCTION_BMI] = cpu_execute_bmi,
+    [CPU_INSTRUCTION_BNE] = cpu_execute_bne,
+    [CPU_INSTRUCTION_BPL] = cpu_execute_bpl,
+    [CPU_INSTRUCTION_BRK] = cpu_execute_brk,
+    [CPU_INSTRUCTION_BVC] = cpu_execute_bvc,
+    [CPU_INSTRUCTION_BVS] = cpu_execute_bvs,
+    [CPU_INSTRUCTION_CLC] = cpu_execute_clc,
+    [CPU_INSTRUCTION_CLD] = cpu_execute_cld,
+    [CPU_INSTRUCTION_CLI] = cpu_execute_cli,
+    [CPU_INSTRUCTION_CLV] = cpu_execute_clv,
+    [CPU_INSTRUCTION_CMP] = cpu_execute_cmp,
+    [CPU_INSTRUCTION_CPX] = cpu_execute_cpx,
+    [CPU_INSTRUCTION_CPY] = cpu_execute_cpy,
+    [CPU_INSTRUCTION_DEC] = cpu_execute_dec,
+    [CPU_INSTRUCTION_DEX] = cpu_execute_dex,
+    [CPU_INSTRUCTION_DEY] = cpu_execute_dey,
+    [CPU_INSTRUCTION_EOR] = cpu_execute_eor,
+    [CPU_INSTRUCTION_INC] = cpu_execute_inc,
+    [CPU_INSTRUCTION_INX] = cpu_execute_inx,
+    [CPU_INSTRUCTION_INY] = cpu_execute_iny,
+    [CPU_INSTRUCTION_JMP] = cpu_execute_jmp,
+    [CPU_INSTRUCTION_JSR] = cpu_execute_jsr,
+    [CPU_INSTRUCTION_LDA] = cpu_execute_lda,
+    [CPU_INSTRUCTION_LDX] = cpu_execute_ldx,
+    [CPU_INSTRUCTION_LDY] = cpu_execute_ldy,
+    [CPU_INSTRUCTION_LSR] = cpu_execute_lsr,
+    [CPU_INSTRUCTION_NOP] = cpu_execute_nop,
+    [CPU_INSTRUCTION_ORA] = cpu_execute_ora,
+    [CPU_INSTRUCTION_PHA] = cpu_execute_pha,
+    [CPU_INSTRUCTION_PHP] = cpu_execute_php,
+    [CPU_INSTRUCTION_PLA] = cpu_execute_pla,
+    [CPU_INSTRUCTION_PLP] = cpu_execute_plp,
+    [CPU_INSTRUCTION_ROL] = cpu_execute_rol,
+    [CPU_INSTRUCTION_ROR] = cpu_execute_ror,
+    [CPU_INSTRUCTION_RTI] = cpu_execute_rti,
+    [CPU_INSTRUCTION_RTS] = cpu_execute_rts,
+    [CPU_INSTRUCTION_SBC] = cpu_execute_sbc,
+    [CPU_INSTRUCTION_SEC] = cpu_execute_sec,
+    [CPU_INSTRUCTION_SED] = cpu_execute_sed,
+    [CPU_INSTRUCTION_SEI] = cpu_execute_sei,
+    [CPU_INSTRUCTION_STA] = cpu_execute_sta,
+    [CPU_INSTRUCTION_STX] = cpu_execute_stx,
+    [CPU_INSTRUCTION_STY] = cpu_execute_sty,
+    [CPU_INSTRUCTION_TAX] = cpu_execute_tax,
+    [CPU_INSTRUCTION_TAY] = cpu_execute_tay,
+    [CPU_INSTRUCTION_TSX] = cpu_execute_tsx,
+    [CPU_INSTRUCTION_TXA] = cpu_execute_txa,
+    [CPU_INSTRUCTION_TXS] = cpu_execute_txs,
+    [CPU_INSTRUCTION_TYA] = cpu_execute_tya,
+    [CPU_INSTRUCTION_DCP] = cpu_execute_dcp,
+    [CPU_INSTRUCTION_IGN] = cpu_execute_ign,
+    [CPU_INSTRUCTION_ISC] = cpu_execute_isc,
+    [CPU_INSTRUCTION_LAX] = cpu_execute_lax,
+    [CPU_INSTRUCTION_RLA] = cpu_execute_rla,
+    [CPU_INSTRUCTION_RRA] = cpu_execute_rra,
+    [CPU_INSTRUCTION_SAX] = cpu_execute_sax,
+    [CPU_INSTRUCTION_SKB] = cpu_execute_skb,
+    [CPU_INSTRUCTION_SLO] = cpu_execute_slo,
+    [CPU_INSTRUCTION_SRE] = cpu_execute_sre
+};
+
+static void
+cpu_run_frame() {
+    cpu_instruction_map_t *map;
+    uint8_t opcode;
+    bool test;
+
+    cpu.cycles_left += CPU_CYCLES_PER_FRAME;
+    test = cartridge_is_nes_test();
+
+    while (cpu.cycles_left > 0) {
+        //interrupts are taken between instructions, an IRQ for as long as the cartridge holds the line
+        if (cpu.nmi) {
+            cpu_interrupt(CPU_INTERRUPT_NMI);
+        }
+#if CPU_CORE_IRQ
+        else if (cpu.irq && !cpu_flag_is_set(CPU_FLAG_INTERRUPT_DISABLE)) {
+            cpu_interrupt(CPU_INTERRUPT_IRQ);
+        }
+#endif
+
+        if (test) {
+            if (CPU_CYCLES_PER_FRAME - cpu.cycles_left >= 26554) {
+                printf("CPU test passed!\n");
+                fflush(stdout);
+                fgetc(stdin);
+                exit(1);
+            }
+        }
+
+        if (test) {
+            printf("%04X  ", cpu.PC);
+        }
+
+        opcode = cpu_read(cpu.PC++);
+        map = &instruction_map[opcode];
+
+        if (test) {
+            printf("%02X (%s-%s): ", opcode, cpu_instruction_str(map->instruction), cpu_address_mode_str(map->mode));
+            printf("A: %02X  X: %02X  Y: %02X  SP: %02X  Cycles: %d  ", cpu.A, cpu.X, cpu.Y, cpu.SP, CPU_CYCLES_PER_FRAME - cpu.cycles_left);
+            printf("Flags: %02X ", cpu.flags);
+            printf("C[%d] ", cpu_flag_is_set(CPU_FLAG_CARRY) ? 1 : 0);
+            printf("Z[%d] ", cpu_flag_is_set(CPU_FLAG_ZERO) ? 1 : 0);
+            printf("I[%d] ", cpu_flag_is_set(CPU_FLAG_INTERRUPT_DISABLE) ? 1 : 0);
+            printf("B[%d] ", cpu_flag_is_set(CPU_FLAG_BREAK_COMMAND) ? 1 : 0);
+            printf("U[%d] ", cpu_flag_is_set(CPU_FLAG_UNUSED) ? 1 : 0);
+            printf("V[%d] ", cpu_flag_is_set(CPU_FLAG_OVERFLOW) ? 1 : 0);
+            printf("N[%d]\n", cpu_flag_is_set(CPU_FLAG_NEGATIVE) ? 1 : 0);
+
+            if (!cpu_test_check(cpu.PC - 1, opcode, cpu.A, cpu.X, cpu.Y, cpu.SP, cpu.flags, CPU_CYCLES_PER_FRAME - cpu.cycles_left)) {
+                fflush(stdout);
+                fgetc(stdin);
+                exit(1);
+            }
+        }
+
+        if (map->instruction == CPU_INSTRUCTION_INV) {
+            log_err(MODULE, "Unhandled opcode %02X", opcode);
+            fflush(stdout);
+            fgetc(stdin);
+            exit(1);
+            return;
+        }
+
+        cpu_instructions[map->instruction](map->mode, map->cycles);
+    }
+}
+
+#undef cpu_read_cartridge
+#undef cpu_write_cartridge
+#undef cpu_read
+#undef cpu_read_uint16
+#undef cpu_write
+#undef cpu_stack_push
+#undef cpu_stack_push_uint16
+#undef cpu_stack_pop
+#undef cpu_stack_pop_uint16
+#undef cpu_interrupt
+#undef cpu_read_address
+#undef cpu_execute_adc_sbc
+#undef cpu_execute_adc
+#undef cpu_execute_sbc
+#undef cpu_execute_bitwise
+#undef cpu_execute_and
+#undef cpu_execute_eor
+#undef cpu_execute_ora
+#undef cpu_execute_shift
+#undef cpu_execute_asl
+#undef cpu_execute_lsr
+#undef cpu_execute_branch
+#undef cpu_execute_bcc
+#undef cpu_execute_bcs
+#undef cpu_execute_beq
+#undef cpu_execute_bmi
+#undef cpu_execute_bne
+#undef cpu_execute_bpl
+#undef cpu_execute_bvc
+#undef cpu_execute_bvs
+#undef cpu_execute_bit
+#undef cpu_execute_brk
+#undef cpu_execute_clc
+#undef cpu_execute_cld
+#undef cpu_execute_cli
+#undef cpu_execute_clv
+#undef cpu_execute_compare
+#undef cpu_execute_cmp
+#undef cpu_execute_cpx
+#undef cpu_execute_cpy
+#undef cpu_execute_dcp
+#undef cpu_execute_ign
+#undef cpu_execute_inc_dec
+#undef cpu_execute_dec
+#undef cpu_execute_dex
+#undef cpu_execute_dey
+#undef cpu_execute_inc
+#undef cpu_execute_inx
+#undef cpu_execute_iny
+#undef cpu_execute_isc
+#undef cpu_execute_jmp
+#undef cpu_execute_jsr
+#undef cpu_execute_lax
+#undef cpu_execute_load
+#undef cpu_execute_lda
+#undef cpu_execute_ldx
+#undef cpu_execute_ldy
+#undef cpu_execute_nop
+#undef cpu_execute_pha
+#undef cpu_execute_php
+#undef cpu_execute_pla
+#undef cpu_execute_plp
+#undef cpu_execute_rla
+#undef cpu_execute_rotate
+#undef cpu_execute_rol
+#undef cpu_execute_ror
+#undef cpu_execute_rra
+#undef cpu_execute_rti
+#undef cpu_execute_rts
+#undef cpu_execute_sax
+#undef cpu_execute_sec
+#undef cpu_execute_sed
+#undef cpu_execute_sei
+#undef cpu_execute_skb
+#undef cpu_execute_slo
+#undef cpu_execute_sre
+#undef cpu_execute_store
+#undef cpu_execute_sta
+#undef cpu_execute_stx
+#undef cpu_execute_sty
+#undef cpu_execute_transfer
+#undef cpu_execute_tax
+#undef cpu_execute_tay
+#undef cpu_execute_tsx
+#undef cpu_execute_txa
+#undef cpu_execute_txs
+#undef cpu_execute_tya
+#undef cpu_instructions
+#undef cpu_run_frame
+
+#undef CPU_CORE_PREFIX
+#undef CPU_CORE_GENERIC
+#undef CPU_CORE_MAPPER_WRITE
+#undef CPU_CORE_IRQ
\ No newline at end of file
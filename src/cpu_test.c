@@ -3,11 +3,17 @@
 #include <stdint.h>
 #include <string.h>
 #include <inttypes.h>
+#include <SDL2/SDL.h>
 #include "log.h"
+#include "hash.h"
+#include "cartridge.h"
+#include "ppu.h"
 #include "cpu_test.h"
 
 #define MODULE "CPUT"
 
+#define CPU_TEST_RUNS 3                     //timed runs of every core, the fastest one is reported
+
 typedef struct {
     uint16_t *PC;
     uint8_t *opcode;
@@ -20,6 +26,11 @@ typedef struct {
     unsigned int lines;
     bool loaded;
     unsigned int index;
+    uint32_t *frame_crcs;                   //what the CPU left in its RAM and the PPU after each frame with video
+    int frames;
+    int frame;
+    bool recording;
+    bool frames_match;
 } cpu_test_t;
 
 static cpu_test_t cpu_test;
@@ -9050,6 +9061,9 @@ cpu_test_free() {
     if (cpu_test.cycles != NULL) {
         free(cpu_test.cycles);
     }
+    if (cpu_test.frame_crcs != NULL) {
+        free(cpu_test.frame_crcs);
+    }
 }
 
 bool
@@ -9111,4 +9125,138 @@ cpu_test_check(uint16_t PC, uint8_t opcode, uint8_t A, uint8_t X, uint8_t Y, uin
 
     ++cpu_test.index;
     return match;
+}
+
+static bool
+cpu_test_run(const char *path, int frames, bool generic, double *ms) {
+    Uint64 start;
+    int i;
+
+    cpu_set_generic(generic);
+
+    //every run starts from the same cleared RAM, and a benchmark doesn't leave save files next to the ROMs
+    if (!cartridge_load(path, CARTRIDGE_LOAD_NO_SAVE)) {
+        return false;
+    }
+
+    cpu_power();
+    ppu_reset();
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < frames; i++) {
+        cpu_run_frame();
+    }
+    *ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+    cartridge_unload();
+
+    return true;
+}
+
+//keeps the fastest of the runs in best, the cores and video take turns so none of them gets a quieter machine
+static bool
+cpu_test_time(const char *path, int frames, bool generic, bool video, double *best) {
+    double ms;
+    bool success;
+
+    ppu_set_video(video);
+    success = cpu_test_run(path, frames, generic, &ms);
+    ppu_set_video(true);
+
+    if (success && (*best == 0.0 || ms < *best)) {
+        *best = ms;
+    }
+
+    return success;
+}
+
+//the CPU's RAM, and the nametables, palette and OAM it wrote to the PPU. the pattern tables follow the mapper, and CHR RAM
+//starts out as whatever was in the heap
+static void
+cpu_test_frame_ready(int index, void *framebuffer, void *data) {
+    static ppu_debug_t debug;
+    uint32_t crc;
+
+    if (cpu_test.frame_crcs == NULL || cpu_test.frame >= cpu_test.frames) {
+        return;
+    }
+
+    ppu_get_debug(&debug);
+    crc = hash_crc32(0, cpu_get_ram(), 0x800);
+    crc = hash_crc32(crc, debug.nametables, sizeof(debug.nametables));
+    crc = hash_crc32(crc, debug.palette, sizeof(debug.palette));
+    crc = hash_crc32(crc, debug.oam, sizeof(debug.oam));
+
+    if (cpu_test.recording) {
+        cpu_test.frame_crcs[cpu_test.frame] = crc;
+    }
+    else if (cpu_test.frames_match && cpu_test.frame_crcs[cpu_test.frame] != crc) {
+        log_err(MODULE, "Frame %d differs without video", cpu_test.frame);
+        cpu_test.frames_match = false;
+    }
+
+    cpu_test.frame++;
+}
+
+//runs a ROM with video and then timing only, the game has to see the same sprite 0 hits and end every frame the same.
+//hashing every frame takes time of its own, so these runs aren't the timed ones
+static bool
+cpu_test_compare_video(const char *path, int frames) {
+    double ms;
+    bool success;
+
+    cpu_test.frame_crcs = calloc(frames, sizeof(uint32_t));
+    if (cpu_test.frame_crcs == NULL) {
+        log_err(MODULE, "Failed to allocate %d frame CRCs", frames);
+        return false;
+    }
+    cpu_test.frames = frames;
+
+    ppu_set_frame_ready(cpu_test_frame_ready, NULL);
+
+    cpu_test.frame = 0;
+    cpu_test.recording = true;
+    success = cpu_test_run(path, frames, false, &ms);
+
+    ppu_set_video(false);
+    cpu_test.frame = 0;
+    cpu_test.recording = false;
+    cpu_test.frames_match = true;
+    success = success && cpu_test_run(path, frames, false, &ms);
+    ppu_set_video(true);
+
+    ppu_set_frame_ready(NULL, NULL);
+    free(cpu_test.frame_crcs);
+    cpu_test.frame_crcs = NULL;
+
+    return success && cpu_test.frames_match;
+}
+
+bool
+cpu_test_benchmark(const char **paths, int count, int frames) {
+    double generic, specialized, timing;
+    bool success = true, timed;
+    int i, j;
+
+    for (i = 0; i < count; i++) {
+        generic = specialized = timing = 0.0;
+        timed = true;
+        for (j = 0; timed && j < CPU_TEST_RUNS; j++) {
+            timed = cpu_test_time(paths[i], frames, true, true, &generic) &&
+                    cpu_test_time(paths[i], frames, false, true, &specialized) &&
+                    cpu_test_time(paths[i], frames, false, false, &timing);
+        }
+
+        if (!timed || !cpu_test_compare_video(paths[i], frames)) {
+            success = false;
+            continue;
+        }
+
+        log_info(MODULE, "%s: %d frames, generic core %.3f ms per frame, mapper core %.3f ms per frame (%+.1f%% speed), without video %.3f ms per frame",
+                 paths[i], frames, generic / frames, specialized / frames, (generic / specialized - 1.0) * 100.0, timing / frames);
+    }
+
+    cpu_set_generic(false);
+
+    return success;
 }
\ No newline at end of file
@@ -7,4 +7,8 @@ void cpu_test_init();
 void cpu_test_free();
 
 bool cpu_test_load();
-bool cpu_test_check(uint16_t PC, uint8_t opcode, uint8_t A, uint8_t X, uint8_t Y, uint8_t SP, uint8_t flags, int cycles);
\ No newline at end of file
+bool cpu_test_check(uint16_t PC, uint8_t opcode, uint8_t A, uint8_t X, uint8_t Y, uint8_t SP, uint8_t flags, int cycles);
+
+//times every ROM for frames with the generic CPU core, the one compiled for its mapper and that one without video, the
+//fastest of a few runs each, then checks the game ends every frame without video the same way it did with video
+bool cpu_test_benchmark(const char **paths, int count, int frames);
\ No newline at end of file
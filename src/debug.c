@@ -0,0 +1,426 @@
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "ppu.h"
+#include "debug.h"
+
+#define MODULE "Debug"
+
+#define DEBUG_FRESH         4               //set on the middle snapshot until the presentation thread picks it up
+#define DEBUG_ALPHA         0xFF000000
+#define DEBUG_TRANSPARENT   0xFF404040      //sprite pixels that show what's behind them
+#define DEBUG_PATTERNS      512             //tiles of both pattern tables
+
+typedef enum {
+    DEBUG_WINDOW_PATTERNS,
+    DEBUG_WINDOW_NAMETABLES,
+    DEBUG_WINDOW_PALETTE,
+    DEBUG_WINDOW_OAM,
+    DEBUG_WINDOW_COUNT
+} debug_window_type_t;
+
+typedef struct {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;
+    uint32_t *pixels;                       //what the texture holds
+    int width;
+    int height;
+    int dirty_top;                          //rows of pixels drawn since the texture was last updated
+    int dirty_bottom;
+} debug_window_t;
+
+typedef struct {
+    debug_window_t windows[DEBUG_WINDOW_COUNT];
+    SDL_atomic_t open;
+
+    //triple buffer of snapshots, like main's frames
+    ppu_debug_t snapshots[3];
+    int back;                               //emulation thread only
+    int front;                              //presentation thread only
+    SDL_atomic_t middle;                    //index of the middle snapshot, | DEBUG_FRESH if it wasn't drawn yet
+
+    //what the windows show, a tile is only drawn again if something it's drawn from changed since
+    ppu_debug_t drawn;
+    bool drawn_valid;
+    bool patterns_changed[DEBUG_PATTERNS];
+    uint32_t groups[8][4];                  //the 4 colors of each background then sprite palette
+    bool groups_changed[8];
+} debug_t;
+
+static const char *debug_titles[DEBUG_WINDOW_COUNT] = {"Pattern tables", "Nametables", "Palette", "OAM"};
+
+//texture size, then how much the window scales it up
+static const int debug_sizes[DEBUG_WINDOW_COUNT][3] = {
+    [DEBUG_WINDOW_PATTERNS]   = {256, 128, 2},
+    [DEBUG_WINDOW_NAMETABLES] = {512, 480, 1},
+    [DEBUG_WINDOW_PALETTE]    = {16, 2, 24},
+    [DEBUG_WINDOW_OAM]        = {64, 128, 4}     //8x8 grid of sprites, 8x16 each
+};
+
+static debug_t debug;
+
+void
+debug_init() {
+    memset(&debug, 0, sizeof(debug));
+    debug.back = 0;
+    SDL_AtomicSet(&debug.middle, 1);
+    debug.front = 2;
+}
+
+void
+debug_free() {
+    debug_close();
+}
+
+bool
+debug_open() {
+    debug_window_t *window;
+    int i;
+
+    debug_close();
+
+    for (i = 0; i < DEBUG_WINDOW_COUNT; i++) {
+        window = &debug.windows[i];
+        window->width = debug_sizes[i][0];
+        window->height = debug_sizes[i][1];
+
+        window->window = SDL_CreateWindow(debug_titles[i], SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window->width * debug_sizes[i][2], window->height * debug_sizes[i][2], SDL_WINDOW_SHOWN);
+        if (window->window == NULL) {
+            log_err(MODULE, "Failed to create SDL Window: %s", SDL_GetError());
+            debug_close();
+            return false;
+        }
+
+        window->renderer = SDL_CreateRenderer(window->window, -1, SDL_RENDERER_ACCELERATED);
+        if (window->renderer == NULL) {
+            log_err(MODULE, "Failed to create SDL renderer: %s", SDL_GetError());
+            debug_close();
+            return false;
+        }
+
+        window->texture = SDL_CreateTexture(window->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, window->width, window->height);
+        if (window->texture == NULL) {
+            log_err(MODULE, "Failed to create SDL texture: %s", SDL_GetError());
+            debug_close();
+            return false;
+        }
+
+        window->pixels = calloc(window->width * window->height, sizeof(uint32_t));
+        if (window->pixels == NULL) {
+            log_err(MODULE, "Out of memory");
+            debug_close();
+            return false;
+        }
+
+        window->dirty_top = window->height;
+        window->dirty_bottom = 0;
+    }
+
+    //everything is drawn from the first snapshot
+    debug.drawn_valid = false;
+    SDL_AtomicSet(&debug.open, 1);
+
+    return true;
+}
+
+void
+debug_close() {
+    debug_window_t *window;
+    int i;
+
+    SDL_AtomicSet(&debug.open, 0);
+
+    for (i = 0; i < DEBUG_WINDOW_COUNT; i++) {
+        window = &debug.windows[i];
+
+        if (window->texture != NULL) {
+            SDL_DestroyTexture(window->texture);
+        }
+        if (window->renderer != NULL) {
+            SDL_DestroyRenderer(window->renderer);
+        }
+        if (window->window != NULL) {
+            SDL_DestroyWindow(window->window);
+        }
+        free(window->pixels);
+
+        memset(window, 0, sizeof(*window));
+    }
+}
+
+bool
+debug_is_open() {
+    return SDL_AtomicGet(&debug.open) != 0;
+}
+
+bool
+debug_handle_event(const SDL_Event *e) {
+    int i;
+
+    if (e->type != SDL_WINDOWEVENT) {
+        return false;
+    }
+
+    for (i = 0; i < DEBUG_WINDOW_COUNT; i++) {
+        if (debug.windows[i].window != NULL && SDL_GetWindowID(debug.windows[i].window) == e->window.windowID) {
+            //closing any of them closes them all
+            if (e->window.event == SDL_WINDOWEVENT_CLOSE) {
+                debug_close();
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+debug_capture() {
+    if (!SDL_AtomicGet(&debug.open)) {
+        return;
+    }
+
+    ppu_get_debug(&debug.snapshots[debug.back]);
+
+    SDL_MemoryBarrierRelease();
+    debug.back = SDL_AtomicSet(&debug.middle, debug.back | DEBUG_FRESH) & ~DEBUG_FRESH;
+    SDL_MemoryBarrierAcquire();
+}
+
+//an 8x8 tile with colors[0] for its transparent pixels
+static void
+debug_draw_tile(debug_window_t *window, int x, int y, const uint8_t *pattern, const uint32_t *colors) {
+    uint32_t *out;
+    int row, column, value;
+
+    for (row = 0; row < 8; row++) {
+        out = window->pixels + (y + row) * window->width + x;
+
+        for (column = 0; column < 8; column++) {
+            value = ((pattern[row] >> (7 - column)) & 0x01) | (((pattern[row + 8] >> (7 - column)) & 0x01) << 1);
+            out[column] = colors[value];
+        }
+    }
+
+    if (y < window->dirty_top) {
+        window->dirty_top = y;
+    }
+    if (y + 8 > window->dirty_bottom) {
+        window->dirty_bottom = y + 8;
+    }
+}
+
+static void
+debug_fill(debug_window_t *window, int x, int y, int width, int height, uint32_t color) {
+    int row, column;
+
+    for (row = y; row < y + height; row++) {
+        for (column = x; column < x + width; column++) {
+            window->pixels[row * window->width + column] = color;
+        }
+    }
+
+    if (y < window->dirty_top) {
+        window->dirty_top = y;
+    }
+    if (y + height > window->dirty_bottom) {
+        window->dirty_bottom = y + height;
+    }
+}
+
+//which pattern tiles and palettes changed since the windows were drawn
+static void
+debug_compare(const ppu_debug_t *snapshot) {
+    uint32_t colors[4];
+    int i, c;
+
+    for (i = 0; i < DEBUG_PATTERNS; i++) {
+        debug.patterns_changed[i] = !debug.drawn_valid || memcmp(snapshot->chr + i * 16, debug.drawn.chr + i * 16, 16) != 0;
+    }
+
+    //a pixel of value 0 is always the backdrop color
+    for (i = 0; i < 8; i++) {
+        colors[0] = snapshot->colors[0] | DEBUG_ALPHA;
+        for (c = 1; c < 4; c++) {
+            colors[c] = snapshot->colors[i * 4 + c] | DEBUG_ALPHA;
+        }
+
+        debug.groups_changed[i] = !debug.drawn_valid || memcmp(colors, debug.groups[i], sizeof(colors)) != 0;
+        memcpy(debug.groups[i], colors, sizeof(colors));
+    }
+}
+
+//both pattern tables side by side with the first background palette
+static void
+debug_draw_patterns(const ppu_debug_t *snapshot) {
+    debug_window_t *window = &debug.windows[DEBUG_WINDOW_PATTERNS];
+    int i;
+
+    for (i = 0; i < DEBUG_PATTERNS; i++) {
+        if (debug.patterns_changed[i] || debug.groups_changed[0]) {
+            debug_draw_tile(window, (i / 256) * 128 + (i % 16) * 8, ((i % 256) / 16) * 8, snapshot->chr + i * 16, debug.groups[0]);
+        }
+    }
+}
+
+static int
+debug_tile_group(const uint8_t *nametable, int x, int y) {
+    return (nametable[0x3C0 + (y / 4) * 8 + x / 4] >> (((y % 4) / 2) * 4 + ((x % 4) / 2) * 2)) & 0x03;
+}
+
+static void
+debug_draw_nametables(const ppu_debug_t *snapshot) {
+    debug_window_t *window = &debug.windows[DEBUG_WINDOW_NAMETABLES];
+    const ppu_debug_t *drawn = &debug.drawn;
+    int n, x, y, tile, group, pattern;
+    bool table_changed;
+
+    table_changed = !debug.drawn_valid || snapshot->background_table != drawn->background_table;
+
+    for (n = 0; n < 4; n++) {
+        for (y = 0; y < 30; y++) {
+            for (x = 0; x < 32; x++) {
+                tile = snapshot->nametables[n][y * 32 + x];
+                group = debug_tile_group(snapshot->nametables[n], x, y);
+                pattern = snapshot->background_table * 256 + tile;
+
+                if (!table_changed && !debug.patterns_changed[pattern] && !debug.groups_changed[group] &&
+                    tile == drawn->nametables[n][y * 32 + x] && group == debug_tile_group(drawn->nametables[n], x, y)) {
+                    continue;
+                }
+
+                debug_draw_tile(window, (n % 2) * 256 + x * 8, (n / 2) * 240 + y * 8, snapshot->chr + pattern * 16, debug.groups[group]);
+            }
+        }
+    }
+}
+
+static void
+debug_draw_palette(const ppu_debug_t *snapshot) {
+    debug_window_t *window = &debug.windows[DEBUG_WINDOW_PALETTE];
+    int i;
+
+    for (i = 0; i < 0x20; i++) {
+        if (!debug.drawn_valid || snapshot->colors[i] != debug.drawn.colors[i]) {
+            debug_fill(window, i % 16, i / 16, 1, 1, snapshot->colors[i] | DEBUG_ALPHA);
+        }
+    }
+}
+
+//the 64 sprites in OAM order, as stored without flipping
+static void
+debug_draw_oam(const ppu_debug_t *snapshot) {
+    debug_window_t *window = &debug.windows[DEBUG_WINDOW_OAM];
+    const uint8_t *sprite, *old;
+    uint32_t colors[4];
+    int i, x, y, group, pattern;
+    bool mode_changed;
+
+    mode_changed = !debug.drawn_valid || snapshot->sprites_8x16 != debug.drawn.sprites_8x16 || snapshot->sprite_table != debug.drawn.sprite_table;
+
+    for (i = 0; i < 64; i++) {
+        sprite = snapshot->oam + i * 4;
+        old = debug.drawn.oam + i * 4;
+        group = 4 + (sprite[2] & 0x03);
+
+        if (snapshot->sprites_8x16) {
+            pattern = (sprite[1] & 0x01) * 256 + (sprite[1] & 0xFE);
+        }
+        else {
+            pattern = snapshot->sprite_table * 256 + sprite[1];
+        }
+
+        if (!mode_changed && !debug.groups_changed[group] && !debug.patterns_changed[pattern] &&
+            (!snapshot->sprites_8x16 || !debug.patterns_changed[pattern + 1]) && sprite[1] == old[1] && (sprite[2] & 0x03) == (old[2] & 0x03)) {
+            continue;
+        }
+
+        memcpy(colors, debug.groups[group], sizeof(colors));
+        colors[0] = DEBUG_TRANSPARENT;
+
+        x = (i % 8) * 8;
+        y = (i / 8) * 16;
+        debug_draw_tile(window, x, y, snapshot->chr + pattern * 16, colors);
+        if (snapshot->sprites_8x16) {
+            debug_draw_tile(window, x, y + 8, snapshot->chr + (pattern + 1) * 16, colors);
+        }
+        else {
+            debug_fill(window, x, y + 8, 8, 8, 0xFF000000);
+        }
+    }
+}
+
+//the part of the nametables that's on screen, wrapped around the edges
+static void
+debug_draw_viewport(const ppu_debug_t *snapshot) {
+    SDL_Renderer *renderer = debug.windows[DEBUG_WINDOW_NAMETABLES].renderer;
+    SDL_Rect rect;
+    int x, y;
+
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0x00, 0x00, 0xFF);
+
+    for (x = 0; x < 2; x++) {
+        for (y = 0; y < 2; y++) {
+            rect.x = snapshot->scroll_x - x * 512;
+            rect.y = snapshot->scroll_y - y * 480;
+            rect.w = 256;
+            rect.h = 240;
+            SDL_RenderDrawRect(renderer, &rect);
+        }
+    }
+}
+
+static void
+debug_present(debug_window_t *window) {
+    SDL_Rect rect;
+
+    //only the rows that were drawn go to the texture
+    if (window->dirty_top < window->dirty_bottom) {
+        rect.x = 0;
+        rect.y = window->dirty_top;
+        rect.w = window->width;
+        rect.h = window->dirty_bottom - window->dirty_top;
+        SDL_UpdateTexture(window->texture, &rect, window->pixels + window->dirty_top * window->width, window->width * sizeof(uint32_t));
+
+        window->dirty_top = window->height;
+        window->dirty_bottom = 0;
+    }
+
+    SDL_SetRenderDrawColor(window->renderer, 0x00, 0x00, 0x00, 0xFF);
+    SDL_RenderClear(window->renderer);
+    SDL_RenderCopy(window->renderer, window->texture, NULL, NULL);
+}
+
+void
+debug_update() {
+    ppu_debug_t *snapshot;
+    int i;
+
+    if (!SDL_AtomicGet(&debug.open) || !(SDL_AtomicGet(&debug.middle) & DEBUG_FRESH)) {
+        return;
+    }
+
+    SDL_MemoryBarrierRelease();
+    debug.front = SDL_AtomicSet(&debug.middle, debug.front) & ~DEBUG_FRESH;
+    SDL_MemoryBarrierAcquire();
+
+    snapshot = &debug.snapshots[debug.front];
+
+    debug_compare(snapshot);
+    debug_draw_patterns(snapshot);
+    debug_draw_nametables(snapshot);
+    debug_draw_palette(snapshot);
+    debug_draw_oam(snapshot);
+
+    debug.drawn = *snapshot;
+    debug.drawn_valid = true;
+
+    for (i = 0; i < DEBUG_WINDOW_COUNT; i++) {
+        debug_present(&debug.windows[i]);
+        if (i == DEBUG_WINDOW_NAMETABLES) {
+            debug_draw_viewport(snapshot);
+        }
+        SDL_RenderPresent(debug.windows[i].renderer);
+    }
+}
\ No newline at end of file
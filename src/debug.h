@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+void debug_init();
+void debug_free();
+
+//windows for the pattern tables, nametables, palette RAM and OAM, everything but debug_capture() runs on the
+//presentation thread
+bool debug_open();
+void debug_close();
+bool debug_is_open();
+
+//redraws what changed in the newest snapshot, if there's a new one
+void debug_update();
+
+//returns true if the event was for one of the debug windows
+bool debug_handle_event(const SDL_Event *e);
+
+//runs on the emulation thread at the end of a frame, takes a snapshot of the PPU while the windows are open
+void debug_capture();
\ No newline at end of file
@@ -0,0 +1,858 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define FILTER_SSE2
+#endif
+#include "log.h"
+#include "ntsc.h"
+#include "filter.h"
+
+#define MODULE "Filter"
+
+#define FILTER_WIDTH        256
+#define FILTER_HEIGHT       240
+#define FILTER_PAD          2                   //xBR looks 2 pixels away
+#define FILTER_STRIDE       (FILTER_WIDTH + FILTER_PAD * 2)
+#define FILTER_MAX_THREADS  16
+
+//hqx's thresholds for two colors to count as the same, xBR weighs the differences by the same numbers
+#define FILTER_Y_THRESHOLD  48
+#define FILTER_U_THRESHOLD  7
+#define FILTER_V_THRESHOLD  6
+
+//bits of filter_worker_t.similar, whether a pixel is similar to the one to its right, below, below right, below left
+#define FILTER_SIMILAR_RIGHT        (1 << 0)
+#define FILTER_SIMILAR_DOWN         (1 << 1)
+#define FILTER_SIMILAR_DOWN_RIGHT   (1 << 2)
+#define FILTER_SIMILAR_DOWN_LEFT    (1 << 3)
+
+typedef struct {
+    SDL_Thread *thread;
+    SDL_sem *start;
+    int index;
+    uint32_t *colors;                           //the worker's band plus FILTER_PAD pixels of edge around it
+    uint32_t *yuv;                              //same, as Y << 16 | U << 8 | V
+    uint8_t *similar;                           //FILTER_SIMILAR_* of every pixel of the band, for smooth2x
+    uint32_t *down_right;                       //xBR distance of every pixel of the band to the one below right
+    uint32_t *down_left;                        //and below left
+} filter_worker_t;
+
+typedef struct {
+    filter_worker_t workers[FILTER_MAX_THREADS];
+    int threads;
+    SDL_sem *done;
+    bool quit;
+
+    //the frame being filtered, set before the workers are started
+    filter_type_t type;
+    const uint8_t *in;
+    int in_pitch;
+    uint8_t *out;
+    int out_pitch;
+    int burst;                                  //color burst phase of the first line, advances every NTSC frame
+} filter_t;
+
+static const char *filter_names[FILTER_COUNT] = {"none", "scale2x", "scale3x", "smooth2x", "xbr2x", "ntsc"};
+static const int filter_scales[FILTER_COUNT] = {1, 2, 3, 2, 2, 1};
+
+static filter_t filter;
+
+void
+filter_init() {
+    memset(&filter, 0, sizeof(filter));
+}
+
+void
+filter_free() {
+    filter_close();
+}
+
+filter_type_t
+filter_find(const char *name) {
+    int i;
+
+    for (i = 0; i < FILTER_COUNT; i++) {
+        if (strcmp(filter_names[i], name) == 0) {
+            return i;
+        }
+    }
+
+    return FILTER_COUNT;
+}
+
+const char *
+filter_get_name(filter_type_t type) {
+    return filter_names[type];
+}
+
+int
+filter_get_width(filter_type_t type) {
+    return type == FILTER_NTSC ? NTSC_WIDTH : FILTER_WIDTH * filter_scales[type];
+}
+
+int
+filter_get_height(filter_type_t type) {
+    return FILTER_HEIGHT * filter_scales[type];
+}
+
+#if !defined(FILTER_SSE2)
+//4 colors averaged, pass one several times to weigh it
+static uint32_t
+filter_mix(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t rb, g;
+
+    rb = (a & 0xFF00FF) + (b & 0xFF00FF) + (c & 0xFF00FF) + (d & 0xFF00FF);
+    g = (a & 0x00FF00) + (b & 0x00FF00) + (c & 0x00FF00) + (d & 0x00FF00);
+
+    return 0xFF000000 | ((rb >> 2) & 0xFF00FF) | ((g >> 2) & 0x00FF00);
+}
+
+static bool
+filter_same(uint32_t a, uint32_t b) {
+    return abs((int)(a >> 16) - (int)(b >> 16)) <= FILTER_Y_THRESHOLD &&
+           abs((int)((a >> 8) & 0xFF) - (int)((b >> 8) & 0xFF)) <= FILTER_U_THRESHOLD &&
+           abs((int)(a & 0xFF) - (int)(b & 0xFF)) <= FILTER_V_THRESHOLD;
+}
+
+static int
+filter_distance(uint32_t a, uint32_t b) {
+    return abs((int)(a >> 16) - (int)(b >> 16)) * FILTER_Y_THRESHOLD +
+           abs((int)((a >> 8) & 0xFF) - (int)((b >> 8) & 0xFF)) * FILTER_U_THRESHOLD +
+           abs((int)(a & 0xFF) - (int)(b & 0xFF)) * FILTER_V_THRESHOLD;
+}
+#else
+//filter_distance() of 4 pixels, the weighted sum of the absolute differences of the components. madd leaves 2 halves per
+//pixel to be added up
+static __m128i
+filter_distance4(__m128i a, __m128i b) {
+    __m128i zero, weights, difference;
+    __m128 low, high;
+
+    zero = _mm_setzero_si128();
+    weights = _mm_set_epi16(0, FILTER_Y_THRESHOLD, FILTER_U_THRESHOLD, FILTER_V_THRESHOLD, 0, FILTER_Y_THRESHOLD, FILTER_U_THRESHOLD, FILTER_V_THRESHOLD);
+
+    difference = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    low = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(difference, zero), weights));
+    high = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(difference, zero), weights));
+
+    return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))));
+}
+#endif
+
+//hqx's YUV, Y = (R + G + B) / 4, U = 128 + (R - B) / 4, V = 128 + (2G - R - B) / 8
+static void
+filter_yuv_row(uint32_t *out, const uint32_t *in) {
+    int x;
+
+#if defined(FILTER_SSE2)
+    __m128i mask, bias, pixels, r, g, b, y, u, v;
+
+    mask = _mm_set1_epi32(0xFF);
+    bias = _mm_set1_epi32(128);
+    for (x = 0; x < FILTER_STRIDE; x += 4) {
+        pixels = _mm_loadu_si128((const __m128i *)(in + x));
+        r = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+        g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+        b = _mm_and_si128(pixels, mask);
+
+        y = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(r, g), b), 2);
+        u = _mm_add_epi32(bias, _mm_srai_epi32(_mm_sub_epi32(r, b), 2));
+        v = _mm_add_epi32(bias, _mm_srai_epi32(_mm_sub_epi32(_mm_add_epi32(g, g), _mm_add_epi32(r, b)), 3));
+
+        _mm_storeu_si128((__m128i *)(out + x), _mm_or_si128(_mm_or_si128(_mm_slli_epi32(y, 16), _mm_slli_epi32(u, 8)), v));
+    }
+#else
+    int r, g, b;
+
+    for (x = 0; x < FILTER_STRIDE; x++) {
+        r = (in[x] >> 16) & 0xFF;
+        g = (in[x] >> 8) & 0xFF;
+        b = in[x] & 0xFF;
+
+        out[x] = ((r + g + b) >> 2) << 16 | (128 + ((r - b) >> 2)) << 8 | (128 + ((g * 2 - r - b) >> 3));
+    }
+#endif
+}
+
+//the similarity bits of a padded row, yuv is followed by the next row
+static void
+filter_similar_row(uint8_t *out, const uint32_t *yuv) {
+    int x;
+
+#if defined(FILTER_SSE2)
+    __m128i zero, thresholds, e, right, down, down_right, down_left;
+    int masks[4], i;
+
+    zero = _mm_setzero_si128();
+    thresholds = _mm_set1_epi32(0xFF000000 | FILTER_Y_THRESHOLD << 16 | FILTER_U_THRESHOLD << 8 | FILTER_V_THRESHOLD);
+
+//all 4 components within the thresholds, one bit per pixel
+#define FILTER_SIMILAR(a, b) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(zero, _mm_subs_epu8(_mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a)), thresholds))))
+
+    for (x = 0; x < FILTER_STRIDE - 1; x += 4) {
+        e = _mm_loadu_si128((const __m128i *)(yuv + x));
+        right = _mm_loadu_si128((const __m128i *)(yuv + x + 1));
+        down = _mm_loadu_si128((const __m128i *)(yuv + x + FILTER_STRIDE));
+        down_right = _mm_loadu_si128((const __m128i *)(yuv + x + FILTER_STRIDE + 1));
+        down_left = _mm_loadu_si128((const __m128i *)(yuv + x + FILTER_STRIDE - 1));
+
+        masks[0] = FILTER_SIMILAR(e, right);
+        masks[1] = FILTER_SIMILAR(e, down);
+        masks[2] = FILTER_SIMILAR(e, down_right);
+        masks[3] = FILTER_SIMILAR(e, down_left);
+
+        for (i = 0; i < 4; i++) {
+            out[x + i] = ((masks[0] >> i) & 1) | ((masks[1] >> i) & 1) << 1 | ((masks[2] >> i) & 1) << 2 | ((masks[3] >> i) & 1) << 3;
+        }
+    }
+
+#undef FILTER_SIMILAR
+#else
+    for (x = 0; x < FILTER_STRIDE; x++) {
+        out[x] = (filter_same(yuv[x], yuv[x + 1]) ? FILTER_SIMILAR_RIGHT : 0) |
+                 (filter_same(yuv[x], yuv[x + FILTER_STRIDE]) ? FILTER_SIMILAR_DOWN : 0) |
+                 (filter_same(yuv[x], yuv[x + FILTER_STRIDE + 1]) ? FILTER_SIMILAR_DOWN_RIGHT : 0) |
+                 (filter_same(yuv[x], yuv[x + FILTER_STRIDE - 1]) ? FILTER_SIMILAR_DOWN_LEFT : 0);
+    }
+#endif
+}
+
+//every distance xBR looks at is between diagonal neighbors, so they're worked out once per pixel
+static void
+filter_distance_row(uint32_t *down_right, uint32_t *down_left, const uint32_t *yuv) {
+    int x;
+
+#if defined(FILTER_SSE2)
+    __m128i e;
+
+    for (x = 0; x < FILTER_STRIDE; x += 4) {
+        e = _mm_loadu_si128((const __m128i *)(yuv + x));
+
+        _mm_storeu_si128((__m128i *)(down_right + x), filter_distance4(e, _mm_loadu_si128((const __m128i *)(yuv + x + FILTER_STRIDE + 1))));
+        _mm_storeu_si128((__m128i *)(down_left + x), filter_distance4(e, _mm_loadu_si128((const __m128i *)(yuv + x + FILTER_STRIDE - 1))));
+    }
+#else
+    for (x = 0; x < FILTER_STRIDE; x++) {
+        down_right[x] = filter_distance(yuv[x], yuv[x + FILTER_STRIDE + 1]);
+        down_left[x] = filter_distance(yuv[x], yuv[x + FILTER_STRIDE - 1]);
+    }
+#endif
+}
+
+//which FILTER_SIMILAR_* bit of the first of the pixels at a and b of a band says whether they're similar, they have to be
+//neighbors in one of the 4 directions
+static int
+filter_similar_bit(int a, int b, int *first) {
+    int offset;
+
+    *first = a < b ? a : b;
+    offset = a < b ? b - a : a - b;
+
+    if (offset == 1) {
+        return FILTER_SIMILAR_RIGHT;
+    }
+    if (offset == FILTER_STRIDE) {
+        return FILTER_SIMILAR_DOWN;
+    }
+    if (offset == FILTER_STRIDE + 1) {
+        return FILTER_SIMILAR_DOWN_RIGHT;
+    }
+
+    return FILTER_SIMILAR_DOWN_LEFT;
+}
+
+//distances between the pixels at a and b of a band and the pixels right of them, they have to be diagonal neighbors
+static const uint32_t *
+filter_diagonal_distances(const filter_worker_t *worker, int a, int b) {
+    int first, offset;
+
+    first = a < b ? a : b;
+    offset = a < b ? b - a : a - b;
+
+    return offset == FILTER_STRIDE + 1 ? worker->down_right + first : worker->down_left + first;
+}
+
+#if defined(FILTER_SSE2)
+static __m128i
+filter_select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+//filter_mix() of 4 pixels
+static __m128i
+filter_mix4(__m128i a, __m128i b, __m128i c, __m128i d) {
+    __m128i rb_mask, g_mask, rb, g;
+
+    rb_mask = _mm_set1_epi32(0xFF00FF);
+    g_mask = _mm_set1_epi32(0x00FF00);
+    rb = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a, rb_mask), _mm_and_si128(b, rb_mask)), _mm_add_epi32(_mm_and_si128(c, rb_mask), _mm_and_si128(d, rb_mask)));
+    g = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a, g_mask), _mm_and_si128(b, g_mask)), _mm_add_epi32(_mm_and_si128(c, g_mask), _mm_and_si128(d, g_mask)));
+
+    return _mm_or_si128(_mm_set1_epi32(0xFF000000), _mm_or_si128(_mm_and_si128(_mm_srli_epi32(rb, 2), rb_mask), _mm_and_si128(_mm_srli_epi32(g, 2), g_mask)));
+}
+
+//whether the 4 pixels from a of a band are similar to the 4 from b, all bits set in the lanes where they are
+static __m128i
+filter_similar4(const uint8_t *similar, int a, int b) {
+    __m128i zero, bit, bits;
+    int32_t word;
+    int first;
+
+    zero = _mm_setzero_si128();
+    bit = _mm_set1_epi32(filter_similar_bit(a, b, &first));
+    memcpy(&word, similar + first, sizeof(word));
+    bits = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero), zero);
+
+    return _mm_cmpeq_epi32(_mm_and_si128(bits, bit), bit);
+}
+#else
+//whether the pixels at a and b of a band are similar
+static bool
+filter_similar(const uint8_t *similar, int a, int b) {
+    int first, bit;
+
+    bit = filter_similar_bit(a, b, &first);
+
+    return similar[first] & bit;
+}
+#endif
+
+//AdvMAME2x, e points at the row's first pixel in a padded band
+static void
+filter_scale2x_row(const uint32_t *e, uint32_t *out0, uint32_t *out1) {
+    int x;
+
+#if defined(FILTER_SSE2)
+    __m128i B, D, E, F, H, flat, e0, e1, e2, e3;
+
+    for (x = 0; x < FILTER_WIDTH; x += 4) {
+        B = _mm_loadu_si128((const __m128i *)(e + x - FILTER_STRIDE));
+        D = _mm_loadu_si128((const __m128i *)(e + x - 1));
+        E = _mm_loadu_si128((const __m128i *)(e + x));
+        F = _mm_loadu_si128((const __m128i *)(e + x + 1));
+        H = _mm_loadu_si128((const __m128i *)(e + x + FILTER_STRIDE));
+
+        flat = _mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F));
+        e0 = filter_select(_mm_andnot_si128(flat, _mm_cmpeq_epi32(D, B)), D, E);
+        e1 = filter_select(_mm_andnot_si128(flat, _mm_cmpeq_epi32(B, F)), F, E);
+        e2 = filter_select(_mm_andnot_si128(flat, _mm_cmpeq_epi32(D, H)), D, E);
+        e3 = filter_select(_mm_andnot_si128(flat, _mm_cmpeq_epi32(H, F)), F, E);
+
+        _mm_storeu_si128((__m128i *)(out0 + x * 2), _mm_unpacklo_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out0 + x * 2 + 4), _mm_unpackhi_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out1 + x * 2), _mm_unpacklo_epi32(e2, e3));
+        _mm_storeu_si128((__m128i *)(out1 + x * 2 + 4), _mm_unpackhi_epi32(e2, e3));
+    }
+#else
+    uint32_t B, D, E, F, H;
+
+    for (x = 0; x < FILTER_WIDTH; x++) {
+        B = e[x - FILTER_STRIDE];
+        D = e[x - 1];
+        E = e[x];
+        F = e[x + 1];
+        H = e[x + FILTER_STRIDE];
+
+        if (B != H && D != F) {
+            out0[x * 2] = D == B ? D : E;
+            out0[x * 2 + 1] = B == F ? F : E;
+            out1[x * 2] = D == H ? D : E;
+            out1[x * 2 + 1] = H == F ? F : E;
+        }
+        else {
+            out0[x * 2] = out0[x * 2 + 1] = out1[x * 2] = out1[x * 2 + 1] = E;
+        }
+    }
+#endif
+}
+
+//AdvMAME3x
+static void
+filter_scale3x_row(const uint32_t *e, uint32_t *out0, uint32_t *out1, uint32_t *out2) {
+    uint32_t results[9][FILTER_WIDTH];
+    int x, i;
+
+#if defined(FILTER_SSE2)
+    __m128i A, B, C, D, E, F, G, H, I, edge, db, bf, dh, hf;
+
+    for (x = 0; x < FILTER_WIDTH; x += 4) {
+        A = _mm_loadu_si128((const __m128i *)(e + x - FILTER_STRIDE - 1));
+        B = _mm_loadu_si128((const __m128i *)(e + x - FILTER_STRIDE));
+        C = _mm_loadu_si128((const __m128i *)(e + x - FILTER_STRIDE + 1));
+        D = _mm_loadu_si128((const __m128i *)(e + x - 1));
+        E = _mm_loadu_si128((const __m128i *)(e + x));
+        F = _mm_loadu_si128((const __m128i *)(e + x + 1));
+        G = _mm_loadu_si128((const __m128i *)(e + x + FILTER_STRIDE - 1));
+        H = _mm_loadu_si128((const __m128i *)(e + x + FILTER_STRIDE));
+        I = _mm_loadu_si128((const __m128i *)(e + x + FILTER_STRIDE + 1));
+
+        //every comparison is masked with the edge test up front
+        edge = _mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F));
+        db = _mm_andnot_si128(edge, _mm_cmpeq_epi32(D, B));
+        bf = _mm_andnot_si128(edge, _mm_cmpeq_epi32(B, F));
+        dh = _mm_andnot_si128(edge, _mm_cmpeq_epi32(D, H));
+        hf = _mm_andnot_si128(edge, _mm_cmpeq_epi32(H, F));
+
+        _mm_storeu_si128((__m128i *)(results[0] + x), filter_select(db, D, E));
+        _mm_storeu_si128((__m128i *)(results[1] + x), filter_select(_mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi32(E, C), db), _mm_andnot_si128(_mm_cmpeq_epi32(E, A), bf)), B, E));
+        _mm_storeu_si128((__m128i *)(results[2] + x), filter_select(bf, F, E));
+        _mm_storeu_si128((__m128i *)(results[3] + x), filter_select(_mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi32(E, G), db), _mm_andnot_si128(_mm_cmpeq_epi32(E, A), dh)), D, E));
+        _mm_storeu_si128((__m128i *)(results[4] + x), E);
+        _mm_storeu_si128((__m128i *)(results[5] + x), filter_select(_mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi32(E, I), bf), _mm_andnot_si128(_mm_cmpeq_epi32(E, C), hf)), F, E));
+        _mm_storeu_si128((__m128i *)(results[6] + x), filter_select(dh, D, E));
+        _mm_storeu_si128((__m128i *)(results[7] + x), filter_select(_mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi32(E, I), dh), _mm_andnot_si128(_mm_cmpeq_epi32(E, G), hf)), H, E));
+        _mm_storeu_si128((__m128i *)(results[8] + x), filter_select(hf, F, E));
+    }
+#else
+    uint32_t A, B, C, D, E, F, G, H, I;
+
+    for (x = 0; x < FILTER_WIDTH; x++) {
+        A = e[x - FILTER_STRIDE - 1];
+        B = e[x - FILTER_STRIDE];
+        C = e[x - FILTER_STRIDE + 1];
+        D = e[x - 1];
+        E = e[x];
+        F = e[x + 1];
+        G = e[x + FILTER_STRIDE - 1];
+        H = e[x + FILTER_STRIDE];
+        I = e[x + FILTER_STRIDE + 1];
+
+        if (B != H && D != F) {
+            results[0][x] = D == B ? D : E;
+            results[1][x] = (D == B && E != C) || (B == F && E != A) ? B : E;
+            results[2][x] = B == F ? F : E;
+            results[3][x] = (D == B && E != G) || (D == H && E != A) ? D : E;
+            results[4][x] = E;
+            results[5][x] = (B == F && E != I) || (H == F && E != C) ? F : E;
+            results[6][x] = D == H ? D : E;
+            results[7][x] = (D == H && E != I) || (H == F && E != G) ? H : E;
+            results[8][x] = H == F ? F : E;
+        }
+        else {
+            for (i = 0; i < 9; i++) {
+                results[i][x] = E;
+            }
+        }
+    }
+#endif
+
+    for (x = 0; x < FILTER_WIDTH; x++) {
+        for (i = 0; i < 3; i++) {
+            out0[x * 3 + i] = results[i][x];
+            out1[x * 3 + i] = results[3 + i][x];
+            out2[x * 3 + i] = results[6 + i][x];
+        }
+    }
+}
+
+//one output pixel of smooth2x at pixel p of the band, sx and sy point towards the corner. not hq2x's 256 pattern table
+//but 3 rules on hqx's YUV similarity: an edge running across the corner blends its 2 sides in, a pixel that differs from
+//its diagonal neighbor is softened towards it, anything else stays as it is
+#if defined(FILTER_SSE2)
+static __m128i
+filter_smooth2x_corner4(const filter_worker_t *worker, int p, int sx, int sy) {
+    const uint32_t *colors = worker->colors;
+    __m128i E, side1, side2, diagonal, across, softened;
+    int s1, s2, d;
+
+    s1 = p + sx;
+    s2 = p + sy * FILTER_STRIDE;
+    d = s2 + sx;
+
+    E = _mm_loadu_si128((const __m128i *)(colors + p));
+    side1 = _mm_loadu_si128((const __m128i *)(colors + s1));
+    side2 = _mm_loadu_si128((const __m128i *)(colors + s2));
+    diagonal = _mm_loadu_si128((const __m128i *)(colors + d));
+
+    across = _mm_andnot_si128(filter_similar4(worker->similar, p, s1), filter_similar4(worker->similar, s1, s2));
+    softened = filter_select(filter_similar4(worker->similar, p, d), E, filter_mix4(E, E, E, diagonal));
+
+    return filter_select(across, filter_mix4(E, E, side1, side2), softened);
+}
+#else
+static uint32_t
+filter_smooth2x_corner(const filter_worker_t *worker, int p, int sx, int sy) {
+    const uint32_t *colors = worker->colors;
+    int side1, side2, diagonal;
+
+    side1 = p + sx;
+    side2 = p + sy * FILTER_STRIDE;
+    diagonal = side2 + sx;
+
+    if (filter_similar(worker->similar, side1, side2) && !filter_similar(worker->similar, p, side1)) {
+        return filter_mix(colors[p], colors[p], colors[side1], colors[side2]);
+    }
+
+    if (!filter_similar(worker->similar, p, diagonal)) {
+        return filter_mix(colors[p], colors[p], colors[p], colors[diagonal]);
+    }
+
+    return colors[p];
+}
+#endif
+
+static void
+filter_smooth2x_row(const filter_worker_t *worker, int p, uint32_t *out0, uint32_t *out1) {
+    int x;
+
+#if defined(FILTER_SSE2)
+    __m128i e0, e1, e2, e3;
+
+    for (x = 0; x < FILTER_WIDTH; x += 4, p += 4) {
+        e0 = filter_smooth2x_corner4(worker, p, -1, -1);
+        e1 = filter_smooth2x_corner4(worker, p, 1, -1);
+        e2 = filter_smooth2x_corner4(worker, p, -1, 1);
+        e3 = filter_smooth2x_corner4(worker, p, 1, 1);
+
+        _mm_storeu_si128((__m128i *)(out0 + x * 2), _mm_unpacklo_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out0 + x * 2 + 4), _mm_unpackhi_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out1 + x * 2), _mm_unpacklo_epi32(e2, e3));
+        _mm_storeu_si128((__m128i *)(out1 + x * 2 + 4), _mm_unpackhi_epi32(e2, e3));
+    }
+#else
+    for (x = 0; x < FILTER_WIDTH; x++, p++) {
+        out0[x * 2] = filter_smooth2x_corner(worker, p, -1, -1);
+        out0[x * 2 + 1] = filter_smooth2x_corner(worker, p, 1, -1);
+        out1[x * 2] = filter_smooth2x_corner(worker, p, -1, 1);
+        out1[x * 2 + 1] = filter_smooth2x_corner(worker, p, 1, 1);
+    }
+#endif
+}
+
+//one output pixel of a level 1 xBR at pixel p of the band, named for the bottom right corner with sx and sy flipping
+//it to the others
+#if defined(FILTER_SSE2)
+static __m128i
+filter_xbr2x_corner4(const filter_worker_t *worker, int p, int sx, int sy) {
+    const uint32_t *colors = worker->colors;
+    const uint32_t *yuv = worker->yuv;
+    __m128i E, edge, across, closer, blended;
+    int row, B, C, D, F, G, H, I, F4, I4, H5, I5;
+
+    row = sy * FILTER_STRIDE;
+    B = p - row;
+    C = p + sx - row;
+    D = p - sx;
+    F = p + sx;
+    G = p + row - sx;
+    H = p + row;
+    I = p + row + sx;
+    F4 = p + sx * 2;
+    I4 = p + row + sx * 2;
+    H5 = p + row * 2;
+    I5 = p + row * 2 + sx;
+
+#define FILTER_DISTANCES(a, b) _mm_loadu_si128((const __m128i *)filter_diagonal_distances(worker, a, b))
+
+    edge = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(FILTER_DISTANCES(p, C), FILTER_DISTANCES(p, G)), _mm_add_epi32(FILTER_DISTANCES(I, F4), FILTER_DISTANCES(I, H5))),
+                         _mm_slli_epi32(FILTER_DISTANCES(H, F), 2));
+    across = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(FILTER_DISTANCES(H, D), FILTER_DISTANCES(H, I5)), _mm_add_epi32(FILTER_DISTANCES(F, I4), FILTER_DISTANCES(F, B))),
+                           _mm_slli_epi32(FILTER_DISTANCES(p, I), 2));
+
+#undef FILTER_DISTANCES
+
+    //blends towards whichever of F and H is closer, F on a tie
+    E = _mm_loadu_si128((const __m128i *)(yuv + p));
+    closer = _mm_cmpgt_epi32(filter_distance4(E, _mm_loadu_si128((const __m128i *)(yuv + F))), filter_distance4(E, _mm_loadu_si128((const __m128i *)(yuv + H))));
+
+    E = _mm_loadu_si128((const __m128i *)(colors + p));
+    blended = filter_select(closer, filter_mix4(E, E, _mm_loadu_si128((const __m128i *)(colors + H)), _mm_loadu_si128((const __m128i *)(colors + H))),
+                            filter_mix4(E, E, _mm_loadu_si128((const __m128i *)(colors + F)), _mm_loadu_si128((const __m128i *)(colors + F))));
+
+    return filter_select(_mm_cmplt_epi32(edge, across), blended, E);
+}
+#else
+static uint32_t
+filter_xbr2x_corner(const filter_worker_t *worker, int p, int sx, int sy) {
+    const uint32_t *colors = worker->colors;
+    const uint32_t *yuv = worker->yuv;
+    int row, B, C, D, F, G, H, I, F4, I4, H5, I5;
+    int edge, across;
+
+    row = sy * FILTER_STRIDE;
+    B = p - row;
+    C = p + sx - row;
+    D = p - sx;
+    F = p + sx;
+    G = p + row - sx;
+    H = p + row;
+    I = p + row + sx;
+    F4 = p + sx * 2;
+    I4 = p + row + sx * 2;
+    H5 = p + row * 2;
+    I5 = p + row * 2 + sx;
+
+#define FILTER_DISTANCE(a, b) ((int)*filter_diagonal_distances(worker, a, b))
+
+    edge = FILTER_DISTANCE(p, C) + FILTER_DISTANCE(p, G) + FILTER_DISTANCE(I, F4) + FILTER_DISTANCE(I, H5) + FILTER_DISTANCE(H, F) * 4;
+    across = FILTER_DISTANCE(H, D) + FILTER_DISTANCE(H, I5) + FILTER_DISTANCE(F, I4) + FILTER_DISTANCE(F, B) + FILTER_DISTANCE(p, I) * 4;
+
+#undef FILTER_DISTANCE
+
+    if (edge < across) {
+        if (filter_distance(yuv[p], yuv[F]) <= filter_distance(yuv[p], yuv[H])) {
+            return filter_mix(colors[p], colors[p], colors[F], colors[F]);
+        }
+
+        return filter_mix(colors[p], colors[p], colors[H], colors[H]);
+    }
+
+    return colors[p];
+}
+#endif
+
+static void
+filter_xbr2x_row(const filter_worker_t *worker, int p, uint32_t *out0, uint32_t *out1) {
+    int x;
+
+#if defined(FILTER_SSE2)
+    __m128i e0, e1, e2, e3;
+
+    for (x = 0; x < FILTER_WIDTH; x += 4, p += 4) {
+        e0 = filter_xbr2x_corner4(worker, p, -1, -1);
+        e1 = filter_xbr2x_corner4(worker, p, 1, -1);
+        e2 = filter_xbr2x_corner4(worker, p, -1, 1);
+        e3 = filter_xbr2x_corner4(worker, p, 1, 1);
+
+        _mm_storeu_si128((__m128i *)(out0 + x * 2), _mm_unpacklo_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out0 + x * 2 + 4), _mm_unpackhi_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out1 + x * 2), _mm_unpacklo_epi32(e2, e3));
+        _mm_storeu_si128((__m128i *)(out1 + x * 2 + 4), _mm_unpackhi_epi32(e2, e3));
+    }
+#else
+    for (x = 0; x < FILTER_WIDTH; x++, p++) {
+        out0[x * 2] = filter_xbr2x_corner(worker, p, -1, -1);
+        out0[x * 2 + 1] = filter_xbr2x_corner(worker, p, 1, -1);
+        out1[x * 2] = filter_xbr2x_corner(worker, p, -1, 1);
+        out1[x * 2 + 1] = filter_xbr2x_corner(worker, p, 1, 1);
+    }
+#endif
+}
+
+static int
+filter_band_height() {
+    return (FILTER_HEIGHT + filter.threads - 1) / filter.threads;
+}
+
+static void
+filter_band(filter_worker_t *worker) {
+    const uint32_t *in;
+    uint32_t *padded, *out[3];
+    int y, y0, y1, i, p, row, scale;
+
+    y0 = worker->index * filter_band_height();
+    y1 = y0 + filter_band_height();
+    if (y1 > FILTER_HEIGHT) {
+        y1 = FILTER_HEIGHT;
+    }
+
+    //NTSC works a line at a time straight from the palette indices
+    if (filter.type == FILTER_NTSC) {
+        for (y = y0; y < y1; y++) {
+            ntsc_row((uint32_t *)(filter.out + y * filter.out_pitch), (const uint16_t *)(filter.in + y * filter.in_pitch), (filter.burst + y) % 3);
+        }
+
+        return;
+    }
+
+    //copy the band with its edges clamped so no filter has to check bounds
+    for (y = y0 - FILTER_PAD; y < y1 + FILTER_PAD; y++) {
+        row = y < 0 ? 0 : (y >= FILTER_HEIGHT ? FILTER_HEIGHT - 1 : y);
+        in = (const uint32_t *)(filter.in + row * filter.in_pitch);
+        padded = worker->colors + (y - y0 + FILTER_PAD) * FILTER_STRIDE;
+
+        for (i = 0; i < FILTER_PAD; i++) {
+            padded[i] = in[0];
+            padded[FILTER_PAD + FILTER_WIDTH + i] = in[FILTER_WIDTH - 1];
+        }
+        memcpy(padded + FILTER_PAD, in, FILTER_WIDTH * sizeof(uint32_t));
+
+        if (filter.type == FILTER_SMOOTH2X || filter.type == FILTER_XBR2X) {
+            filter_yuv_row(worker->yuv + (y - y0 + FILTER_PAD) * FILTER_STRIDE, padded);
+        }
+    }
+
+    //the last row only matters as the neighbor of the one above it
+    for (y = 0; y < y1 - y0 + FILTER_PAD * 2 - 1; y++) {
+        if (filter.type == FILTER_SMOOTH2X) {
+            filter_similar_row(worker->similar + y * FILTER_STRIDE, worker->yuv + y * FILTER_STRIDE);
+        }
+        else if (filter.type == FILTER_XBR2X) {
+            filter_distance_row(worker->down_right + y * FILTER_STRIDE, worker->down_left + y * FILTER_STRIDE, worker->yuv + y * FILTER_STRIDE);
+        }
+    }
+
+    scale = filter_scales[filter.type];
+    for (y = y0; y < y1; y++) {
+        p = (y - y0 + FILTER_PAD) * FILTER_STRIDE + FILTER_PAD;
+        for (i = 0; i < scale; i++) {
+            out[i] = (uint32_t *)(filter.out + (y * scale + i) * filter.out_pitch);
+        }
+
+        switch (filter.type) {
+            case FILTER_SCALE2X:
+                filter_scale2x_row(worker->colors + p, out[0], out[1]);
+                break;
+            case FILTER_SCALE3X:
+                filter_scale3x_row(worker->colors + p, out[0], out[1], out[2]);
+                break;
+            case FILTER_SMOOTH2X:
+                filter_smooth2x_row(worker, p, out[0], out[1]);
+                break;
+            case FILTER_XBR2X:
+                filter_xbr2x_row(worker, p, out[0], out[1]);
+                break;
+            default:
+                memcpy(out[0], worker->colors + p, FILTER_WIDTH * sizeof(uint32_t));
+                break;
+        }
+    }
+}
+
+static int
+filter_thread(void *data) {
+    filter_worker_t *worker = data;
+
+    while (true) {
+        SDL_SemWait(worker->start);
+        if (filter.quit) {
+            break;
+        }
+
+        filter_band(worker);
+        SDL_SemPost(filter.done);
+    }
+
+    return 0;
+}
+
+bool
+filter_open(int threads) {
+    filter_worker_t *worker;
+    size_t size;
+    int i;
+
+    filter_close();
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > FILTER_MAX_THREADS) {
+        threads = FILTER_MAX_THREADS;
+    }
+
+    filter.threads = threads;
+    filter.quit = false;
+
+    filter.done = SDL_CreateSemaphore(0);
+    if (filter.done == NULL) {
+        log_err(MODULE, "Failed to create semaphore: %s", SDL_GetError());
+        filter_close();
+        return false;
+    }
+
+    //one extra row because the neighbors of the last row are looked at, even though they're never used
+    size = (filter_band_height() + FILTER_PAD * 2 + 1) * FILTER_STRIDE;
+
+    //worker 0 is whoever calls filter_run()
+    for (i = 0; i < threads; i++) {
+        worker = &filter.workers[i];
+        worker->index = i;
+
+        worker->colors = malloc(size * sizeof(uint32_t));
+        worker->yuv = calloc(size, sizeof(uint32_t));
+        worker->similar = malloc(size);
+        worker->down_right = malloc(size * sizeof(uint32_t));
+        worker->down_left = malloc(size * sizeof(uint32_t));
+        if (worker->colors == NULL || worker->yuv == NULL || worker->similar == NULL || worker->down_right == NULL || worker->down_left == NULL) {
+            log_err(MODULE, "Out of memory");
+            filter_close();
+            return false;
+        }
+
+        if (i == 0) {
+            continue;
+        }
+
+        worker->start = SDL_CreateSemaphore(0);
+        if (worker->start == NULL) {
+            log_err(MODULE, "Failed to create semaphore: %s", SDL_GetError());
+            filter_close();
+            return false;
+        }
+
+        worker->thread = SDL_CreateThread(filter_thread, "Filter", worker);
+        if (worker->thread == NULL) {
+            log_err(MODULE, "Failed to create filter thread: %s", SDL_GetError());
+            filter_close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+filter_close() {
+    filter_worker_t *worker;
+    int i;
+
+    filter.quit = true;
+
+    for (i = 0; i < FILTER_MAX_THREADS; i++) {
+        worker = &filter.workers[i];
+
+        if (worker->thread != NULL) {
+            SDL_SemPost(worker->start);
+            SDL_WaitThread(worker->thread, NULL);
+        }
+        if (worker->start != NULL) {
+            SDL_DestroySemaphore(worker->start);
+        }
+        free(worker->colors);
+        free(worker->yuv);
+        free(worker->similar);
+        free(worker->down_right);
+        free(worker->down_left);
+
+        memset(worker, 0, sizeof(*worker));
+    }
+
+    if (filter.done != NULL) {
+        SDL_DestroySemaphore(filter.done);
+        filter.done = NULL;
+    }
+
+    filter.threads = 0;
+}
+
+void
+filter_run(filter_type_t type, const void *in, int in_pitch, void *out, int out_pitch) {
+    int i;
+
+    if (filter.threads == 0) {
+        return;
+    }
+
+    filter.type = type;
+    filter.in = in;
+    filter.in_pitch = in_pitch;
+    filter.out = out;
+    filter.out_pitch = out_pitch;
+
+    for (i = 1; i < filter.threads; i++) {
+        SDL_SemPost(filter.workers[i].start);
+    }
+
+    filter_band(&filter.workers[0]);
+
+    for (i = 1; i < filter.threads; i++) {
+        SDL_SemWait(filter.done);
+    }
+
+    if (type == FILTER_NTSC) {
+        filter.burst = (filter.burst + 1) % 3;
+    }
+}
\ No newline at end of file
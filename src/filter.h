@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    FILTER_NONE,
+    FILTER_SCALE2X,
+    FILTER_SCALE3X,
+    FILTER_SMOOTH2X,                        //hqx's color similarity with a few blending rules, not its pattern table
+    FILTER_XBR2X,
+    FILTER_NTSC,                            //takes PPU_FORMAT_INDEXED frames
+    FILTER_COUNT
+} filter_type_t;
+
+void filter_init();
+void filter_free();
+
+bool filter_open(int threads);
+void filter_close();
+
+filter_type_t filter_find(const char *name);
+const char * filter_get_name(filter_type_t type);
+int filter_get_width(filter_type_t type);
+int filter_get_height(filter_type_t type);
+
+//filters a 256x240 ARGB8888 frame into a filter_get_width() x filter_get_height() ARGB8888 out
+void filter_run(filter_type_t type, const void *in, int in_pitch, void *out, int out_pitch);
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "log.h"
+#include "filter.h"
+#include "filter_test.h"
+
+#define MODULE "FLTT"
+
+typedef struct {
+    uint32_t frame[256 * 240];
+    uint16_t indexed[256 * 240];            //the same frame as palette indices
+    uint32_t *out;
+    uint32_t *expected;                     //what a filter checked against a reference should write
+} filter_test_t;
+
+static filter_test_t filter_test;
+
+//a few of the NES palette's colors
+static const uint32_t colors[] = {0xFF000000, 0xFFFCFCFC, 0xFF0058F8, 0xFFB81C00, 0xFF00A800, 0xFFF8B800, 0xFF6888FC, 0xFFBCBCBC};
+static const uint16_t indices[] = {0x0F, 0x30, 0x12, 0x06, 0x1A, 0x28, 0x21, 0x10};
+
+void
+filter_test_init() {
+    memset(&filter_test, 0, sizeof(filter_test));
+}
+
+void
+filter_test_free() {
+    free(filter_test.out);
+    free(filter_test.expected);
+}
+
+//8x8 tiles of flat color with a diagonal and a few stray pixels, so every filter finds edges to work on
+static void
+filter_test_build_frame() {
+    uint32_t seed, tile, color;
+    int x, y, i;
+
+    seed = 1;
+    for (y = 0; y < 240; y += 8) {
+        for (x = 0; x < 256; x += 8) {
+            seed = seed * 1103515245 + 12345;
+            tile = seed >> 16;
+
+            for (color = 0; color < 64; color++) {
+                i = (y + color / 8) * 256 + x + color % 8;
+                filter_test.frame[i] = colors[tile % 8];
+                filter_test.indexed[i] = indices[tile % 8];
+                if (color / 8 == color % 8 || (tile >> (color % 16)) % 7 == 0) {
+                    filter_test.frame[i] = colors[(tile >> 3) % 8];
+                    filter_test.indexed[i] = indices[(tile >> 3) % 8];
+                }
+            }
+        }
+    }
+}
+
+//a pixel of the test frame with its edges clamped, the same way the filters see it
+static uint32_t
+filter_test_pixel(int x, int y) {
+    x = x < 0 ? 0 : (x > 255 ? 255 : x);
+    y = y < 0 ? 0 : (y > 239 ? 239 : y);
+
+    return filter_test.frame[y * 256 + x];
+}
+
+//AdvMAME2x and 3x written straight from their definitions, a pixel at a time
+static void
+filter_test_scale(int scale) {
+    uint32_t A, B, C, D, E, F, G, H, I, results[9];
+    int x, y, i, width;
+
+    width = 256 * scale;
+    for (y = 0; y < 240; y++) {
+        for (x = 0; x < 256; x++) {
+            A = filter_test_pixel(x - 1, y - 1);
+            B = filter_test_pixel(x, y - 1);
+            C = filter_test_pixel(x + 1, y - 1);
+            D = filter_test_pixel(x - 1, y);
+            E = filter_test_pixel(x, y);
+            F = filter_test_pixel(x + 1, y);
+            G = filter_test_pixel(x - 1, y + 1);
+            H = filter_test_pixel(x, y + 1);
+            I = filter_test_pixel(x + 1, y + 1);
+
+            for (i = 0; i < 9; i++) {
+                results[i] = E;
+            }
+
+            if (B != H && D != F) {
+                if (scale == 2) {
+                    results[0] = D == B ? D : E;
+                    results[1] = B == F ? F : E;
+                    results[2] = D == H ? D : E;
+                    results[3] = H == F ? F : E;
+                }
+                else {
+                    results[0] = D == B ? D : E;
+                    results[1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+                    results[2] = B == F ? F : E;
+                    results[3] = (D == B && E != G) || (D == H && E != A) ? D : E;
+                    results[5] = (B == F && E != I) || (H == F && E != C) ? F : E;
+                    results[6] = D == H ? D : E;
+                    results[7] = (D == H && E != I) || (H == F && E != G) ? H : E;
+                    results[8] = H == F ? F : E;
+                }
+            }
+
+            for (i = 0; i < scale * scale; i++) {
+                filter_test.expected[(y * scale + i / scale) * width + x * scale + i % scale] = results[i];
+            }
+        }
+    }
+}
+
+//runs a filter once and compares it with the reference, the workers split the frame into bands so their edges get
+//checked too
+static bool
+filter_test_check(filter_type_t type, int scale) {
+    int width, i;
+
+    width = 256 * scale;
+    filter_test_scale(scale);
+    memset(filter_test.out, 0, width * 240 * scale * sizeof(uint32_t));
+    filter_run(type, filter_test.frame, 256 * sizeof(uint32_t), filter_test.out, width * sizeof(uint32_t));
+
+    for (i = 0; i < width * 240 * scale; i++) {
+        if (filter_test.out[i] != filter_test.expected[i]) {
+            log_err(MODULE, "%s: pixel %d,%d is %08X instead of %08X", filter_get_name(type), i % width, i / width,
+                    filter_test.out[i], filter_test.expected[i]);
+            return false;
+        }
+    }
+
+    log_info(MODULE, "%s: matches the reference", filter_get_name(type));
+
+    return true;
+}
+
+bool
+filter_test_benchmark(int frames) {
+    Uint64 start, elapsed;
+    const void *in;
+    int type, i, width, pitch;
+
+    filter_test.out = realloc(filter_test.out, 256 * 3 * 240 * 3 * sizeof(uint32_t));
+    filter_test.expected = realloc(filter_test.expected, 256 * 3 * 240 * 3 * sizeof(uint32_t));
+    if (filter_test.out == NULL || filter_test.expected == NULL) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+
+    filter_test_build_frame();
+
+    if (!filter_test_check(FILTER_SCALE2X, 2) || !filter_test_check(FILTER_SCALE3X, 3)) {
+        return false;
+    }
+
+    for (type = FILTER_NONE + 1; type < FILTER_COUNT; type++) {
+        width = filter_get_width(type);
+        if (type == FILTER_NTSC) {
+            in = filter_test.indexed;
+            pitch = 256 * sizeof(uint16_t);
+        }
+        else {
+            in = filter_test.frame;
+            pitch = 256 * sizeof(uint32_t);
+        }
+
+        start = SDL_GetPerformanceCounter();
+        for (i = 0; i < frames; i++) {
+            filter_run(type, in, pitch, filter_test.out, width * sizeof(uint32_t));
+        }
+        elapsed = SDL_GetPerformanceCounter() - start;
+
+        log_info(MODULE, "%s: %d frames in %.3f ms, %.3f ms per frame", filter_get_name(type), frames,
+                 elapsed * 1000.0 / SDL_GetPerformanceFrequency(), elapsed * 1000.0 / SDL_GetPerformanceFrequency() / frames);
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdbool.h>
+
+void filter_test_init();
+void filter_test_free();
+
+bool filter_test_benchmark(int frames);
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include <string.h>
+#include "hash.h"
+
+#define HASH_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+typedef struct {
+    uint32_t crc32[8][256];                 //slicing by 8, table i is the CRC of a byte followed by i zero bytes
+} hash_t;
+
+static hash_t hash;
+
+void
+hash_init() {
+    uint32_t crc;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+        }
+        hash.crc32[0][i] = crc;
+    }
+
+    for (i = 0; i < 256; i++) {
+        for (j = 1; j < 8; j++) {
+            hash.crc32[j][i] = (hash.crc32[j - 1][i] >> 8) ^ hash.crc32[0][hash.crc32[j - 1][i] & 0xFF];
+        }
+    }
+}
+
+uint32_t
+hash_crc32(uint32_t crc, const void *data, size_t size) {
+    const uint8_t *p = data;
+    uint32_t low, high;
+
+    crc = ~crc;
+
+    //8 bytes a step through the tables, the bytes are read one at a time so it doesn't matter what the host's endian is
+    for (; size >= 8; size -= 8, p += 8) {
+        low = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+        high = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+        crc = hash.crc32[7][low & 0xFF] ^ hash.crc32[6][(low >> 8) & 0xFF] ^ hash.crc32[5][(low >> 16) & 0xFF] ^ hash.crc32[4][low >> 24] ^
+              hash.crc32[3][high & 0xFF] ^ hash.crc32[2][(high >> 8) & 0xFF] ^ hash.crc32[1][(high >> 16) & 0xFF] ^ hash.crc32[0][high >> 24];
+    }
+
+    for (; size > 0; size--, p++) {
+        crc = (crc >> 8) ^ hash.crc32[0][(crc ^ *p) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+static void
+hash_sha1_block(uint32_t state[5], const uint8_t *block) {
+    uint32_t w[80], a, b, c, d, e, f, k, t;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (; i < 80; i++) {
+        w[i] = HASH_ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+
+    for (i = 0; i < 80; i++) {
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        t = HASH_ROL(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = HASH_ROL(b, 30);
+        b = a;
+        a = t;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void
+hash_sha1_start(hash_sha1_t *sha1) {
+    sha1->state[0] = 0x67452301;
+    sha1->state[1] = 0xEFCDAB89;
+    sha1->state[2] = 0x98BADCFE;
+    sha1->state[3] = 0x10325476;
+    sha1->state[4] = 0xC3D2E1F0;
+    sha1->size = 0;
+}
+
+void
+hash_sha1_update(hash_sha1_t *sha1, const void *data, size_t size) {
+    const uint8_t *p = data;
+    size_t used, n;
+
+    used = sha1->size % 64;
+    sha1->size += size;
+
+    //tops up a block left over from the last update
+    if (used > 0) {
+        n = 64 - used < size ? 64 - used : size;
+        memcpy(sha1->block + used, p, n);
+        p += n;
+        size -= n;
+        if (used + n < 64) {
+            return;
+        }
+        hash_sha1_block(sha1->state, sha1->block);
+    }
+
+    //whole blocks are hashed where they are
+    for (; size >= 64; size -= 64, p += 64) {
+        hash_sha1_block(sha1->state, p);
+    }
+
+    memcpy(sha1->block, p, size);
+}
+
+void
+hash_sha1_finish(hash_sha1_t *sha1, uint8_t digest[HASH_SHA1_SIZE]) {
+    uint8_t padding[72];
+    uint64_t bits;
+    size_t used, n;
+    int i;
+
+    //a 1 bit, zeros up to 8 bytes short of a block, then the size in bits
+    bits = sha1->size * 8;
+    used = sha1->size % 64;
+    n = used < 56 ? 56 - used : 120 - used;
+
+    memset(padding, 0, sizeof(padding));
+    padding[0] = 0x80;
+    for (i = 0; i < 8; i++) {
+        padding[n + i] = bits >> (56 - i * 8);
+    }
+    hash_sha1_update(sha1, padding, n + 8);
+
+    for (i = 0; i < HASH_SHA1_SIZE; i++) {
+        digest[i] = sha1->state[i / 4] >> (24 - (i % 4) * 8);
+    }
+}
+
+void
+hash_sha1_to_hex(const uint8_t digest[HASH_SHA1_SIZE], char hex[HASH_SHA1_SIZE * 2 + 1]) {
+    static const char digits[] = "0123456789abcdef";
+    int i;
+
+    for (i = 0; i < HASH_SHA1_SIZE; i++) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0x0F];
+    }
+    hex[HASH_SHA1_SIZE * 2] = '\0';
+}
+
+static int
+hash_hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+bool
+hash_sha1_from_hex(const char *hex, uint8_t digest[HASH_SHA1_SIZE]) {
+    int i, high, low;
+
+    if (strlen(hex) != HASH_SHA1_SIZE * 2) {
+        return false;
+    }
+
+    for (i = 0; i < HASH_SHA1_SIZE; i++) {
+        high = hash_hex_digit(hex[i * 2]);
+        low = hash_hex_digit(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        digest[i] = (high << 4) | low;
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASH_SHA1_SIZE          20
+
+typedef struct {
+    uint32_t state[5];
+    uint64_t size;                          //bytes hashed so far
+    uint8_t block[64];                      //bytes that didn't fill a block yet
+} hash_sha1_t;
+
+void hash_init();
+
+//continues crc over data, start with 0
+uint32_t hash_crc32(uint32_t crc, const void *data, size_t size);
+
+void hash_sha1_start(hash_sha1_t *sha1);
+void hash_sha1_update(hash_sha1_t *sha1, const void *data, size_t size);
+void hash_sha1_finish(hash_sha1_t *sha1, uint8_t digest[HASH_SHA1_SIZE]);
+
+//hex is 40 lowercase digits and a terminator
+void hash_sha1_to_hex(const uint8_t digest[HASH_SHA1_SIZE], char hex[HASH_SHA1_SIZE * 2 + 1]);
+bool hash_sha1_from_hex(const char *hex, uint8_t digest[HASH_SHA1_SIZE]);
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "log.h"
+#include "os.h"
+#include "string.h"
+#include "image.h"
+
+#define MODULE "Image"
+
+//the images any cartridge in the process holds. instances can load from their own threads, so the list is behind a lock,
+//hashing and copying happen outside it
+typedef struct {
+    image_t *images;
+    int count;
+    SDL_SpinLock lock;
+} image_cache_t;
+
+static image_cache_t cache;
+
+static void
+image_release_data(const uint8_t *data, size_t size, image_storage_t storage) {
+    switch (storage) {
+        case IMAGE_STORAGE_COPY:
+            break;
+        case IMAGE_STORAGE_ALLOCATED:
+            free((void *)data);
+            break;
+        case IMAGE_STORAGE_MAPPED:
+            os_unmap_file(data, size);
+            break;
+    }
+}
+
+//takes a reference to the image with this content, the lock has to be held
+static image_t *
+image_find_content(const uint8_t sha1[HASH_SHA1_SIZE], size_t size) {
+    image_t *image;
+
+    for (image = cache.images; image != NULL; image = image->next) {
+        if (image->size == size && memcmp(image->sha1, sha1, HASH_SHA1_SIZE) == 0) {
+            image->references++;
+            break;
+        }
+    }
+
+    return image;
+}
+
+void
+image_init() {
+    memset(&cache, 0, sizeof(cache));
+}
+
+void
+image_free() {
+    image_t *image;
+
+    //cartridges release theirs on unload, whatever's left leaked a reference
+    if (cache.count > 0) {
+        log_warn(MODULE, "%d images still referenced", cache.count);
+    }
+
+    while (cache.images != NULL) {
+        image = cache.images;
+        cache.images = image->next;
+        image_release_data(image->data, image->size, image->storage);
+        free(image);
+    }
+    cache.count = 0;
+}
+
+const image_t *
+image_find_file(const char *path, uint64_t file_size, int64_t file_mtime) {
+    image_t *image;
+
+    SDL_AtomicLock(&cache.lock);
+
+    for (image = cache.images; image != NULL; image = image->next) {
+        if (image->file_size == file_size && image->file_mtime == file_mtime && strcmp(image->path, path) == 0) {
+            image->references++;
+            break;
+        }
+    }
+
+    SDL_AtomicUnlock(&cache.lock);
+
+    return image;
+}
+
+const image_t *
+image_add(const uint8_t *data, size_t size, image_storage_t storage, const char *path, uint64_t file_size, int64_t file_mtime) {
+    uint8_t sha1[HASH_SHA1_SIZE];
+    hash_sha1_t context;
+    image_t *image, *added;
+    uint8_t *copy;
+
+    hash_sha1_start(&context);
+    hash_sha1_update(&context, data, size);
+    hash_sha1_finish(&context, sha1);
+
+    //the new image is ready before the lock is taken, it's dropped if the same content is already there
+    added = calloc(1, sizeof(image_t));
+    if (added == NULL) {
+        log_err(MODULE, "Failed to allocate an image");
+        image_release_data(data, size, storage);
+        return NULL;
+    }
+
+    SDL_AtomicLock(&cache.lock);
+    image = image_find_content(sha1, size);
+    SDL_AtomicUnlock(&cache.lock);
+
+    if (image != NULL) {
+        log_info(MODULE, "Sharing the %zu byte image already loaded", size);
+        image_release_data(data, size, storage);
+        free(added);
+        return image;
+    }
+
+    if (storage == IMAGE_STORAGE_COPY) {
+        copy = malloc(size > 0 ? size : 1);
+        if (copy == NULL) {
+            log_err(MODULE, "Failed to allocate %zu bytes for data storage", size);
+            free(added);
+            return NULL;
+        }
+        memcpy(copy, data, size);
+        data = copy;
+        storage = IMAGE_STORAGE_ALLOCATED;
+    }
+
+    added->data = data;
+    added->size = size;
+    memcpy(added->sha1, sha1, HASH_SHA1_SIZE);
+    added->storage = storage;
+    added->references = 1;
+    if (path != NULL) {
+        strlcpy(added->path, path, sizeof(added->path));
+        added->file_size = file_size;
+        added->file_mtime = file_mtime;
+    }
+
+    //another thread can have added the same content meanwhile, the first one in is kept
+    SDL_AtomicLock(&cache.lock);
+
+    image = image_find_content(sha1, size);
+    if (image == NULL) {
+        added->next = cache.images;
+        cache.images = added;
+        cache.count++;
+    }
+
+    SDL_AtomicUnlock(&cache.lock);
+
+    if (image != NULL) {
+        image_release_data(added->data, added->size, added->storage);
+        free(added);
+        return image;
+    }
+
+    return added;
+}
+
+void
+image_release(const image_t *image) {
+    image_t **link, *released = NULL;
+
+    if (image == NULL) {
+        return;
+    }
+
+    SDL_AtomicLock(&cache.lock);
+
+    for (link = &cache.images; *link != NULL; link = &(*link)->next) {
+        if (*link == image) {
+            if (--(*link)->references == 0) {
+                released = *link;
+                *link = released->next;
+                cache.count--;
+            }
+            break;
+        }
+    }
+
+    SDL_AtomicUnlock(&cache.lock);
+
+    if (released != NULL) {
+        image_release_data(released->data, released->size, released->storage);
+        free(released);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hash.h"
+
+//how the bytes handed to image_add() are stored
+typedef enum {
+    IMAGE_STORAGE_COPY,                     //the caller keeps them, they're copied if nothing has the same content
+    IMAGE_STORAGE_ALLOCATED,                //malloc()ed, the cache frees them
+    IMAGE_STORAGE_MAPPED                    //from os_map_file(), the cache unmaps them
+} image_storage_t;
+
+//a read only ROM image shared by every cartridge loaded with the same content, PRG and CHR ROM are read straight out
+//of data. everything but data and size belongs to the cache
+typedef struct image {
+    const uint8_t *data;
+    size_t size;
+    uint8_t sha1[HASH_SHA1_SIZE];           //of the whole image, header included
+    image_storage_t storage;
+    int references;
+    char path[256];                         //the file it was loaded from, empty if it came from memory
+    uint64_t file_size;
+    int64_t file_mtime;
+    struct image *next;
+} image_t;
+
+void image_init();
+void image_free();
+
+//a reference to the image last loaded from path if the file still has that size and mtime, otherwise NULL
+const image_t * image_find_file(const char *path, uint64_t file_size, int64_t file_mtime);
+
+//a reference to the image with the same content as data, added if there isn't one. data is released when it's not
+//the one kept, and on failure. path, file_size and file_mtime are for image_find_file(), path is NULL for memory
+const image_t * image_add(const uint8_t *data, size_t size, image_storage_t storage, const char *path, uint64_t file_size, int64_t file_mtime);
+
+//drops a reference, the last one frees the image
+void image_release(const image_t *image);
\ No newline at end of file
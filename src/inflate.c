@@ -0,0 +1,387 @@
+#include <string.h>
+#include "inflate.h"
+
+#define INFLATE_FAST_BITS       9           //codes this long or shorter are decoded with one table lookup
+#define INFLATE_MAX_BITS        15
+
+//a Huffman code, the fast table holds symbol << 4 | length for every code of up to INFLATE_FAST_BITS bits, indexed by
+//the next bits of the stream, longer codes are 0 there and decoded a bit at a time with counts and symbols
+typedef struct {
+    uint16_t fast[1 << INFLATE_FAST_BITS];
+    uint16_t counts[INFLATE_MAX_BITS + 1];  //codes of each length
+    uint16_t symbols[288];                  //in code order
+} inflate_huffman_t;
+
+typedef struct {
+    const uint8_t *in;
+    const uint8_t *in_end;
+    uint64_t bits;                          //read from in but not used yet, the next one lowest
+    int count;
+    uint8_t *out;
+    uint8_t *out_start;
+    uint8_t *out_end;
+    inflate_huffman_t lengths;              //literals and lengths
+    inflate_huffman_t distances;
+} inflate_t;
+
+static const uint16_t inflate_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t inflate_length_bits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t inflate_distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t inflate_distance_bits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+//the order code length code lengths come in
+static const uint8_t inflate_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static void
+inflate_refill(inflate_t *inflate) {
+    while (inflate->count <= 56 && inflate->in < inflate->in_end) {
+        inflate->bits |= (uint64_t)*inflate->in++ << inflate->count;
+        inflate->count += 8;
+    }
+}
+
+//false if the stream ended first
+static bool
+inflate_bits(inflate_t *inflate, int n, unsigned int *value) {
+    if (inflate->count < n) {
+        inflate_refill(inflate);
+        if (inflate->count < n) {
+            return false;
+        }
+    }
+
+    *value = (unsigned int)(inflate->bits & ((1u << n) - 1));
+    inflate->bits >>= n;
+    inflate->count -= n;
+
+    return true;
+}
+
+//builds a code from the length of each symbol's code, false if they don't make a code
+static bool
+inflate_build(inflate_huffman_t *huffman, const uint8_t *lengths, int count) {
+    uint16_t offsets[INFLATE_MAX_BITS + 1];
+    int i, left, code, reversed, length, step;
+
+    memset(huffman->counts, 0, sizeof(huffman->counts));
+    for (i = 0; i < count; i++) {
+        huffman->counts[lengths[i]]++;
+    }
+    huffman->counts[0] = 0;
+
+    //more codes than the lengths have room for
+    left = 1;
+    for (i = 1; i <= INFLATE_MAX_BITS; i++) {
+        left = (left << 1) - huffman->counts[i];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    offsets[1] = 0;
+    for (i = 1; i < INFLATE_MAX_BITS; i++) {
+        offsets[i + 1] = offsets[i] + huffman->counts[i];
+    }
+    for (i = 0; i < count; i++) {
+        if (lengths[i] != 0) {
+            huffman->symbols[offsets[lengths[i]]++] = i;
+        }
+    }
+
+    //codes are stored first bit first, so the fast table is indexed by them reversed
+    memset(huffman->fast, 0, sizeof(huffman->fast));
+    code = 0;
+    i = 0;
+    for (length = 1; length <= INFLATE_FAST_BITS; length++) {
+        for (step = 0; step < huffman->counts[length]; step++, i++, code++) {
+            for (reversed = 0, left = 0; left < length; left++) {
+                reversed |= ((code >> left) & 1) << (length - 1 - left);
+            }
+            for (; reversed < (1 << INFLATE_FAST_BITS); reversed += 1 << length) {
+                huffman->fast[reversed] = (huffman->symbols[i] << 4) | length;
+            }
+        }
+        code <<= 1;
+    }
+
+    return true;
+}
+
+//-1 if the stream ended or the code doesn't exist
+static int
+inflate_symbol(inflate_t *inflate, const inflate_huffman_t *huffman) {
+    unsigned int bit;
+    int entry, length, code, first, index;
+
+    if (inflate->count < INFLATE_MAX_BITS) {
+        inflate_refill(inflate);
+    }
+
+    if (inflate->count >= INFLATE_FAST_BITS) {
+        entry = huffman->fast[inflate->bits & ((1 << INFLATE_FAST_BITS) - 1)];
+        if (entry != 0) {
+            inflate->bits >>= entry & 0x0F;
+            inflate->count -= entry & 0x0F;
+            return entry >> 4;
+        }
+    }
+
+    //a bit at a time, codes of each length follow on from the last one of the length before
+    code = first = index = 0;
+    for (length = 1; length <= INFLATE_MAX_BITS; length++) {
+        if (!inflate_bits(inflate, 1, &bit)) {
+            return -1;
+        }
+        code |= bit;
+        if (code - huffman->counts[length] < first) {
+            return huffman->symbols[index + (code - first)];
+        }
+        index += huffman->counts[length];
+        first = (first + huffman->counts[length]) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static bool
+inflate_stored(inflate_t *inflate) {
+    unsigned int length;
+
+    //back to whole bytes, the bits left over go back to in
+    inflate->bits >>= inflate->count & 7;
+    inflate->count &= ~7;
+    inflate->in -= inflate->count / 8;
+    inflate->bits = 0;
+    inflate->count = 0;
+
+    if (inflate->in_end - inflate->in < 4) {
+        return false;
+    }
+
+    length = inflate->in[0] | (inflate->in[1] << 8);
+    if ((length ^ (inflate->in[2] | (inflate->in[3] << 8))) != 0xFFFF) {
+        return false;
+    }
+    inflate->in += 4;
+
+    if ((size_t)(inflate->in_end - inflate->in) < length || (size_t)(inflate->out_end - inflate->out) < length) {
+        return false;
+    }
+
+    memcpy(inflate->out, inflate->in, length);
+    inflate->in += length;
+    inflate->out += length;
+
+    return true;
+}
+
+static bool
+inflate_codes(inflate_t *inflate) {
+    unsigned int extra;
+    size_t length, distance;
+    uint8_t *from;
+    int symbol;
+
+    while (true) {
+        symbol = inflate_symbol(inflate, &inflate->lengths);
+        if (symbol < 0) {
+            return false;
+        }
+
+        if (symbol < 256) {
+            if (inflate->out == inflate->out_end) {
+                return false;
+            }
+            *inflate->out++ = symbol;
+            continue;
+        }
+
+        if (symbol == 256) {
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29 || !inflate_bits(inflate, inflate_length_bits[symbol], &extra)) {
+            return false;
+        }
+        length = inflate_length_base[symbol] + extra;
+
+        symbol = inflate_symbol(inflate, &inflate->distances);
+        if (symbol < 0 || symbol >= 30 || !inflate_bits(inflate, inflate_distance_bits[symbol], &extra)) {
+            return false;
+        }
+        distance = inflate_distance_base[symbol] + extra;
+
+        if (distance > (size_t)(inflate->out - inflate->out_start) || length > (size_t)(inflate->out_end - inflate->out)) {
+            return false;
+        }
+
+        //a byte at a time, the match can overlap what it's writing
+        from = inflate->out - distance;
+        while (length-- > 0) {
+            *inflate->out++ = *from++;
+        }
+    }
+}
+
+static bool
+inflate_fixed(inflate_t *inflate) {
+    uint8_t lengths[288];
+    int i;
+
+    for (i = 0; i < 144; i++) {
+        lengths[i] = 8;
+    }
+    for (; i < 256; i++) {
+        lengths[i] = 9;
+    }
+    for (; i < 280; i++) {
+        lengths[i] = 7;
+    }
+    for (; i < 288; i++) {
+        lengths[i] = 8;
+    }
+    inflate_build(&inflate->lengths, lengths, 288);
+
+    for (i = 0; i < 30; i++) {
+        lengths[i] = 5;
+    }
+    inflate_build(&inflate->distances, lengths, 30);
+
+    return inflate_codes(inflate);
+}
+
+static bool
+inflate_dynamic(inflate_t *inflate) {
+    uint8_t lengths[288 + 32];
+    unsigned int literals, distances, codes, value, repeat;
+    int i, symbol, previous;
+
+    if (!inflate_bits(inflate, 5, &literals) || !inflate_bits(inflate, 5, &distances) || !inflate_bits(inflate, 4, &codes)) {
+        return false;
+    }
+    literals += 257;
+    distances += 1;
+    codes += 4;
+    if (literals > 286 || distances > 30) {
+        return false;
+    }
+
+    //the lengths of the code the other two codes' lengths are in
+    memset(lengths, 0, sizeof(lengths));
+    for (i = 0; i < (int)codes; i++) {
+        if (!inflate_bits(inflate, 3, &value)) {
+            return false;
+        }
+        lengths[inflate_order[i]] = value;
+    }
+    if (!inflate_build(&inflate->lengths, lengths, 19)) {
+        return false;
+    }
+
+    //both codes' lengths are one run, a repeat can cross from one to the other
+    for (i = 0; i < (int)(literals + distances);) {
+        symbol = inflate_symbol(inflate, &inflate->lengths);
+        if (symbol < 0) {
+            return false;
+        }
+
+        if (symbol < 16) {
+            lengths[i++] = symbol;
+            continue;
+        }
+
+        previous = 0;
+        if (symbol == 16) {
+            if (i == 0 || !inflate_bits(inflate, 2, &repeat)) {
+                return false;
+            }
+            previous = lengths[i - 1];
+            repeat += 3;
+        }
+        else if (symbol == 17) {
+            if (!inflate_bits(inflate, 3, &repeat)) {
+                return false;
+            }
+            repeat += 3;
+        }
+        else {
+            if (!inflate_bits(inflate, 7, &repeat)) {
+                return false;
+            }
+            repeat += 11;
+        }
+
+        if (i + repeat > literals + distances) {
+            return false;
+        }
+        while (repeat-- > 0) {
+            lengths[i++] = previous;
+        }
+    }
+
+    //without an end of block code nothing would stop the block
+    if (lengths[256] == 0 || !inflate_build(&inflate->lengths, lengths, literals) || !inflate_build(&inflate->distances, lengths + literals, distances)) {
+        return false;
+    }
+
+    return inflate_codes(inflate);
+}
+
+bool
+inflate_decode(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size, size_t *in_used) {
+    inflate_t inflate;
+    unsigned int last, type;
+    bool success;
+
+    inflate.in = in;
+    inflate.in_end = in + in_size;
+    inflate.bits = 0;
+    inflate.count = 0;
+    inflate.out = out;
+    inflate.out_start = out;
+    inflate.out_end = out + out_size;
+
+    do {
+        if (!inflate_bits(&inflate, 1, &last) || !inflate_bits(&inflate, 2, &type)) {
+            return false;
+        }
+
+        switch (type) {
+            case 0:
+                success = inflate_stored(&inflate);
+                break;
+            case 1:
+                success = inflate_fixed(&inflate);
+                break;
+            case 2:
+                success = inflate_dynamic(&inflate);
+                break;
+            default:
+                success = false;
+                break;
+        }
+
+        if (!success) {
+            return false;
+        }
+    } while (!last);
+
+    if (in_used != NULL) {
+        *in_used = (inflate.in - in) - inflate.count / 8;
+    }
+
+    return inflate.out == inflate.out_end;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//decodes a raw DEFLATE stream into out, which has to be exactly the size of what it decodes to. in_used is how much
+//of in the stream took, if it isn't NULL
+bool inflate_decode(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size, size_t *in_used);
\ No newline at end of file
@@ -0,0 +1,575 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <SDL2/SDL.h>
+#include "log.h"
+#include "os.h"
+#include "string.h"
+#include "cartridge.h"
+#include "library.h"
+
+#define MODULE "Library"
+
+#define LIBRARY_PATH_MAX        1024
+#define LIBRARY_CHUNK_SIZE      0x10000     //both hashes run over a chunk while it's still in the cache
+
+//an index file in use
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    const library_header_t *header;
+    const library_rom_t *roms;
+    const uint32_t *slots;
+    const char *paths;
+} library_index_t;
+
+typedef struct {
+    char *path;
+    os_file_info_t info;
+    library_rom_t rom;
+    bool indexed;                           //rom is filled in, from the old index or by hashing the file
+} library_file_t;
+
+typedef struct {
+    library_file_t *files;
+    int count;
+    int capacity;
+    SDL_atomic_t next;                      //the next file a worker takes
+    SDL_atomic_t hashed;
+    SDL_atomic_t skipped;
+} library_scan_t;
+
+typedef struct {
+    library_index_t index;                  //opened for library_find()
+} library_t;
+
+static library_t library;
+
+void
+library_init() {
+    memset(&library, 0, sizeof(library));
+}
+
+void
+library_free() {
+    library_close();
+}
+
+static void
+library_index_close(library_index_t *index) {
+    if (index->data != NULL) {
+        os_unmap_file(index->data, index->size);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+static bool
+library_index_open(library_index_t *index, const char *path) {
+    const library_header_t *header;
+    uint64_t size;
+    uint32_t i;
+
+    memset(index, 0, sizeof(*index));
+
+    index->data = os_map_file(path, &index->size);
+    if (index->data == NULL) {
+        log_err(MODULE, "Failed to map '%s': %s", path, strerror(errno));
+        return false;
+    }
+
+    header = (const library_header_t *)index->data;
+    if (index->size < sizeof(*header) || header->magic != LIBRARY_MAGIC || header->version != LIBRARY_VERSION) {
+        log_err(MODULE, "'%s' isn't a version %d index", path, LIBRARY_VERSION);
+        library_index_close(index);
+        return false;
+    }
+
+    //everything is used without copying, so it all has to be in bounds
+    size = sizeof(*header) + (uint64_t)header->count * sizeof(library_rom_t) + (uint64_t)header->slots * sizeof(uint32_t) + header->paths_size;
+    if (size != index->size || header->slots == 0 || (header->slots & (header->slots - 1)) != 0 ||
+        (header->paths_size > 0 && index->data[index->size - 1] != '\0')) {
+        log_err(MODULE, "Index '%s' is damaged", path);
+        library_index_close(index);
+        return false;
+    }
+
+    index->header = header;
+    index->roms = (const library_rom_t *)(header + 1);
+    index->slots = (const uint32_t *)(index->roms + header->count);
+    index->paths = (const char *)(index->slots + header->slots);
+
+    for (i = 0; i < header->count; i++) {
+        if (index->roms[i].path >= header->paths_size) {
+            log_err(MODULE, "Index '%s' is damaged", path);
+            library_index_close(index);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//a SHA-1 is already evenly spread, its first bytes are as good a hash as any
+static uint32_t
+library_hash_sha1(const uint8_t *sha1) {
+    return sha1[0] | (sha1[1] << 8) | (sha1[2] << 16) | ((uint32_t)sha1[3] << 24);
+}
+
+//FNV-1a
+static uint32_t
+library_hash_path(const char *path) {
+    uint32_t hash = 2166136261u;
+
+    for (; *path != '\0'; path++) {
+        hash = (hash ^ (uint8_t)*path) * 16777619u;
+    }
+
+    return hash;
+}
+
+static const library_rom_t *
+library_index_find(const library_index_t *index, const uint8_t *sha1) {
+    uint32_t mask, slot, rom;
+
+    if (index->header == NULL) {
+        return NULL;
+    }
+
+    mask = index->header->slots - 1;
+    for (slot = library_hash_sha1(sha1) & mask; (rom = index->slots[slot]) != 0; slot = (slot + 1) & mask) {
+        if (rom <= index->header->count && memcmp(index->roms[rom - 1].sha1, sha1, HASH_SHA1_SIZE) == 0) {
+            return &index->roms[rom - 1];
+        }
+    }
+
+    return NULL;
+}
+
+static bool
+library_is_rom(const char *name) {
+    const char *extension;
+    int i;
+
+    extension = strrchr(name, '.');
+    if (extension == NULL || strlen(extension) != 4) {
+        return false;
+    }
+
+    for (i = 0; i < 4; i++) {
+        if (tolower((unsigned char)extension[i]) != ".nes"[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+typedef struct {
+    library_scan_t *scan;
+    const char *dir;
+    bool success;
+} library_walk_t;
+
+static bool library_walk(library_scan_t *scan, const char *dir);
+
+static bool
+library_walk_entry(const char *name, void *data) {
+    library_walk_t *walk = data;
+    library_scan_t *scan = walk->scan;
+    library_file_t *files;
+    os_file_info_t info;
+    char path[LIBRARY_PATH_MAX];
+
+    if (snprintf(path, sizeof(path), "%s/%s", walk->dir, name) >= (int)sizeof(path)) {
+        log_warn(MODULE, "Skipping '%s/%s', the path is too long", walk->dir, name);
+        return true;
+    }
+
+    if (!os_get_file_info(path, &info)) {
+        log_warn(MODULE, "Skipping '%s': %s", path, strerror(errno));
+        return true;
+    }
+
+    if (info.is_dir) {
+        walk->success = library_walk(scan, path);
+        return walk->success;
+    }
+
+    if (!library_is_rom(name)) {
+        return true;
+    }
+
+    if (scan->count == scan->capacity) {
+        files = realloc(scan->files, (scan->capacity > 0 ? scan->capacity * 2 : 256) * sizeof(library_file_t));
+        if (files == NULL) {
+            log_err(MODULE, "Out of memory");
+            walk->success = false;
+            return false;
+        }
+        scan->files = files;
+        scan->capacity = scan->capacity > 0 ? scan->capacity * 2 : 256;
+    }
+
+    memset(&scan->files[scan->count], 0, sizeof(library_file_t));
+    scan->files[scan->count].path = malloc(strlen(path) + 1);
+    if (scan->files[scan->count].path == NULL) {
+        log_err(MODULE, "Out of memory");
+        walk->success = false;
+        return false;
+    }
+    strlcpy(scan->files[scan->count].path, path, strlen(path) + 1);
+    scan->files[scan->count].info = info;
+    scan->count++;
+
+    return true;
+}
+
+//adds every ROM under dir to the scan
+static bool
+library_walk(library_scan_t *scan, const char *dir) {
+    library_walk_t walk;
+
+    walk.scan = scan;
+    walk.dir = dir;
+    walk.success = true;
+
+    if (!os_list_dir(dir, library_walk_entry, &walk)) {
+        log_warn(MODULE, "Skipping '%s': %s", dir, strerror(errno));
+    }
+
+    return walk.success;
+}
+
+static int
+library_compare_files(const void *a, const void *b) {
+    return strcmp(((const library_file_t *)a)->path, ((const library_file_t *)b)->path);
+}
+
+//hashes a ROM with the header rules cartridge_load() uses, false if it isn't one it could load
+static bool
+library_hash_file(library_file_t *file) {
+    cartridge_info_t info;
+    hash_sha1_t sha1;
+    const uint8_t *data, *rom;
+    size_t size, rom_size, offset, n;
+    uint32_t crc;
+
+    data = os_map_file(file->path, &size);
+    if (data == NULL) {
+        log_warn(MODULE, "Skipping '%s': %s", file->path, strerror(errno));
+        return false;
+    }
+
+    if (!cartridge_read_info(data, size, &info)) {
+        log_warn(MODULE, "Skipping '%s'", file->path);
+        os_unmap_file(data, size);
+        return false;
+    }
+
+    rom = data + info.prg_offset;
+    rom_size = info.prg_size + info.chr_size;
+
+    crc = 0;
+    hash_sha1_start(&sha1);
+    for (offset = 0; offset < rom_size; offset += n) {
+        n = rom_size - offset < LIBRARY_CHUNK_SIZE ? rom_size - offset : LIBRARY_CHUNK_SIZE;
+        crc = hash_crc32(crc, rom + offset, n);
+        hash_sha1_update(&sha1, rom + offset, n);
+    }
+    hash_sha1_finish(&sha1, file->rom.sha1);
+
+    file->rom.crc32 = crc;
+    file->rom.size = file->info.size;
+    file->rom.mtime = file->info.mtime;
+    file->rom.prg_size = info.prg_size;
+    file->rom.chr_size = info.chr_size;
+    file->rom.prg_ram_size = info.prg_ram_size;
+    file->rom.mapper = info.mapper;
+    file->rom.flags = (info.trainer ? LIBRARY_ROM_TRAINER : 0) | (info.battery ? LIBRARY_ROM_BATTERY : 0) |
+                      (cartridge_is_supported(info.mapper) ? LIBRARY_ROM_SUPPORTED : 0);
+
+    os_unmap_file(data, size);
+
+    return true;
+}
+
+//a thread of the pool, takes files until there are none left
+static int
+library_worker(void *data) {
+    library_scan_t *scan = data;
+    int i;
+
+    while ((i = SDL_AtomicAdd(&scan->next, 1)) < scan->count) {
+        if (scan->files[i].indexed) {
+            continue;
+        }
+
+        scan->files[i].indexed = library_hash_file(&scan->files[i]);
+        SDL_AtomicAdd(scan->files[i].indexed ? &scan->hashed : &scan->skipped, 1);
+    }
+
+    return 0;
+}
+
+//files that are the same size and age as when the old index was written take its entry
+static int
+library_reuse(library_scan_t *scan, const library_index_t *old) {
+    const library_rom_t *rom;
+    uint32_t *slots, mask, slot, i;
+    int reused;
+
+    if (old->header == NULL || old->header->count == 0) {
+        return 0;
+    }
+
+    //the old index only has a table by SHA-1, this one is by path
+    for (mask = 1; mask < old->header->count * 2; mask <<= 1);
+    slots = calloc(mask, sizeof(uint32_t));
+    if (slots == NULL) {
+        return 0;
+    }
+    mask--;
+
+    for (i = 0; i < old->header->count; i++) {
+        for (slot = library_hash_path(old->paths + old->roms[i].path) & mask; slots[slot] != 0; slot = (slot + 1) & mask);
+        slots[slot] = i + 1;
+    }
+
+    reused = 0;
+    for (i = 0; i < (uint32_t)scan->count; i++) {
+        for (slot = library_hash_path(scan->files[i].path) & mask; slots[slot] != 0; slot = (slot + 1) & mask) {
+            rom = &old->roms[slots[slot] - 1];
+            if (strcmp(old->paths + rom->path, scan->files[i].path) == 0) {
+                if (rom->size == scan->files[i].info.size && rom->mtime == scan->files[i].info.mtime) {
+                    scan->files[i].rom = *rom;
+                    scan->files[i].indexed = true;
+                    reused++;
+                }
+                break;
+            }
+        }
+    }
+
+    free(slots);
+
+    return reused;
+}
+
+//writes the indexed files next to path and moves them over it
+static bool
+library_write(library_scan_t *scan, const char *path) {
+    library_header_t *header;
+    library_rom_t *roms;
+    uint32_t *slots, mask, slot, count, paths_size;
+    char *paths, temp_path[LIBRARY_PATH_MAX];
+    uint8_t *data;
+    size_t size;
+    FILE *f;
+    bool success;
+    int i;
+
+    count = 0;
+    paths_size = 0;
+    for (i = 0; i < scan->count; i++) {
+        if (scan->files[i].indexed) {
+            count++;
+            paths_size += strlen(scan->files[i].path) + 1;
+        }
+    }
+
+    for (mask = 1; mask < count * 2; mask <<= 1);
+
+    size = sizeof(library_header_t) + count * sizeof(library_rom_t) + mask * sizeof(uint32_t) + paths_size;
+    data = calloc(1, size);
+    if (data == NULL) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+
+    header = (library_header_t *)data;
+    header->magic = LIBRARY_MAGIC;
+    header->version = LIBRARY_VERSION;
+    header->count = count;
+    header->slots = mask;
+    header->paths_size = paths_size;
+
+    roms = (library_rom_t *)(header + 1);
+    slots = (uint32_t *)(roms + count);
+    paths = (char *)(slots + mask);
+    mask--;
+
+    count = 0;
+    paths_size = 0;
+    for (i = 0; i < scan->count; i++) {
+        if (!scan->files[i].indexed) {
+            continue;
+        }
+
+        roms[count] = scan->files[i].rom;
+        roms[count].path = paths_size;
+        strlcpy(paths + paths_size, scan->files[i].path, header->paths_size - paths_size);
+        paths_size += strlen(scan->files[i].path) + 1;
+
+        //copies of the same ROM resolve to the first one
+        for (slot = library_hash_sha1(roms[count].sha1) & mask; slots[slot] != 0; slot = (slot + 1) & mask) {
+            if (memcmp(roms[slots[slot] - 1].sha1, roms[count].sha1, HASH_SHA1_SIZE) == 0) {
+                break;
+            }
+        }
+        if (slots[slot] == 0) {
+            slots[slot] = count + 1;
+        }
+
+        count++;
+    }
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    f = fopen(temp_path, "wb");
+    if (f == NULL) {
+        log_err(MODULE, "Failed to open '%s': %s", temp_path, strerror(errno));
+        free(data);
+        return false;
+    }
+
+    success = fwrite(data, 1, size, f) == size;
+    success = fclose(f) == 0 && success;
+    free(data);
+
+    if (!success) {
+        log_err(MODULE, "Failed to write '%s': %s", temp_path, strerror(errno));
+        remove(temp_path);
+        return false;
+    }
+
+    if (!os_replace_file(temp_path, path)) {
+        log_err(MODULE, "Failed to replace '%s': %s", path, strerror(errno));
+        remove(temp_path);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+library_scan(const char *path, const char **dirs, int count, int threads) {
+    library_index_t old;
+    library_scan_t scan;
+    os_file_info_t info;
+    SDL_Thread **workers = NULL;
+    uint64_t start;
+    bool success = true;
+    int i, reused;
+
+    start = SDL_GetPerformanceCounter();
+    memset(&scan, 0, sizeof(scan));
+
+    for (i = 0; success && i < count; i++) {
+        success = library_walk(&scan, dirs[i]);
+    }
+
+    //the same order every scan, so an unchanged library writes the same index
+    if (scan.count > 0) {
+        qsort(scan.files, scan.count, sizeof(library_file_t), library_compare_files);
+    }
+
+    memset(&old, 0, sizeof(old));
+    reused = 0;
+    if (success && os_get_file_info(path, &info)) {
+        if (library_index_open(&old, path)) {
+            reused = library_reuse(&scan, &old);
+        }
+        else {
+            log_warn(MODULE, "Hashing every ROM again");
+        }
+    }
+
+    //the thread scanning is one of the pool
+    if (success) {
+        threads = threads > 1 ? threads : 1;
+        workers = calloc(threads - 1 > 0 ? threads - 1 : 1, sizeof(SDL_Thread *));
+        if (workers == NULL) {
+            log_err(MODULE, "Out of memory");
+            success = false;
+        }
+    }
+
+    if (success) {
+        for (i = 0; i < threads - 1; i++) {
+            workers[i] = SDL_CreateThread(library_worker, "Library", &scan);
+            if (workers[i] == NULL) {
+                log_warn(MODULE, "Failed to create worker thread: %s", SDL_GetError());
+            }
+        }
+
+        library_worker(&scan);
+
+        for (i = 0; i < threads - 1; i++) {
+            if (workers[i] != NULL) {
+                SDL_WaitThread(workers[i], NULL);
+            }
+        }
+        free(workers);
+
+        //the old index can't be mapped while it's replaced
+        library_index_close(&old);
+        success = library_write(&scan, path);
+    }
+
+    if (success) {
+        log_info(MODULE, "Indexed %d ROMs into '%s' in %.2fs, %d hashed, %d unchanged, %d skipped", SDL_AtomicGet(&scan.hashed) + reused, path,
+                 (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency(), SDL_AtomicGet(&scan.hashed), reused, SDL_AtomicGet(&scan.skipped));
+    }
+
+    library_index_close(&old);
+    for (i = 0; i < scan.count; i++) {
+        free(scan.files[i].path);
+    }
+    free(scan.files);
+
+    return success;
+}
+
+bool
+library_open(const char *path) {
+    library_close();
+
+    if (!library_index_open(&library.index, path)) {
+        return false;
+    }
+
+    log_info(MODULE, "Opened '%s' with %u ROMs", path, library.index.header->count);
+
+    return true;
+}
+
+void
+library_close() {
+    library_index_close(&library.index);
+}
+
+int
+library_get_count() {
+    return library.index.header != NULL ? library.index.header->count : 0;
+}
+
+const library_rom_t *
+library_get_rom(int index) {
+    if (index < 0 || index >= library_get_count()) {
+        return NULL;
+    }
+
+    return &library.index.roms[index];
+}
+
+const char *
+library_get_path(const library_rom_t *rom) {
+    return library.index.paths + rom->path;
+}
+
+const library_rom_t *
+library_find(const uint8_t sha1[HASH_SHA1_SIZE]) {
+    return library_index_find(&library.index, sha1);
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hash.h"
+
+#define LIBRARY_MAGIC           0x4C53454E  //"NESL"
+#define LIBRARY_VERSION         1
+
+//library_rom_t flags
+#define LIBRARY_ROM_TRAINER     (1 << 0)
+#define LIBRARY_ROM_BATTERY     (1 << 1)
+#define LIBRARY_ROM_SUPPORTED   (1 << 2)    //its mapper is implemented
+
+//an index file is a library_header_t, count library_rom_t, slots uint32 and then the ROMs' paths, each with a
+//terminator. it's read straight from the mapping, so everything is in the byte order of the host that wrote it, a host
+//with the other order fails the magic check. the slots are a hash table keyed by SHA-1 and probed linearly, each holds
+//a ROM's index + 1 or 0 when it's empty
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t slots;                         //a power of 2, at least twice count
+    uint32_t paths_size;
+    uint32_t reserved[3];
+} library_header_t;
+
+typedef struct {
+    uint8_t sha1[HASH_SHA1_SIZE];           //of the PRG and CHR ROM, without the header or trainer
+    uint32_t crc32;                         //of the same
+    uint64_t size;                          //of the file when it was hashed
+    int64_t mtime;
+    uint32_t path;                          //offset of the path in the paths
+    uint32_t prg_size;
+    uint32_t chr_size;
+    uint32_t prg_ram_size;
+    uint16_t mapper;
+    uint16_t flags;
+    uint32_t reserved;
+} library_rom_t;
+
+void library_init();
+void library_free();
+
+//indexes every .nes file under dirs into the index at path, hashing them on threads threads. ROMs whose size and mtime
+//match the index already at path keep their entry without being read again
+bool library_scan(const char *path, const char **dirs, int count, int threads);
+
+//maps the index at path for library_find()
+bool library_open(const char *path);
+void library_close();
+
+int library_get_count();
+const library_rom_t * library_get_rom(int index);
+const char * library_get_path(const library_rom_t *rom);
+
+//NULL if no ROM in the open index has the SHA-1
+const library_rom_t * library_find(const uint8_t sha1[HASH_SHA1_SIZE]);
\ No newline at end of file
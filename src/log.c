@@ -35,6 +35,11 @@ log_set_level(log_level_t level) {
     logger.level = level;
 }
 
+log_level_t
+log_get_level() {
+    return logger.level;
+}
+
 void
 log_set_stdout(bool value) {
     logger.to_stdout = value;
@@ -8,6 +8,7 @@
 #define log_debug(module, fmt, ...) log_write(LOG_LEVEL_DEBUG, module, fmt, ##__VA_ARGS__)
 
 typedef enum {
+    LOG_LEVEL_NONE  = -1,                   //not even errors, for tests that cause them on purpose
     LOG_LEVEL_ERR   = 0,
     LOG_LEVEL_WARN  = 1,
     LOG_LEVEL_INFO  = 2,
@@ -19,6 +20,7 @@ void log_init();
 void log_free();
 
 void log_set_level(log_level_t level);
+log_level_t log_get_level();
 void log_set_stdout(bool value);
 void log_set_file(const char *file);
 
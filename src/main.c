@@ -1,28 +1,274 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include "log.h"
+#include "battery.h"
+#include "hash.h"
+#include "library.h"
+#include "image.h"
+#include "archive.h"
+#include "capture.h"
 #include "cartridge.h"
 #include "cpu.h"
 #include "cpu_test.h"
+#include "debug.h"
+#include "filter.h"
+#include "filter_test.h"
+#include "ppu_test.h"
+#include "cartridge_test.h"
+#include "archive_test.h"
+#include "ntsc.h"
 #include "ppu.h"
+#include "stream.h"
 
 #define MODULE "Main"
 
+#define MAIN_FRAME_FRESH        4           //set on the middle frame until the presentation thread picks it up
+#define MAIN_INPUT_QUEUE_SIZE   64
+#define MAIN_BENCHMARK_FRAMES   600
+#define MAIN_SCAN_DIRS          16
+
+typedef enum {
+    MAIN_INPUT_PAUSE,
+    MAIN_INPUT_QUIT
+} main_input_t;
+
+//triple buffer of locked textures, the emulation thread owns the back one, the presentation thread owns the front one
+//and they trade through the middle one without ever waiting on each other
+typedef struct {
+    SDL_Texture *textures[3];
+    void *pixels[3];
+    int pitches[3];
+    int back;                               //emulation thread only
+    int front;                              //presentation thread only
+    SDL_atomic_t middle;                    //index of the middle frame, | MAIN_FRAME_FRESH if it wasn't presented yet
+} main_frames_t;
+
+//single producer, single consumer queue from the presentation thread to the emulation thread
+typedef struct {
+    main_input_t inputs[MAIN_INPUT_QUEUE_SIZE];
+    SDL_atomic_t head;                      //next slot written by the presentation thread
+    SDL_atomic_t tail;                      //next slot read by the emulation thread
+} main_input_queue_t;
+
+static main_frames_t frames;
+static main_input_queue_t input_queue;
+
+//one ROM for each mapper with a compiled CPU core
+static const char *main_benchmark_roms[] = {
+    "../../roms/test/nestest.nes",          //mapper 0, NROM
+    "../../roms/legend_of_zelda.nes",       //mapper 1, MMC1
+    "../../roms/donkey_kong.nes",           //mapper 3, CNROM. this dump has 32KB of CHR ROM, not the usual 8KB NROM one
+    "../../roms/super_mario_bros3.nes"      //mapper 4, MMC3
+};
+
+static bool
+main_input_push(main_input_t input) {
+    int head;
+
+    head = SDL_AtomicGet(&input_queue.head);
+    if (head - SDL_AtomicGet(&input_queue.tail) == MAIN_INPUT_QUEUE_SIZE) {
+        return false;
+    }
+
+    input_queue.inputs[head % MAIN_INPUT_QUEUE_SIZE] = input;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&input_queue.head, head + 1);
+
+    return true;
+}
+
+static bool
+main_input_pop(main_input_t *input) {
+    int tail;
+
+    tail = SDL_AtomicGet(&input_queue.tail);
+    if (tail == SDL_AtomicGet(&input_queue.head)) {
+        return false;
+    }
+
+    SDL_MemoryBarrierAcquire();
+    *input = input_queue.inputs[tail % MAIN_INPUT_QUEUE_SIZE];
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&input_queue.tail, tail + 1);
+
+    return true;
+}
+
+//the PPU renders straight into the locked texture, it's unlocked again only to be presented
+static bool
+main_lock_frame(int index) {
+    if (SDL_LockTexture(frames.textures[index], NULL, &frames.pixels[index], &frames.pitches[index]) != 0) {
+        log_err(MODULE, "Failed to lock SDL texture: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+//the PPU renders into slot 0 only, with no second framebuffer it never swaps on its own. the triple buffer is the
+//swap, main_frame_ready() hands it the new back frame before the next one starts
+static void
+main_set_back_frame() {
+    ppu_set_framebuffer(0, frames.pixels[frames.back], frames.pitches[frames.back]);
+}
+
+//runs on the emulation thread
+static void
+main_frame_ready(int index, void *framebuffer, void *data) {
+    const uint16_t *indices;
+    int pitch;
+
+    indices = ppu_get_indices(index, &pitch);
+    stream_frame(indices, pitch, ppu_get_dirty_rows());
+    debug_capture();
+
+    //the frame didn't change, there's nothing new to present and the capture only needs to repeat it
+    if (framebuffer == NULL) {
+        capture_frame(NULL, 0);
+        return;
+    }
+
+    capture_frame(framebuffer, frames.pitches[frames.back]);
+
+    SDL_MemoryBarrierRelease();
+    frames.back = SDL_AtomicSet(&frames.middle, frames.back | MAIN_FRAME_FRESH) & ~MAIN_FRAME_FRESH;
+    SDL_MemoryBarrierAcquire();
+
+    main_set_back_frame();
+}
+
+//runs on the presentation thread, returns the index of a new frame to present or -1 if there isn't one
+static int
+main_take_frame() {
+    if (!(SDL_AtomicGet(&frames.middle) & MAIN_FRAME_FRESH)) {
+        return -1;
+    }
+
+    SDL_MemoryBarrierRelease();
+    frames.front = SDL_AtomicSet(&frames.middle, frames.front) & ~MAIN_FRAME_FRESH;
+    SDL_MemoryBarrierAcquire();
+
+    return frames.front;
+}
+
+static int
+main_emulate(void *data) {
+    main_input_t input;
+    Uint32 start, elapsed;
+    bool looping, paused;
+
+    looping = true;
+    paused = false;
+
+    while (looping) {
+        start = SDL_GetTicks();
+
+        while (main_input_pop(&input)) {
+            switch (input) {
+                case MAIN_INPUT_PAUSE:
+                    paused = !paused;
+                    break;
+                case MAIN_INPUT_QUIT:
+                    looping = false;
+                    break;
+            }
+        }
+
+        if (paused) {
+            SDL_Delay(100);
+            continue;
+        }
+
+        cpu_run_frame();
+
+        //make sure we're running at 60FPS
+        elapsed = SDL_GetTicks() - start;
+        if (elapsed < (1000.0 / 60.0)) {
+            SDL_Delay((1000.0 / 60.0) - elapsed);
+        }
+    }
+
+    return 0;
+}
+
+//shows what a streaming emulator sends, in place of emulating
+static void
+main_stream_client(SDL_Renderer *renderer, const char *path) {
+    static stream_client_t client;
+    SDL_Event e;
+    int y;
+
+    if (!stream_client_connect(&client, path)) {
+        return;
+    }
+
+    while (stream_client_receive(&client)) {
+        while (SDL_PollEvent(&e) != 0) {
+            if (e.type == SDL_QUIT) {
+                stream_client_close(&client);
+                return;
+            }
+        }
+
+        for (y = 0; y < 240; y++) {
+            ppu_convert_indices((uint32_t *)((uint8_t *)frames.pixels[0] + y * frames.pitches[0]), client.pixels + y * 256);
+        }
+
+        SDL_UnlockTexture(frames.textures[0]);
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, frames.textures[0], NULL, NULL);
+        SDL_RenderPresent(renderer);
+        if (!main_lock_frame(0)) {
+            break;
+        }
+
+        if (client.stats.frame % 60 == 0) {
+            log_info(MODULE, "Frame %u: %d tiles, %d bytes, %.0fus latency", client.stats.frame, client.stats.tiles, (int)client.stats.bytes, client.stats.latency_us);
+        }
+    }
+
+    stream_client_close(&client);
+}
+
 int
 main(int argc, char **arv) {
     SDL_Window *window = NULL;
     SDL_Renderer *renderer = NULL;
-    SDL_Texture *texture = NULL;
+    SDL_Texture *scaled = NULL;
+    SDL_Thread *thread = NULL;
     SDL_Event e;
-    Uint32 start, elapsed;
-    bool success, looping, paused;
+    filter_type_t filter_type;
+    ppu_change_stats_t changes;
+    void *pixels;
+    const char *capture_path, *stream_path, *stream_client_path, *library_path, *rom_path;
+    const char *scan_dirs[MAIN_SCAN_DIRS];
+    const char **pack_files;
+    const library_rom_t *rom;
+    uint8_t sha1[HASH_SHA1_SIZE];
+    bool success, looping, benchmark, passed;
+    int i, status, frame, pitch, width, height, scan_count, pack_count;
 
     log_init();
     cpu_init();
     cpu_test_init();
+    battery_init();
+    hash_init();
+    library_init();
+    image_init();
     cartridge_init();
     ppu_init();
+    capture_init();
+    stream_init();
+    debug_init();
+    filter_init();
+    filter_test_init();
+    ppu_test_init();
+    cartridge_test_init();
+    archive_test_init();
+    ntsc_init();
 
     log_set_level(LOG_LEVEL_DEBUG);
 
@@ -31,6 +277,97 @@ main(int argc, char **arv) {
         fprintf(stderr, "Failed to open log file: %s", log_get_error());
     }
 
+    filter_type = FILTER_NONE;
+    benchmark = false;
+    status = EXIT_SUCCESS;
+    capture_path = NULL;
+    stream_path = NULL;
+    stream_client_path = NULL;
+    library_path = NULL;
+    rom_path = NULL;
+    scan_count = 0;
+    pack_files = NULL;
+    pack_count = 0;
+    for (i = 1; success && i < argc; i++) {
+        if (strcmp(arv[i], "--benchmark") == 0) {
+            benchmark = true;
+        }
+        else if (strcmp(arv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = arv[++i];
+        }
+        else if (strcmp(arv[i], "--stream") == 0 && i + 1 < argc) {
+            stream_path = arv[++i];
+        }
+        else if (strcmp(arv[i], "--stream-client") == 0 && i + 1 < argc) {
+            stream_client_path = arv[++i];
+        }
+        else if (strcmp(arv[i], "--save-interval") == 0 && i + 1 < argc) {
+            battery_set_interval(atoi(arv[++i]));
+        }
+        else if (strcmp(arv[i], "--library") == 0 && i + 1 < argc) {
+            library_path = arv[++i];
+        }
+        else if (strcmp(arv[i], "--scan") == 0 && i + 1 < argc && scan_count < MAIN_SCAN_DIRS) {
+            scan_dirs[scan_count++] = arv[++i];
+        }
+        else if (strcmp(arv[i], "--rom") == 0 && i + 1 < argc) {
+            rom_path = arv[++i];
+        }
+        else if (strcmp(arv[i], "--pack") == 0 && i + 2 < argc) {
+            //the pack, then every file after it goes in it
+            pack_files = (const char **)arv + i + 1;
+            pack_count = argc - i - 2;
+            break;
+        }
+        else {
+            filter_type = filter_find(arv[i]);
+            if (filter_type == FILTER_COUNT) {
+                log_err(MODULE, "Unknown filter '%s'", arv[i]);
+                success = false;
+            }
+        }
+    }
+
+    //indexing ROMs is a tool of its own, it runs without SDL or a window
+    if (success && scan_count > 0) {
+        if (library_path == NULL) {
+            log_err(MODULE, "--scan needs --library to write the index to");
+        }
+        else {
+            library_scan(library_path, scan_dirs, scan_count, SDL_GetCPUCount());
+        }
+        success = false;
+    }
+
+    //and so is packing ROMs
+    if (success && pack_files != NULL) {
+        archive_write_pack(pack_files[0], pack_files + 1, pack_count);
+        success = false;
+    }
+
+    //--rom is a path, or the SHA-1 of a ROM in the library
+    if (success && rom_path != NULL && library_path != NULL && hash_sha1_from_hex(rom_path, sha1)) {
+        success = library_open(library_path);
+        if (success) {
+            rom = library_find(sha1);
+            if (rom == NULL) {
+                log_err(MODULE, "No ROM in '%s' has the SHA-1 %s", library_path, rom_path);
+                success = false;
+            }
+            else {
+                rom_path = library_get_path(rom);
+            }
+        }
+    }
+
+    //captured frames are the emulator's own ARGB ones, not the NTSC filter's
+    if (success && capture_path != NULL && filter_type == FILTER_NTSC) {
+        log_err(MODULE, "Frames can't be captured with the ntsc filter");
+        success = false;
+    }
+    width = success ? filter_get_width(filter_type) : 256;
+    height = success ? filter_get_height(filter_type) : 240;
+
     if (success) {
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
             log_err("Could not initialize SDL: %s", SDL_GetError());
@@ -39,7 +376,26 @@ main(int argc, char **arv) {
     }
 
     if (success) {
-        window = SDL_CreateWindow("NES", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 256, 240, SDL_WINDOW_SHOWN);
+        success = filter_open(SDL_GetCPUCount());
+    }
+
+    //archive formats, mappers, filters and CPU cores are checked and benchmarked on their own, without a window
+    if (success && benchmark) {
+        //every one runs even after another failed, and any failure is the exit status
+        passed = archive_test_formats();
+        passed = cartridge_test_mappers() && passed;
+        passed = filter_test_benchmark(MAIN_BENCHMARK_FRAMES) && passed;
+        passed = cpu_test_benchmark(main_benchmark_roms, sizeof(main_benchmark_roms) / sizeof(main_benchmark_roms[0]), MAIN_BENCHMARK_FRAMES) && passed;
+        passed = ppu_test_observations("../../roms/donkey_kong.nes", MAIN_BENCHMARK_FRAMES) && passed;
+        if (!passed) {
+            log_err(MODULE, "Benchmark checks failed");
+            status = EXIT_FAILURE;
+        }
+        success = false;
+    }
+
+    if (success) {
+        window = SDL_CreateWindow("NES", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, width * 240 / 256, SDL_WINDOW_SHOWN);
         if (window == NULL) {
             log_err(MODULE, "Failed to create SDL Window: %s", SDL_GetError());
             success = false;
@@ -54,47 +410,102 @@ main(int argc, char **arv) {
         }
     }
 
-    if (success) {
-        texture = SDL_CreateTexture (renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 256, 240);
-        if (texture == NULL) {
+    for (i = 0; success && i < 3; i++) {
+        frames.textures[i] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 256, 240);
+        if (frames.textures[i] == NULL) {
+            log_err(MODULE, "Failed to create SDL texture: %s", SDL_GetError());
+            success = false;
+        }
+        else {
+            success = main_lock_frame(i);
+        }
+    }
+
+    if (success && stream_client_path != NULL) {
+        main_stream_client(renderer, stream_client_path);
+        success = false;
+    }
+
+    if (success && filter_type != FILTER_NONE) {
+        scaled = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (scaled == NULL) {
             log_err(MODULE, "Failed to create SDL texture: %s", SDL_GetError());
             success = false;
         }
     }
 
     if (success) {
-        //success = cartridge_load("../../roms/test/nestest.nes");
-        //success = cartridge_load("../../roms/test/ppu_palette_ram.nes");
-        success = cartridge_load("../../roms/donkey_kong.nes");
-        //success = cartridge_load("../../roms/scanline/scanline.nes");
-        //success = cartridge_load("../../roms/legend_of_zelda.nes");
-        //success = cartridge_load("../../roms/super_mario_bros3.nes");
+        if (rom_path != NULL) {
+            success = cartridge_load(rom_path, 0);
+        }
+        else {
+            //success = cartridge_load("../../roms/test/nestest.nes", CARTRIDGE_LOAD_TEST);
+            //success = cartridge_load("../../roms/test/ppu_palette_ram.nes", 0);
+            success = cartridge_load("../../roms/donkey_kong.nes", 0);
+            //success = cartridge_load("../../roms/scanline/scanline.nes", 0);
+            //success = cartridge_load("../../roms/legend_of_zelda.nes", 0);
+            //success = cartridge_load("../../roms/super_mario_bros3.nes", 0);
+        }
         if (success) {
             cpu_power();
             ppu_reset();
         }
     }
 
+    //every frame is wanted for regression captures, so the emulation waits on the writer rather than drop any
+    if (success && capture_path != NULL) {
+        success = capture_open(capture_path, capture_find_format(capture_path), CAPTURE_POLICY_BLOCK);
+    }
+    if (success && stream_path != NULL) {
+        success = stream_open(stream_path);
+    }
+
     if (success) {
-        ppu_set_texture(texture);
+        frames.back = 0;
+        SDL_AtomicSet(&frames.middle, 1);
+        frames.front = 2;
 
-        looping = true;
-        paused = false;
+        ppu_set_format(filter_type == FILTER_NTSC ? PPU_FORMAT_INDEXED : PPU_FORMAT_ARGB8888);
+        ppu_set_frame_ready(main_frame_ready, NULL);
+        ppu_set_change_detection(true);
+        main_set_back_frame();
+
+        thread = SDL_CreateThread(main_emulate, "Emulation", NULL);
+        if (thread == NULL) {
+            log_err(MODULE, "Failed to create emulation thread: %s", SDL_GetError());
+            success = false;
+        }
+    }
 
-        while (success && looping) {
-            start = SDL_GetTicks();
+    if (success) {
+        looping = true;
 
+        while (looping) {
             while (SDL_PollEvent(&e) != 0) {
                 switch (e.type) {
                     case SDL_KEYDOWN:
                         switch (e.key.keysym.sym) {
                             case SDLK_p:
-                                paused = !paused;
+                                main_input_push(MAIN_INPUT_PAUSE);
+                                break;
+                            case SDLK_d:
+                                if (debug_is_open()) {
+                                    debug_close();
+                                }
+                                else {
+                                    debug_open();
+                                }
                                 break;
                             default:
                                 break;
                         }
 
+                        break;
+                    case SDL_WINDOWEVENT:
+                        //with the debug windows open, closing the main window doesn't quit on its own
+                        if (!debug_handle_event(&e) && e.window.event == SDL_WINDOWEVENT_CLOSE) {
+                            looping = false;
+                        }
                         break;
                     case SDL_QUIT:
                         looping = false;
@@ -102,27 +513,62 @@ main(int argc, char **arv) {
                 }
             }
 
-            if (paused) {
-                SDL_Delay(100);
-                break;
+            debug_update();
+
+            frame = main_take_frame();
+            if (frame == -1) {
+                SDL_Delay(1);
+                continue;
             }
 
-            cpu_run_frame();
+            //filtered here, on the worker threads, while the emulation thread carries on. the frame's texture
+            //is only read so it stays locked
+            if (scaled != NULL) {
+                if (SDL_LockTexture(scaled, NULL, &pixels, &pitch) == 0) {
+                    filter_run(filter_type, frames.pixels[frame], frames.pitches[frame], pixels, pitch);
+                    SDL_UnlockTexture(scaled);
+                }
+
+                SDL_RenderClear(renderer);
+                SDL_RenderCopy(renderer, scaled, NULL, NULL);
+                SDL_RenderPresent(renderer);
+                continue;
+            }
 
+            SDL_UnlockTexture(frames.textures[frame]);
             SDL_RenderClear(renderer);
-            SDL_RenderCopy(renderer, texture, NULL, NULL);
+            SDL_RenderCopy(renderer, frames.textures[frame], NULL, NULL);
             SDL_RenderPresent(renderer);
 
-            //make sure we're running at 60FPS
-            elapsed = SDL_GetTicks() - start;
-            if (elapsed < (1000.0 / 60.0)) {
-                SDL_Delay((1000.0 / 60.0) - elapsed);
+            //the emulation thread only gets this frame back through the middle slot, after it's locked again
+            if (!main_lock_frame(frame)) {
+                looping = false;
             }
         }
     }
 
-    if (texture != NULL) {
-        SDL_DestroyTexture(texture);
+    if (thread != NULL) {
+        while (!main_input_push(MAIN_INPUT_QUIT)) {
+            SDL_Delay(1);
+        }
+        SDL_WaitThread(thread, NULL);
+
+        ppu_get_change_stats(&changes);
+        if (changes.frames > 0) {
+            log_info(MODULE, "Skipped %u of %u frames (%.1f%%) and %u of %u rows (%.1f%%) that didn't change", changes.unchanged_frames, changes.frames,
+                     changes.unchanged_frames * 100.0 / changes.frames, changes.unchanged_rows, changes.rows, changes.unchanged_rows * 100.0 / changes.rows);
+        }
+    }
+    capture_close();
+    stream_close();
+
+    if (scaled != NULL) {
+        SDL_DestroyTexture(scaled);
+    }
+    for (i = 0; i < 3; i++) {
+        if (frames.textures[i] != NULL) {
+            SDL_DestroyTexture(frames.textures[i]);
+        }
     }
     if (renderer != NULL) {
         SDL_DestroyRenderer(renderer);
@@ -132,12 +578,25 @@ main(int argc, char **arv) {
     }
     log_close();
 
-    SDL_Quit();
+    capture_free();
+    stream_free();
+    debug_free();
+    filter_free();
+    filter_test_free();
+    ppu_test_free();
+    cartridge_test_free();
+    archive_test_free();
+    ntsc_free();
+    //flushes the save file on the battery thread, before SDL is gone
     cartridge_free();
+    image_free();
+    battery_free();
+    library_free();
+    SDL_Quit();
     cpu_free();
     cpu_test_free();
     ppu_free();
     log_free();
 
-    return 0;
+    return status;
 }
\ No newline at end of file
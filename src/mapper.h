@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    int write_n;
+    uint8_t register_tmp;
+    uint8_t registers[4];
+} mapper1_state_t;
+
+typedef struct {
+    bool prg_size_16k;
+    uint8_t registers[1];
+} mapper3_state_t;
+
+typedef struct {
+    uint8_t register8000;
+    uint8_t registers[8];
+    bool horizontal_mirroring;
+    uint8_t irq_period;
+    uint8_t irq_counter;
+    bool irq_enabled;
+} mapper4_state_t;
+
+//registers of whichever mapper is loaded, zeroed before reset() is called
+typedef union {
+    mapper1_state_t mapper1;
+    mapper3_state_t mapper3;
+    mapper4_state_t mapper4;
+} mapper_state_t;
+
+//bound once when a cartridge is loaded. PRG and CHR reads never go through here, they index the banks mapped with
+//cartridge_map_prg() and cartridge_map_chr() directly
+typedef struct {
+    int number;
+    const char *name;
+    void (*reset)(mapper_state_t *state, const uint8_t *header);            //maps the power on banks and mirroring
+    void (*write)(mapper_state_t *state, uint16_t address, uint8_t value);  //$8000-$FFFF
+    void (*signal_scanline)(mapper_state_t *state);                         //NULL if the mapper doesn't count scanlines
+} mapper_t;
+
+extern const mapper_t mapper0;
+extern const mapper_t mapper1;
+extern const mapper_t mapper3;
+extern const mapper_t mapper4;
+
+//register writes, called directly by the CPU core compiled for the mapper
+void mapper1_write(mapper_state_t *state, uint16_t address, uint8_t value);
+void mapper3_write(mapper_state_t *state, uint16_t address, uint8_t value);
+void mapper4_write(mapper_state_t *state, uint16_t address, uint8_t value);
+
+//bank switching for the mappers, a negative PRG bank counts from the last one
+void cartridge_map_prg(int page_kbs, int slot, int bank);
+void cartridge_map_chr(int page_kbs, int slot, int bank);
+
+//the 8KB PRG banks at $8000-$FFFF and the mapper's registers, for the CPU cores
+const unsigned char * const * cartridge_get_prg_banks();
+mapper_state_t * cartridge_get_mapper_state();
\ No newline at end of file
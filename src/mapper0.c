@@ -0,0 +1,24 @@
+#include "ppu.h"
+#include "mapper.h"
+
+//NROM, no registers
+
+static void
+mapper0_reset(mapper_state_t *state, const uint8_t *header) {
+    cartridge_map_prg(32, 0, 0);
+    cartridge_map_chr(8, 0, 0);
+
+    ppu_set_mirroring(header[6] & 0x01 ? PPU_MIRRORING_VERTICAL : PPU_MIRRORING_HORIZONTAL);
+}
+
+static void
+mapper0_write(mapper_state_t *state, uint16_t address, uint8_t value) {
+    //mapper 0 is read only
+}
+
+const mapper_t mapper0 = {
+    .number = 0,
+    .name = "NROM",
+    .reset = mapper0_reset,
+    .write = mapper0_write
+};
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "log.h"
+#include "ppu.h"
+#include "mapper.h"
+
+#define MODULE "Mapper1"
+
+//MMC1, registers are written one bit at a time through a shift register
+
+//register 0 picks the PRG and CHR modes and the mirroring, 1 and 2 the CHR banks and 3 the PRG bank
+static void
+mapper1_map_prg(mapper1_state_t *mapper1) {
+    if (mapper1->registers[0] & 0b1000) {
+        //16KB PRG
+        if (mapper1->registers[0] & 0b100) {
+            cartridge_map_prg(16, 0, mapper1->registers[3] & 0xF);
+            cartridge_map_prg(16, 1, 0xF);
+        }
+        else {
+            cartridge_map_prg(16, 0, 0);
+            cartridge_map_prg(16, 1, mapper1->registers[3] & 0xF);
+        }
+    }
+    else {
+        //32KB PRG
+        cartridge_map_prg(32, 0, (mapper1->registers[3] & 0xF) >> 1);
+    }
+}
+
+static void
+mapper1_map_chr(mapper1_state_t *mapper1) {
+    if (mapper1->registers[0] & 0b10000) {
+        //4KB CHR
+        cartridge_map_chr(4, 0, mapper1->registers[1]);
+        cartridge_map_chr(4, 1, mapper1->registers[2]);
+    }
+    else {
+        //8KB CHR
+        cartridge_map_chr(8, 0, mapper1->registers[1] >> 1);
+    }
+}
+
+static void
+mapper1_set_mirroring(mapper1_state_t *mapper1) {
+    switch (mapper1->registers[0] & 0b11) {
+        case 2:
+            ppu_set_mirroring(PPU_MIRRORING_VERTICAL);
+            break;
+        case 3:
+            ppu_set_mirroring(PPU_MIRRORING_HORIZONTAL);
+            break;
+        default:
+            log_err(MODULE, "Error setting mirroring for mapper 1: Invalid register value %u (%u)", mapper1->registers[0], mapper1->registers[0] & 0b11);
+            break;
+    }
+}
+
+static void
+mapper1_reset(mapper_state_t *state, const uint8_t *header) {
+    state->mapper1.registers[0] = 0x0C;
+
+    mapper1_map_prg(&state->mapper1);
+    mapper1_map_chr(&state->mapper1);
+    mapper1_set_mirroring(&state->mapper1);
+}
+
+void
+mapper1_write(mapper_state_t *state, uint16_t address, uint8_t value) {
+    mapper1_state_t *mapper1 = &state->mapper1;
+    int index;
+
+    if (value & 0x80) {
+        //only the PRG mode is reset
+        mapper1->write_n = 0;
+        mapper1->register_tmp = 0;
+        mapper1->registers[0] |= 0x0C;
+        mapper1_map_prg(mapper1);
+    }
+    else {
+        mapper1->register_tmp = ((value & 1) << 4) | (mapper1->register_tmp >> 1);
+        if (++mapper1->write_n == 5) {
+            index = (address >> 13) & 0b11;
+            mapper1->registers[index] = mapper1->register_tmp;
+            mapper1->write_n = 0;
+            mapper1->register_tmp = 0;
+
+            switch (index) {
+                case 0:
+                    mapper1_map_prg(mapper1);
+                    mapper1_map_chr(mapper1);
+                    mapper1_set_mirroring(mapper1);
+                    break;
+                case 1:
+                case 2:
+                    mapper1_map_chr(mapper1);
+                    break;
+                case 3:
+                    mapper1_map_prg(mapper1);
+                    break;
+            }
+        }
+    }
+}
+
+const mapper_t mapper1 = {
+    .number = 1,
+    .name = "MMC1",
+    .reset = mapper1_reset,
+    .write = mapper1_write
+};
\ No newline at end of file
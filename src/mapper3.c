@@ -0,0 +1,35 @@
+#include "ppu.h"
+#include "mapper.h"
+
+//CNROM, one register selecting the 8KB CHR bank
+
+static void
+mapper3_reset(mapper_state_t *state, const uint8_t *header) {
+    state->mapper3.prg_size_16k = header[4] == 1;
+    ppu_set_mirroring(header[6] & 0x01 ? PPU_MIRRORING_VERTICAL : PPU_MIRRORING_HORIZONTAL);
+
+    //PRG never moves
+    if (state->mapper3.prg_size_16k) {
+        cartridge_map_prg(16, 0, 0);
+        cartridge_map_prg(16, 1, 0);
+    }
+    else {
+        cartridge_map_prg(16, 0, 0);
+        cartridge_map_prg(16, 1, 1);
+    }
+
+    cartridge_map_chr(8, 0, state->mapper3.registers[0] & 0b11);
+}
+
+void
+mapper3_write(mapper_state_t *state, uint16_t address, uint8_t value) {
+    state->mapper3.registers[0] = value;
+    cartridge_map_chr(8, 0, value & 0b11);
+}
+
+const mapper_t mapper3 = {
+    .number = 3,
+    .name = "CNROM",
+    .reset = mapper3_reset,
+    .write = mapper3_write
+};
\ No newline at end of file
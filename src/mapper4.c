@@ -0,0 +1,143 @@
+#include "log.h"
+#include "cpu.h"
+#include "ppu.h"
+#include "mapper.h"
+
+#define MODULE "Mapper4"
+
+//MMC3, 8 bank registers selected through $8000 and a scanline counter raising IRQs
+
+//$8000 and $C000, the only PRG banks that move when the PRG mode changes
+static void
+mapper4_map_prg(mapper4_state_t *mapper4) {
+    if (!(mapper4->register8000 & 1 << 6)) {
+        //PRG mode 0
+        cartridge_map_prg(8, 0, mapper4->registers[6]);
+        cartridge_map_prg(8, 2, -2);
+    }
+    else {
+        //PRG mode 1
+        cartridge_map_prg(8, 0, -2);
+        cartridge_map_prg(8, 2, mapper4->registers[6]);
+    }
+}
+
+//the CHR banks of registers 0-5, CHR mode 1 swaps the 2KB banks at $0000 with the 1KB banks at $1000
+static void
+mapper4_map_chr(mapper4_state_t *mapper4, int index) {
+    bool mode1;
+
+    mode1 = mapper4->register8000 & (1 << 7);
+
+    if (index < 2) {
+        cartridge_map_chr(2, index + (mode1 ? 2 : 0), mapper4->registers[index] >> 1);
+    }
+    else {
+        cartridge_map_chr(1, index - 2 + (mode1 ? 0 : 4), mapper4->registers[index]);
+    }
+}
+
+static void
+mapper4_reset(mapper_state_t *state, const uint8_t *header) {
+    int i;
+
+    state->mapper4.horizontal_mirroring = true;
+
+    cartridge_map_prg(8, 3, -1);
+    cartridge_map_prg(8, 1, state->mapper4.registers[7]);
+    mapper4_map_prg(&state->mapper4);
+    for (i = 0; i < 6; i++) {
+        mapper4_map_chr(&state->mapper4, i);
+    }
+
+    ppu_set_mirroring(PPU_MIRRORING_HORIZONTAL);
+}
+
+void
+mapper4_write(mapper_state_t *state, uint16_t address, uint8_t value) {
+    mapper4_state_t *mapper4 = &state->mapper4;
+    uint8_t changed;
+    int i, index;
+
+    //only the banks a write actually moves are remapped, the IRQ registers don't touch any
+    switch (address & 0xE001) {
+        case 0x8000:
+            changed = mapper4->register8000 ^ value;
+            mapper4->register8000 = value;
+
+            if (changed & (1 << 6)) {
+                mapper4_map_prg(mapper4);
+            }
+            if (changed & (1 << 7)) {
+                for (i = 0; i < 6; i++) {
+                    mapper4_map_chr(mapper4, i);
+                }
+            }
+            break;
+        case 0x8001:
+            index = mapper4->register8000 & 0b111;
+            mapper4->registers[index] = value;
+
+            if (index < 6) {
+                mapper4_map_chr(mapper4, index);
+            }
+            else if (index == 6) {
+                mapper4_map_prg(mapper4);
+            }
+            else {
+                cartridge_map_prg(8, 1, value);
+            }
+            break;
+        case 0xA000:
+            //changing the mirroring invalidates every cached nametable tile
+            if (mapper4->horizontal_mirroring != (value & 1)) {
+                mapper4->horizontal_mirroring = value & 1;
+                ppu_set_mirroring(mapper4->horizontal_mirroring ? PPU_MIRRORING_HORIZONTAL : PPU_MIRRORING_VERTICAL);
+            }
+            break;
+        case 0xA001:
+            //PRG RAM protection, the RAM is always enabled and writable
+            break;
+        case 0xC000:
+            mapper4->irq_period = value;
+            break;
+        case 0xC001:
+            mapper4->irq_counter = 0;
+            break;
+        case 0xE000:
+            //disables IRQs and acknowledges the one pending
+            mapper4->irq_enabled = false;
+            cpu_clear_irq();
+            break;
+        case 0xE001:
+            mapper4->irq_enabled = true;
+            break;
+        default:
+            log_err(MODULE, "Error writing to mapper4 address 0x%04X: Unhandled address", address);
+            break;
+    }
+}
+
+static void
+mapper4_signal_scanline(mapper_state_t *state) {
+    mapper4_state_t *mapper4 = &state->mapper4;
+
+    if (mapper4->irq_counter == 0) {
+        mapper4->irq_counter = mapper4->irq_period;
+    }
+    else {
+        --mapper4->irq_counter;
+    }
+
+    if (mapper4->irq_enabled && mapper4->irq_counter == 0) {
+        cpu_set_irq();
+    }
+}
+
+const mapper_t mapper4 = {
+    .number = 4,
+    .name = "MMC3",
+    .reset = mapper4_reset,
+    .write = mapper4_write,
+    .signal_scanline = mapper4_signal_scanline
+};
\ No newline at end of file
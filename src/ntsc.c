@@ -0,0 +1,220 @@
+#include <math.h>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define NTSC_SSE2
+#endif
+//only when the build targets it, /arch:AVX2 or -mavx2, there's no runtime dispatch
+#if defined(__AVX2__)
+# include <immintrin.h>
+# define NTSC_AVX2
+#endif
+#include "ntsc.h"
+
+#define NTSC_GROUP_IN   3                   //3 NES pixels...
+#define NTSC_GROUP_OUT  7                   //...make 7 output pixels
+#define NTSC_GROUPS     ((256 + NTSC_GROUP_IN - 1) / NTSC_GROUP_IN)
+#define NTSC_SAMPLES    8                   //composite samples per NES pixel, one per master clock
+#define NTSC_PERIOD     12                  //samples per color subcarrier cycle
+#define NTSC_PHASES     3                   //each line starts 4 samples further into the subcarrier
+#define NTSC_KERNEL     8                   //output pixels one NES pixel reaches
+#define NTSC_PAD        2                   //output pixels a group's first NES pixel reaches to its left
+#define NTSC_SHIFT      5                   //fraction bits of the kernels
+#define NTSC_HUE        4.0                 //hue and saturation that bring flat colors closest to the palette
+#define NTSC_SATURATION 2.1
+
+#if !defined(M_PI)
+# define M_PI 3.14159265358979323846
+#endif
+
+//like blargg's nes_ntsc, decoding is linear so what each NES pixel adds to the output pixels around it is worked
+//out up front for every palette entry, and a line is just the sum of its pixels' kernels
+typedef struct {
+    int16_t kernels[NTSC_PHASES][NTSC_GROUP_IN][8 * 64][NTSC_KERNEL][4];   //B, G, R, 0 added to each output pixel
+    int first[NTSC_GROUP_IN];               //first output pixel each pixel of a group reaches, relative to the group's
+} ntsc_t;
+
+//composite voltages of the 4 luma levels when the signal is low then high
+static const double ntsc_levels[8] = {0.350, 0.518, 0.962, 1.550, 1.094, 1.506, 1.962, 1.962};
+static const double ntsc_black = 0.518;
+static const double ntsc_white = 1.962;
+
+static ntsc_t ntsc;
+
+static int
+ntsc_in_color_phase(int color, int phase) {
+    return (color + phase) % NTSC_PERIOD < 6;
+}
+
+//signal of palette entry index at a subcarrier phase, 0 is black and 1 is white
+static double
+ntsc_signal(int index, int phase) {
+    int color, level, emphasis;
+    double low, high, signal;
+
+    color = index & 0x0F;
+    level = (index >> 4) & 0x03;
+    emphasis = index >> 6;
+
+    if (color > 13) {
+        level = 1;
+    }
+
+    low = ntsc_levels[level];
+    high = ntsc_levels[4 + level];
+    if (color == 0) {
+        low = high;
+    }
+    if (color > 12) {
+        high = low;
+    }
+
+    signal = ntsc_in_color_phase(color, phase) ? high : low;
+
+    //emphasis attenuates the signal during the phases of red, green and blue
+    if (((emphasis & 0x01) && ntsc_in_color_phase(0x0C, phase)) ||
+        ((emphasis & 0x02) && ntsc_in_color_phase(0x04, phase)) ||
+        ((emphasis & 0x04) && ntsc_in_color_phase(0x08, phase))) {
+        signal *= 0.746;
+    }
+
+    return (signal - ntsc_black) / (ntsc_white - ntsc_black);
+}
+
+//first composite sample of the subcarrier cycle an output pixel is decoded from, relative to its group
+static int
+ntsc_window(int out) {
+    return (int)floor(out * (double)(NTSC_GROUP_IN * NTSC_SAMPLES) / NTSC_GROUP_OUT + 0.5) - NTSC_PERIOD / 2;
+}
+
+static void
+ntsc_build_kernel(int16_t kernel[NTSC_KERNEL][4], int line, int pixel, int index) {
+    double y, i, q, signal, angle, rgb[3];
+    int k, s, window, phase, c;
+
+    for (k = 0; k < NTSC_KERNEL; k++) {
+        window = ntsc_window(ntsc.first[pixel] + k);
+        y = i = q = 0;
+
+        //only the samples of this pixel, the others come from its neighbors' kernels
+        for (s = window; s < window + NTSC_PERIOD; s++) {
+            if (s < pixel * NTSC_SAMPLES || s >= (pixel + 1) * NTSC_SAMPLES) {
+                continue;
+            }
+
+            phase = (s + line * 4) % NTSC_PERIOD;
+            signal = ntsc_signal(index, phase);
+            angle = M_PI * (phase + NTSC_HUE) / 6;
+
+            y += signal;
+            i += signal * cos(angle);
+            q += signal * sin(angle);
+        }
+
+        y /= NTSC_PERIOD;
+        i = i / NTSC_PERIOD * NTSC_SATURATION;
+        q = q / NTSC_PERIOD * NTSC_SATURATION;
+
+        rgb[0] = y + 0.946882 * i + 0.623557 * q;
+        rgb[1] = y - 0.274788 * i - 0.635691 * q;
+        rgb[2] = y - 1.108545 * i + 1.709007 * q;
+
+        for (c = 0; c < 3; c++) {
+            kernel[k][2 - c] = (int16_t)floor(rgb[c] * 255 * (1 << NTSC_SHIFT) + 0.5);
+        }
+        kernel[k][3] = 0;
+    }
+}
+
+void
+ntsc_init() {
+    int line, pixel, index, out;
+
+    memset(&ntsc, 0, sizeof(ntsc));
+
+    //the first output pixel whose subcarrier cycle overlaps the pixel's samples
+    for (pixel = 0; pixel < NTSC_GROUP_IN; pixel++) {
+        for (out = -NTSC_PAD; ntsc_window(out) + NTSC_PERIOD <= pixel * NTSC_SAMPLES; out++);
+        ntsc.first[pixel] = out;
+    }
+
+    for (line = 0; line < NTSC_PHASES; line++) {
+        for (pixel = 0; pixel < NTSC_GROUP_IN; pixel++) {
+            for (index = 0; index < 8 * 64; index++) {
+                ntsc_build_kernel(ntsc.kernels[line][pixel][index], line, pixel, index);
+            }
+        }
+    }
+}
+
+void
+ntsc_free() {
+}
+
+void
+ntsc_row(uint32_t *out, const uint16_t *in, int phase) {
+    int16_t sums[(NTSC_GROUPS * NTSC_GROUP_OUT + NTSC_PAD + NTSC_KERNEL) * 4];
+    const int16_t *kernel;
+    int16_t *sum;
+    int start, x, i, c, value;
+#if defined(NTSC_AVX2)
+    __m256i alpha256;
+#endif
+#if defined(NTSC_SSE2)
+    __m128i alpha;
+#endif
+
+    memset(sums, 0, sizeof(sums));
+
+    //pixels 2 groups apart never reach the same output pixels, visiting them in that order keeps each add from reading
+    //sums the one before it has only just partly stored
+    for (start = 0; start < NTSC_GROUP_IN * 2; start++) {
+        for (x = start; x < 256; x += NTSC_GROUP_IN * 2) {
+            kernel = ntsc.kernels[phase][x % NTSC_GROUP_IN][in[x] & 0x1FF][0];
+            sum = sums + ((x / NTSC_GROUP_IN) * NTSC_GROUP_OUT + ntsc.first[x % NTSC_GROUP_IN] + NTSC_PAD) * 4;
+
+#if defined(NTSC_AVX2)
+            for (i = 0; i < NTSC_KERNEL * 4; i += 16) {
+                _mm256_storeu_si256((__m256i *)(sum + i), _mm256_adds_epi16(_mm256_loadu_si256((const __m256i *)(sum + i)), _mm256_loadu_si256((const __m256i *)(kernel + i))));
+            }
+#elif defined(NTSC_SSE2)
+            for (i = 0; i < NTSC_KERNEL * 4; i += 8) {
+                _mm_storeu_si128((__m128i *)(sum + i), _mm_adds_epi16(_mm_loadu_si128((const __m128i *)(sum + i)), _mm_loadu_si128((const __m128i *)(kernel + i))));
+            }
+#else
+            for (i = 0; i < NTSC_KERNEL * 4; i++) {
+                value = sum[i] + kernel[i];
+                sum[i] = value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value);
+            }
+#endif
+        }
+    }
+
+    sum = sums + NTSC_PAD * 4;
+    x = 0;
+
+#if defined(NTSC_AVX2)
+    //packing works within 128 bit lanes, the permute puts the 4 pixels of each half back in order
+    alpha256 = _mm256_set1_epi32(0xFF000000);
+    for (; x + 8 <= NTSC_WIDTH; x += 8) {
+        _mm256_storeu_si256((__m256i *)(out + x), _mm256_or_si256(alpha256, _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_srai_epi16(_mm256_loadu_si256((const __m256i *)(sum + x * 4)), NTSC_SHIFT),
+                                                                                                                         _mm256_srai_epi16(_mm256_loadu_si256((const __m256i *)(sum + x * 4 + 16)), NTSC_SHIFT)), 0xD8)));
+    }
+#endif
+
+#if defined(NTSC_SSE2)
+    alpha = _mm_set1_epi32(0xFF000000);
+    for (; x + 4 <= NTSC_WIDTH; x += 4) {
+        _mm_storeu_si128((__m128i *)(out + x), _mm_or_si128(alpha, _mm_packus_epi16(_mm_srai_epi16(_mm_loadu_si128((const __m128i *)(sum + x * 4)), NTSC_SHIFT),
+                                                                                    _mm_srai_epi16(_mm_loadu_si128((const __m128i *)(sum + x * 4 + 8)), NTSC_SHIFT))));
+    }
+#endif
+
+    for (; x < NTSC_WIDTH; x++) {
+        out[x] = 0xFF000000;
+        for (c = 0; c < 3; c++) {
+            value = sum[x * 4 + c] >> NTSC_SHIFT;
+            out[x] |= (value < 0 ? 0 : (value > 255 ? 255 : value)) << (c * 8);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+#define NTSC_WIDTH 602                      //output pixels of a 256 pixel line, 7 for every 3
+
+void ntsc_init();
+void ntsc_free();
+
+//a line of PPU_FORMAT_INDEXED pixels as an NTSC TV would show it, phase is the color burst phase 0-2 of the line
+void ntsc_row(uint32_t *out, const uint16_t *in, int phase);
\ No newline at end of file
@@ -1,7 +1,15 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #if defined(_WIN32)
 # include <Windows.h>
 # else
 # include <unistd.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <dirent.h>
 #endif
 #include "os.h"
 
@@ -21,4 +29,243 @@ os_sleep_ms(unsigned int ms) {
 #else
     usleep(ms * 1000);
 #endif
+}
+
+const void *
+os_map_file(const char *path, size_t *size) {
+#if defined(_WIN32)
+    HANDLE file, mapping;
+    LARGE_INTEGER file_size;
+    void *data;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        errno = EIO;
+        return NULL;
+    }
+
+    //the view keeps the mapping alive
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == NULL) {
+        errno = EIO;
+        return NULL;
+    }
+
+    *size = (size_t)file_size.QuadPart;
+
+    return data;
+#else
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return NULL;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    //the mapping keeps the file alive
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    *size = st.st_size;
+
+    return data;
+#endif
+}
+
+void *
+os_map_file_shared(const char *path, size_t size) {
+#if defined(_WIN32)
+    HANDLE file, mapping;
+    void *data;
+
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        errno = EACCES;
+        return NULL;
+    }
+
+    //the mapping grows the file if it's smaller than size
+    mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        errno = EIO;
+        return NULL;
+    }
+
+    data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    CloseHandle(mapping);
+    if (data == NULL) {
+        errno = EIO;
+        return NULL;
+    }
+
+    return data;
+#else
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == -1 || ((size_t)st.st_size < size && ftruncate(fd, size) == -1)) {
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    return data;
+#endif
+}
+
+bool
+os_sync_file(void *data, size_t offset, size_t size) {
+#if defined(_WIN32)
+    return FlushViewOfFile((char *)data + offset, size);
+#else
+    size_t page, start;
+
+    //msync() only takes whole pages
+    page = sysconf(_SC_PAGESIZE);
+    start = offset / page * page;
+
+    return msync((char *)data + start, offset + size - start, MS_SYNC) == 0;
+#endif
+}
+
+bool
+os_get_file_info(const char *path, os_file_info_t *info) {
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    uint64_t time;
+
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes)) {
+        errno = ENOENT;
+        return false;
+    }
+
+    //FILETIME counts 100ns since 1601
+    time = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    info->mtime = (int64_t)(time / 10000000) - 11644473600LL;
+    info->size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    info->is_dir = (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+
+    return true;
+#else
+    struct stat st;
+
+    if (stat(path, &st) == -1) {
+        return false;
+    }
+
+    info->size = st.st_size;
+    info->mtime = st.st_mtime;
+    info->is_dir = S_ISDIR(st.st_mode);
+
+    return true;
+#endif
+}
+
+bool
+os_list_dir(const char *path, bool (*func)(const char *name, void *data), void *data) {
+#if defined(_WIN32)
+    WIN32_FIND_DATAA entry;
+    HANDLE find;
+    char pattern[MAX_PATH];
+
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+
+    find = FindFirstFileA(pattern, &entry);
+    if (find == INVALID_HANDLE_VALUE) {
+        errno = ENOENT;
+        return false;
+    }
+
+    do {
+        if (strcmp(entry.cFileName, ".") != 0 && strcmp(entry.cFileName, "..") != 0 && !func(entry.cFileName, data)) {
+            break;
+        }
+    } while (FindNextFileA(find, &entry));
+
+    FindClose(find);
+
+    return true;
+#else
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir(path);
+    if (dir == NULL) {
+        return false;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0 && !func(entry->d_name, data)) {
+            break;
+        }
+    }
+
+    closedir(dir);
+
+    return true;
+#endif
+}
+
+bool
+os_replace_file(const char *from, const char *to) {
+#if defined(_WIN32)
+    if (!MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING)) {
+        errno = EACCES;
+        return false;
+    }
+
+    return true;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+void
+os_unmap_file(const void *data, size_t size) {
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
 }
\ No newline at end of file
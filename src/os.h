@@ -1,4 +1,33 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t size;
+    int64_t mtime;                          //seconds since 1970
+    bool is_dir;
+} os_file_info_t;
+
 void os_sleep_sec(unsigned int sec);
-void os_sleep_ms(unsigned int ms);
\ No newline at end of file
+void os_sleep_ms(unsigned int ms);
+
+//maps a whole file read only, pages are shared with every other process mapping it. returns NULL and sets errno on failure
+const void * os_map_file(const char *path, size_t *size);
+void os_unmap_file(const void *data, size_t size);
+
+//maps size bytes of a file for reading and writing, creating it or growing it to size first. writes reach the file
+//without a write call, os_sync_file() waits until a range of them is on disk
+void * os_map_file_shared(const char *path, size_t size);
+bool os_sync_file(void *data, size_t offset, size_t size);
+
+//returns false and sets errno on failure
+bool os_get_file_info(const char *path, os_file_info_t *info);
+
+//calls func with the name of every entry in a directory but . and .., stopping if it returns false. returns false
+//and sets errno if the directory can't be read
+bool os_list_dir(const char *path, bool (*func)(const char *name, void *data), void *data);
+
+//moves a file over another in one step, so it's never seen half written
+bool os_replace_file(const char *from, const char *to);
\ No newline at end of file
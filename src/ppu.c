@@ -1,5 +1,24 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define PPU_SSE2
+#endif
+//the AVX2 conversions are built wherever the compiler can target AVX2 and used when the CPU has it
+#if defined(__AVX2__) || defined(_M_X64) || defined(_M_IX86) || ((defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)))
+# include <immintrin.h>
+# define PPU_AVX2
+# if defined(__GNUC__) || defined(__clang__)
+#  define PPU_TARGET_AVX2 __attribute__((target("avx2")))
+# else
+#  define PPU_TARGET_AVX2
+# endif
+#endif
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+#include <SDL2/SDL.h>
 #include "log.h"
 #include "cpu.h"
 #include "cartridge.h"
@@ -8,10 +27,38 @@
 #define MODULE "PPU"
 
 #define PPU_SPRITES 8
+#define PPU_VISIBLE_SCANLINES 240
+#define PPU_SCANLINES         262
+#define PPU_DOTS              341
+
+#define PPU_LAYER_SIZE 256                  //a nametable layer is 32x32 tiles, the last 2 rows are the attribute table read as tiles
+#define PPU_INVALIDATION_LOG_SIZE 4096
+
+//work done on a single dot, executed in the order listed
+#define PPU_ACTION_VBLANK_SET       (1 << 0)
+#define PPU_ACTION_FRAME_END        (1 << 1)
+#define PPU_ACTION_CLEAR_OAM2       (1 << 2)
+#define PPU_ACTION_CLEAR_FLAGS      (1 << 3)    //sprite overflow, sprite 0 hit and vblank
+#define PPU_ACTION_EVALUATE_SPRITES (1 << 4)
+#define PPU_ACTION_LOAD_SPRITES     (1 << 5)
+#define PPU_ACTION_BACKGROUND_LINE  (1 << 6)
+#define PPU_ACTION_PIXEL            (1 << 7)
+#define PPU_ACTION_HSCROLL          (1 << 8)
+#define PPU_ACTION_VSCROLL          (1 << 9)
+#define PPU_ACTION_HSCROLL_UPDATE   (1 << 10)
+#define PPU_ACTION_VSCROLL_UPDATE   (1 << 11)
+#define PPU_ACTION_ODD_FRAME_SKIP   (1 << 12)
+#define PPU_ACTION_SCANLINE_SIGNAL  (1 << 13)
+
+//work that only feeds the picture, skipped on lines that can't produce a sprite 0 hit when video is off
+#define PPU_ACTIONS_PICTURE (PPU_ACTION_LOAD_SPRITES | PPU_ACTION_BACKGROUND_LINE | PPU_ACTION_PIXEL)
 
 #define NTH_BIT(x, n) (((x) >> (n)) & 1)
 
-static uint32_t nes_rgb[] ={
+//pattern and nametable fetches, only valid below $3F00
+#define ppu_fetch(address) (ppu.pages[((address) >> 10) & 0xF][(address) & 0x3FF])
+
+static const uint32_t nes_rgb[] ={
     0x7C7C7C, 0x0000FC, 0x0000BC, 0x4428BC, 0x940084, 0xA80020, 0xA81000, 0x881400,
     0x503000, 0x007800, 0x006800, 0x005800, 0x004058, 0x000000, 0x000000, 0x000000,
     0xBCBCBC, 0x0078F8, 0x0058F8, 0x6844FC, 0xD800CC, 0xE40058, 0xF83800, 0xE45C10,
@@ -22,6 +69,18 @@ static uint32_t nes_rgb[] ={
     0xF8D878, 0xD8F878, 0xB8F8B8, 0xB8F8D8, 0x00FCFC, 0xF8D8F8, 0x000000, 0x000000
 };
 
+//nes_rgb for each of the 8 PPUMASK emphasis combinations, indexed by (emphasis << 6) | color
+static uint32_t nes_rgb_emphasis[8 * 64];
+static uint32_t nes_rgb565_emphasis[8 * 64];        //32 bits wide so it can be gathered the same way as the RGB table
+static uint32_t nes_luma_emphasis[8 * 64];          //same
+
+//converts the palette indices of a frame row, the fastest the host's CPU has
+typedef struct {
+    void (*row32)(uint32_t *out, const uint16_t *in, const uint32_t *table);
+    void (*row16)(uint16_t *out, const uint16_t *in, const uint32_t *table);
+    void (*luma)(uint8_t *out, const uint16_t *in);
+} ppu_converters_t;
+
 typedef struct {
     uint8_t id;
     uint8_t x;
@@ -84,113 +143,736 @@ typedef union {
     unsigned int r: 15;
 } ppu_address_t;
 
+//everything the host configured about where frames go, survives a reset
 typedef struct {
-    SDL_Texture *texture;
-    unsigned char ci[0x800];                //VRAM for nametables
+    void *framebuffers[2];                  //host owned, rendered into alternately
+    int pitches[2];
+    int framebuffer;                        //framebuffer the current frame goes to
+    ppu_frame_ready_t frame_ready;
+    void *frame_ready_data;
+    ppu_format_t format;
+    ppu_observation_t observation;          //observation.ring is NULL if there's no observation
+    unsigned int observations;              //observations written since ppu_set_observation()
+    uint16_t observation_x[256];            //first source column of each observation column
+    uint16_t observation_x_end[256];        //one past its last source column, only used by the box filter
+    uint16_t observation_y[240];            //same for rows
+    uint16_t observation_y_end[240];
+    uint16_t *previous;                     //PPU_FORMAT_INDEXED pixels of the last frame with change detection, else NULL
+    bool previous_valid;                    //false until a frame was compared, or after the format changed
+    bool changed;                           //whether the last frame differed from the one before
+    uint32_t dirty_rows[(PPU_VISIBLE_SCANLINES + 31) / 32];
+    ppu_change_stats_t changes;
+} ppu_output_t;
+
+typedef struct {
+    ppu_output_t output;
+    uint8_t *pages[16];                     //1KB pages of $0000-$3FFF, 0-7 are CHR and 8-15 are nametables
+    unsigned char ci[0x1000];               //VRAM for nametables, the upper 2KB is only used by four screen cartridges
     unsigned char cg[0x100];                //VRAM for palettes
     unsigned char oam[0x100];               //VRAM for sprite properties
-    uint16_t oam_address;
-    uint32_t pixels[256 * 240];
+    uint16_t palette[0x20];                 //cg resolved to (emphasis << 6) | color with the current grayscale and emphasis bits
+    uint8_t oam_address;
+    uint64_t sprite_index[PPU_VISIBLE_SCANLINES];  //bit N set if sprite N is on the scanline
+    int sprite_index_height;                //sprite height the index was built for, 0 if it needs a rebuild
+    uint16_t pixels[256 * 240];             //(emphasis << 6) | color of every pixel, converted to ppu.output.format at the end of the frame
+    uint16_t *line;                         //where the current scanline's pixels go, the framebuffer itself for PPU_FORMAT_INDEXED
     ppu_sprite_t sprites[PPU_SPRITES];
     ppu_sprite_t sprites2[PPU_SPRITES];
     int scanline;
     int dot;
     bool odd_frame;
+    bool video;                             //generate pixels this frame
+    bool video_next;                        //set by ppu_set_video(), latched on the pre-render line
+    int mode;                               //which action table drives the PPU
     ppu_control_t control;                  //PPUCTRL ($2000) register
     ppu_status_t status;                    //PPUSTATUS ($2002) register
     ppu_mask_t mask;                        //PPUMASK ($2001) register
     ppu_mirroring_t mirroring;
-    // Background latches:
-    uint8_t latch_nametable;
-    uint8_t latch_at;
-    uint8_t latch_background_low;
-    uint8_t latch_background_high;
-    // Background shift registers:
-    uint8_t at_shift_low;
-    uint8_t at_shift_high;
-    uint8_t bg_shift_low;
-    uint8_t bg_shift_high;
-    bool at_latch_low;
-    bool at_latch_high;
+    uint8_t layers[4][PPU_LAYER_SIZE][PPU_LAYER_SIZE];  //decoded background palette index of every pixel of each nametable
+    uint32_t layer_dirty[4][32];            //bit N of row Y is set if tile (N, Y) has to be decoded again
+    uint32_t patterns_dirty[8];             //bit N % 32 of [N / 32] is set if background pattern N changed since the last line
+    bool patterns_changed;
+    uint8_t line_background[256];           //background palette index of every pixel of the current line
+    bool invalidation_log_enabled;
+    int invalidation_log_count;
+    unsigned int invalidations_dropped;
+    ppu_invalidation_t invalidation_log[PPU_INVALIDATION_LOG_SIZE];
     uint8_t fine_x;                             //Fine X
     ppu_address_t v_address;                    //Loopy V
     ppu_address_t t_address;                    //Loopy T
 } ppu_t;
 
+typedef enum {
+    PPU_MODE_FULL,
+    PPU_MODE_TIMING,                        //only what's needed for registers, vblank, sprite 0 hit and overflow
+    PPU_MODE_COUNT
+} ppu_mode_t;
+
 typedef enum {
     PPU_SCANLINE_TYPE_PRE,
     PPU_SCANLINE_TYPE_VISIBLE,
     PPU_SCANLINE_TYPE_POST,
-    PPU_SCANLINE_TYPE_VBLANK
+    PPU_SCANLINE_TYPE_VBLANK,
+    PPU_SCANLINE_TYPE_IDLE,
+    PPU_SCANLINE_TYPE_COUNT
 } ppu_scanline_type_t;
 
 static ppu_t ppu;
+static ppu_converters_t ppu_converters;
+
+static uint8_t ppu_scanline_types[PPU_SCANLINES];
+static uint32_t ppu_actions[PPU_MODE_COUNT][PPU_SCANLINE_TYPE_COUNT][PPU_DOTS];
+static uint16_t ppu_idle_dots[PPU_MODE_COUNT][PPU_SCANLINE_TYPE_COUNT][PPU_DOTS];  //number of dots without work from this dot to the end of the line
 
 #define ppu_rendering()     (ppu.mask.show_background || ppu.mask.show_sprites)
 #define ppu_sprite_height() (ppu.control.sprite_size ? 16 : 8)
 
+static int
+ppu_lowest_bit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+    unsigned long index;
+
+    //32 bit builds only have the 32 bit scan
+    if (_BitScanForward(&index, (unsigned long)value)) {
+        return index;
+    }
+    _BitScanForward(&index, (unsigned long)(value >> 32));
+    return index + 32;
+#elif defined(_MSC_VER)
+    unsigned long index;
+
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+static void
+ppu_log_invalidation(ppu_invalidation_reason_t reason, int nametable, int x, int y) {
+    ppu_invalidation_t *entry;
+
+    if (!ppu.invalidation_log_enabled) {
+        return;
+    }
+
+    if (ppu.invalidation_log_count == PPU_INVALIDATION_LOG_SIZE) {
+        ++ppu.invalidations_dropped;
+        return;
+    }
+
+    entry = &ppu.invalidation_log[ppu.invalidation_log_count++];
+    entry->reason = reason;
+    entry->nametable = nametable;
+    entry->x = x;
+    entry->y = y;
+}
+
+static void
+ppu_invalidate_tile(ppu_invalidation_reason_t reason, int nametable, int x, int y) {
+    if (ppu.layer_dirty[nametable][y] & (1u << x)) {
+        return;
+    }
+
+    ppu.layer_dirty[nametable][y] |= 1u << x;
+    ppu_log_invalidation(reason, nametable, x, y);
+}
+
+static void
+ppu_invalidate_all() {
+    memset(ppu.layer_dirty, 0xFF, sizeof(ppu.layer_dirty));
+    memset(ppu.patterns_dirty, 0, sizeof(ppu.patterns_dirty));
+    ppu.patterns_changed = false;
+    ppu_log_invalidation(PPU_INVALIDATION_ALL, 0, 0, 0);
+}
+
+//a nametable or attribute byte changed, every logical nametable that maps to it needs the affected tiles decoded again
+static void
+ppu_invalidate_nametable_byte(uint16_t address) {
+    uint8_t *page;
+    int nametable, offset, x, y;
+
+    page = ppu.pages[(address >> 10) & 0xF];
+    offset = address & 0x3FF;
+
+    for (nametable = 0; nametable < 4; nametable++) {
+        if (ppu.pages[8 + nametable] != page) {
+            continue;
+        }
+
+        ppu_invalidate_tile(PPU_INVALIDATION_NAMETABLE, nametable, offset % 32, offset / 32);
+
+        if (offset >= 0x3C0) {
+            for (y = 0; y < 4; y++) {
+                for (x = 0; x < 4; x++) {
+                    ppu_invalidate_tile(PPU_INVALIDATION_ATTRIBUTE, nametable, (offset - 0x3C0) % 8 * 4 + x, (offset - 0x3C0) / 8 * 4 + y);
+                }
+            }
+        }
+    }
+}
+
+//background pattern data changed for tiles first through first + count - 1, the tiles that use them are found on the
+//next line so a CHR RAM upload byte by byte doesn't search the nametables for every byte
+static void
+ppu_invalidate_patterns(int first, int count) {
+    int i;
+
+    for (i = first; i < first + count; i++) {
+        ppu.patterns_dirty[i / 32] |= 1u << (i % 32);
+    }
+    ppu.patterns_changed = true;
+}
+
+static void
+ppu_resolve_patterns() {
+    const uint8_t *names;
+    int nametable, i;
+
+    if (!ppu.patterns_changed) {
+        return;
+    }
+
+    for (nametable = 0; nametable < 4; nametable++) {
+        names = ppu.pages[8 + nametable];
+
+        for (i = 0; i < 30 * 32; i++) {
+            if (ppu.patterns_dirty[names[i] / 32] & (1u << (names[i] % 32))) {
+                ppu_invalidate_tile(PPU_INVALIDATION_CHR, nametable, i % 32, i / 32);
+            }
+        }
+
+        //the attribute table is only shown as tiles when a game scrolls into it, so its rows are decoded again whatever
+        //they name
+        for (i = 0; i < 32; i++) {
+            ppu_invalidate_tile(PPU_INVALIDATION_CHR, nametable, i, 30);
+            ppu_invalidate_tile(PPU_INVALIDATION_CHR, nametable, i, 31);
+        }
+    }
+
+    memset(ppu.patterns_dirty, 0, sizeof(ppu.patterns_dirty));
+    ppu.patterns_changed = false;
+}
+
+static void
+ppu_decode_tile(int nametable, int x, int y) {
+    const uint8_t *names;
+    uint8_t attribute, low, high, value, *out;
+    uint16_t pattern;
+    int row, col;
+
+    names = ppu.pages[8 + nametable];
+
+    attribute = (names[0x3C0 + (y / 4) * 8 + x / 4] >> (((y & 2) << 1) | (x & 2))) & 3;
+    pattern = ppu.control.background_pattern_table * 0x1000 + names[y * 32 + x] * 16;
+
+    for (row = 0; row < 8; row++) {
+        low = ppu_fetch(pattern + row);
+        high = ppu_fetch(pattern + row + 8);
+        out = &ppu.layers[nametable][y * 8 + row][x * 8];
+
+        for (col = 0; col < 8; col++) {
+            value = (NTH_BIT(high, 7 - col) << 1) | NTH_BIT(low, 7 - col);
+            out[col] = value == 0 ? 0 : value | (attribute << 2);
+        }
+    }
+}
+
+static void
+ppu_decode_dirty_tiles(int nametable, int y) {
+    uint32_t dirty;
+    int x;
+
+    dirty = ppu.layer_dirty[nametable][y];
+    ppu.layer_dirty[nametable][y] = 0;
+
+    while (dirty != 0) {
+        x = ppu_lowest_bit(dirty);
+        dirty &= dirty - 1;
+
+        ppu_decode_tile(nametable, x, y);
+    }
+}
+
+//copies the current line's background out of the nametable layers at the scroll position in v and fine x
+static void
+ppu_background_line() {
+    int x, y, nametable, count;
+
+    //v is already 2 tiles ahead from the prefetch at the end of the previous line
+    x = ((((ppu.v_address.nametable & 1) << 8) | (ppu.v_address.coarse_x << 3)) + ppu.fine_x - 16) & 0x1FF;
+    y = (ppu.v_address.coarse_y << 3) | ppu.v_address.fine_y;
+    nametable = (ppu.v_address.nametable & 2) | (x >> 8);
+    x &= 0xFF;
+
+    ppu_resolve_patterns();
+    ppu_decode_dirty_tiles(nametable, y / 8);
+    ppu_decode_dirty_tiles(nametable ^ 1, y / 8);
+
+    count = 256 - x;
+    memcpy(ppu.line_background, &ppu.layers[nametable][y][x], count);
+    memcpy(ppu.line_background + count, ppu.layers[nametable ^ 1][y], 256 - count);
+}
+
+static void
+ppu_build_emphasis_table() {
+    int emphasis, color, channel;
+    uint32_t rgb, component;
+
+    for (emphasis = 0; emphasis < 8; emphasis++) {
+        for (color = 0; color < 64; color++) {
+            rgb = nes_rgb[color];
+
+            //emphasizing a color darkens the other two channels, bit 0 is red, 1 is green and 2 is blue
+            for (channel = 0; channel < 3; channel++) {
+                if (emphasis != 0 && !(emphasis & (1 << channel))) {
+                    component = (rgb >> (16 - channel * 8)) & 0xFF;
+                    rgb &= ~(0xFF << (16 - channel * 8));
+                    rgb |= (component * 3 / 4) << (16 - channel * 8);
+                }
+            }
+
+            nes_rgb_emphasis[(emphasis << 6) | color] = rgb;
+            nes_rgb565_emphasis[(emphasis << 6) | color] = ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F);
+            nes_luma_emphasis[(emphasis << 6) | color] = (((rgb >> 16) & 0xFF) * 77 + ((rgb >> 8) & 0xFF) * 150 + (rgb & 0xFF) * 29) >> 8;
+        }
+    }
+}
+
+static void
+ppu_update_palette_entry(int index) {
+    uint8_t color;
+
+    color = ppu.cg[index] & (ppu.mask.grayscale ? 0x30 : 0x3F);
+    ppu.palette[index] = (ppu.mask.value >> 5) << 6 | color;
+
+    //the background color of each sprite palette mirrors the background palettes
+    if ((index & 0x13) == 0) {
+        ppu.palette[index | 0x10] = ppu.palette[index];
+    }
+}
+
+static void
+ppu_update_palette() {
+    int i;
+
+    for (i = 0; i < 0x10; i++) {
+        ppu_update_palette_entry(i);
+    }
+    for (i = 0x10; i < 0x20; i++) {
+        if ((i & 0x13) != 0x10) {
+            ppu_update_palette_entry(i);
+        }
+    }
+}
+
+static void
+ppu_build_action_table() {
+    uint32_t *actions;
+    int mode, type, scanline, dot;
+
+    for (scanline = 0; scanline < PPU_SCANLINES; scanline++) {
+        if (scanline < PPU_VISIBLE_SCANLINES) {
+            ppu_scanline_types[scanline] = PPU_SCANLINE_TYPE_VISIBLE;
+        }
+        else if (scanline == 240) {
+            ppu_scanline_types[scanline] = PPU_SCANLINE_TYPE_POST;
+        }
+        else if (scanline == 241) {
+            ppu_scanline_types[scanline] = PPU_SCANLINE_TYPE_VBLANK;
+        }
+        else if (scanline == 261) {
+            ppu_scanline_types[scanline] = PPU_SCANLINE_TYPE_PRE;
+        }
+        else {
+            ppu_scanline_types[scanline] = PPU_SCANLINE_TYPE_IDLE;
+        }
+    }
+
+    memset(ppu_actions, 0, sizeof(ppu_actions));
+
+    for (type = PPU_SCANLINE_TYPE_PRE; type <= PPU_SCANLINE_TYPE_VISIBLE; type++) {
+        actions = ppu_actions[PPU_MODE_FULL][type];
+
+        //sprites
+        actions[1] |= PPU_ACTION_CLEAR_OAM2;
+        actions[257] |= PPU_ACTION_EVALUATE_SPRITES;
+        actions[321] |= PPU_ACTION_LOAD_SPRITES;
+
+        //scrolling, v still moves one tile every 8 dots even though the tiles come from the layer cache
+        for (dot = 8; dot <= 336; dot += 8) {
+            if (dot <= 248 || dot >= 328) {
+                actions[dot] |= PPU_ACTION_HSCROLL;
+            }
+        }
+        actions[256] |= PPU_ACTION_VSCROLL;
+        actions[257] |= PPU_ACTION_HSCROLL_UPDATE;
+
+        actions[260] |= PPU_ACTION_SCANLINE_SIGNAL;
+    }
+
+    //background and pixels
+    actions = ppu_actions[PPU_MODE_FULL][PPU_SCANLINE_TYPE_VISIBLE];
+    actions[1] |= PPU_ACTION_BACKGROUND_LINE;
+    for (dot = 2; dot <= 257; dot++) {
+        actions[dot] |= PPU_ACTION_PIXEL;
+    }
+
+    actions = ppu_actions[PPU_MODE_FULL][PPU_SCANLINE_TYPE_PRE];
+    actions[1] |= PPU_ACTION_CLEAR_FLAGS;
+    for (dot = 280; dot <= 304; dot++) {
+        actions[dot] |= PPU_ACTION_VSCROLL_UPDATE;
+    }
+    actions[340] |= PPU_ACTION_ODD_FRAME_SKIP;
+
+    ppu_actions[PPU_MODE_FULL][PPU_SCANLINE_TYPE_POST][0] = PPU_ACTION_FRAME_END;
+    ppu_actions[PPU_MODE_FULL][PPU_SCANLINE_TYPE_VBLANK][1] = PPU_ACTION_VBLANK_SET;
+
+    for (type = 0; type < PPU_SCANLINE_TYPE_COUNT; type++) {
+        for (dot = 0; dot < PPU_DOTS; dot++) {
+            ppu_actions[PPU_MODE_TIMING][type][dot] = ppu_actions[PPU_MODE_FULL][type][dot] & ~PPU_ACTIONS_PICTURE;
+        }
+    }
+
+    for (mode = 0; mode < PPU_MODE_COUNT; mode++) {
+        for (type = 0; type < PPU_SCANLINE_TYPE_COUNT; type++) {
+            for (dot = PPU_DOTS - 1; dot >= 0; dot--) {
+                if (ppu_actions[mode][type][dot] != 0) {
+                    ppu_idle_dots[mode][type][dot] = 0;
+                }
+                else {
+                    ppu_idle_dots[mode][type][dot] = dot == PPU_DOTS - 1 ? 1 : ppu_idle_dots[mode][type][dot + 1] + 1;
+                }
+            }
+        }
+    }
+}
+
+static void
+ppu_convert_row32(uint32_t *out, const uint16_t *in, const uint32_t *table) {
+    int x;
+
+    for (x = 0; x < 256; x++) {
+        out[x] = table[in[x]];
+    }
+}
+
+static void
+ppu_convert_row16(uint16_t *out, const uint16_t *in, const uint32_t *table) {
+    int x;
+
+    for (x = 0; x < 256; x++) {
+        out[x] = (uint16_t)table[in[x]];
+    }
+}
+
+static void
+ppu_luma_row(uint8_t *out, const uint16_t *in) {
+    int x;
+
+    for (x = 0; x < 256; x++) {
+        out[x] = (uint8_t)nes_luma_emphasis[in[x]];
+    }
+}
+
+#if defined(PPU_AVX2)
+PPU_TARGET_AVX2 static void
+ppu_convert_row32_avx2(uint32_t *out, const uint16_t *in, const uint32_t *table) {
+    __m256i index;
+    int x;
+
+    for (x = 0; x < 256; x += 8) {
+        index = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in + x)));
+        _mm256_storeu_si256((__m256i *)(out + x), _mm256_i32gather_epi32((const int *)table, index, 4));
+    }
+}
+
+PPU_TARGET_AVX2 static void
+ppu_convert_row16_avx2(uint16_t *out, const uint16_t *in, const uint32_t *table) {
+    __m256i lo, hi;
+    int x;
+
+    for (x = 0; x < 256; x += 16) {
+        lo = _mm256_i32gather_epi32((const int *)table, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in + x))), 4);
+        hi = _mm256_i32gather_epi32((const int *)table, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in + x + 8))), 4);
+
+        //packing works per 128 bit lane, put the 4 quarters back in order afterwards
+        _mm256_storeu_si256((__m256i *)(out + x), _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8));
+    }
+}
+
+PPU_TARGET_AVX2 static void
+ppu_luma_row_avx2(uint8_t *out, const uint16_t *in) {
+    __m256i lo, hi, luma;
+    int x;
+
+    for (x = 0; x < 256; x += 16) {
+        lo = _mm256_i32gather_epi32((const int *)nes_luma_emphasis, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in + x))), 4);
+        hi = _mm256_i32gather_epi32((const int *)nes_luma_emphasis, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in + x + 8))), 4);
+        luma = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+        _mm_storeu_si128((__m128i *)(out + x), _mm_packus_epi16(_mm256_castsi256_si128(luma), _mm256_extracti128_si256(luma, 1)));
+    }
+}
+#endif
+
 void
 ppu_init() {
     memset(&ppu, 0, sizeof(ppu));
+    ppu_set_mirroring(PPU_MIRRORING_NONE);
+    ppu.video = true;
+    ppu.video_next = true;
+    ppu_set_change_detection(false);
+
+    ppu_converters.row32 = ppu_convert_row32;
+    ppu_converters.row16 = ppu_convert_row16;
+    ppu_converters.luma = ppu_luma_row;
+#if defined(PPU_AVX2)
+    if (SDL_HasAVX2()) {
+        ppu_converters.row32 = ppu_convert_row32_avx2;
+        ppu_converters.row16 = ppu_convert_row16_avx2;
+        ppu_converters.luma = ppu_luma_row_avx2;
+    }
+#endif
+
+    ppu_build_action_table();
+    ppu_build_emphasis_table();
+    ppu_update_palette();
+    ppu_invalidate_all();
 }
 
 void
 ppu_free() {
+    ppu_set_change_detection(false);
 }
 
 void
 ppu_reset() {
+    uint8_t *chr[8];
+    ppu_output_t output;
+    ppu_mirroring_t mirroring;
+    bool video;
+
+    //the cartridge's CHR banks and mirroring and the host's video and output settings survive a reset
+    memcpy(chr, ppu.pages, sizeof(chr));
+    output = ppu.output;
+    mirroring = ppu.mirroring;
+    video = ppu.video_next;
+
     memset(&ppu, 0, sizeof(ppu));
 
+    memcpy(ppu.pages, chr, sizeof(chr));
+    ppu.output = output;
+    ppu_set_mirroring(mirroring);
+    ppu.video = video;
+    ppu.video_next = video;
+    ppu.mode = video ? PPU_MODE_FULL : PPU_MODE_TIMING;
+
     memset(ppu.ci, 0xFF, sizeof(ppu.ci));
+
+    ppu_update_palette();
+    ppu_invalidate_all();
 }
 
 void
-ppu_set_texture(SDL_Texture *texture) {
-    ppu.texture = texture;
+ppu_set_framebuffer(int index, void *framebuffer, int pitch) {
+    ppu.output.framebuffers[index] = framebuffer;
+    ppu.output.pitches[index] = pitch;
 }
 
 void
-ppu_set_mirroring(ppu_mirroring_t mirroring) {
-    ppu.mirroring = mirroring;
+ppu_set_frame_ready(ppu_frame_ready_t callback, void *data) {
+    ppu.output.frame_ready = callback;
+    ppu.output.frame_ready_data = data;
+}
+
+void
+ppu_set_video(bool enabled) {
+    ppu.video_next = enabled;
+}
+
+void
+ppu_set_format(ppu_format_t format) {
+    ppu.output.format = format;
+    ppu.output.previous_valid = false;
 }
 
-static uint16_t
-ppu_nametable_mirroring_address(uint16_t address) {
-    switch (ppu.mirroring) {
-        case PPU_MIRRORING_VERTICAL:
-            return address & 0x800;
-        case PPU_MIRRORING_HORIZONTAL:
-            return ((address  / 2) & 0x400) + (address % 0x400);
-        case PPU_MIRRORING_NONE:
-            return address - 0x2000;
+bool
+ppu_set_observation(const ppu_observation_t *observation) {
+    ppu_output_t *output = &ppu.output;
+    int i;
+
+    if (observation == NULL || observation->ring == NULL) {
+        memset(&output->observation, 0, sizeof(output->observation));
+        return true;
     }
 
-    return 0;
+    if (observation->width < 1 || observation->width > 256 || observation->height < 1 || observation->height > PPU_VISIBLE_SCANLINES) {
+        log_err(MODULE, "Invalid observation size %dx%d", observation->width, observation->height);
+        return false;
+    }
+    if (observation->frames < 1) {
+        log_err(MODULE, "Invalid observation ring size %d", observation->frames);
+        return false;
+    }
+
+    output->observation = *observation;
+    output->observations = 0;
+
+    //averaging palette indices is meaningless, they're always sampled
+    if (observation->format == PPU_OBSERVATION_INDEXED) {
+        output->observation.filter = PPU_FILTER_NEAREST;
+    }
+
+    for (i = 0; i < observation->width; i++) {
+        if (output->observation.filter == PPU_FILTER_BOX) {
+            output->observation_x[i] = i * 256 / observation->width;
+            output->observation_x_end[i] = (i + 1) * 256 / observation->width;
+        }
+        else {
+            output->observation_x[i] = (i * 2 + 1) * 256 / (observation->width * 2);
+        }
+    }
+    for (i = 0; i < observation->height; i++) {
+        if (output->observation.filter == PPU_FILTER_BOX) {
+            output->observation_y[i] = i * PPU_VISIBLE_SCANLINES / observation->height;
+            output->observation_y_end[i] = (i + 1) * PPU_VISIBLE_SCANLINES / observation->height;
+        }
+        else {
+            output->observation_y[i] = (i * 2 + 1) * PPU_VISIBLE_SCANLINES / (observation->height * 2);
+        }
+    }
+
+    return true;
+}
+
+unsigned int
+ppu_get_observations() {
+    return ppu.output.observations;
+}
+
+bool
+ppu_set_change_detection(bool enabled) {
+    ppu_output_t *output = &ppu.output;
+
+    if (!enabled) {
+        free(output->previous);
+        output->previous = NULL;
+        output->changed = true;
+        memset(output->dirty_rows, 0xFF, sizeof(output->dirty_rows));
+        return true;
+    }
+
+    if (output->previous == NULL) {
+        output->previous = malloc(256 * PPU_VISIBLE_SCANLINES * sizeof(uint16_t));
+        if (output->previous == NULL) {
+            log_err(MODULE, "Out of memory");
+            return false;
+        }
+    }
+
+    output->previous_valid = false;
+    memset(&output->changes, 0, sizeof(output->changes));
+
+    return true;
+}
+
+const uint32_t *
+ppu_get_dirty_rows() {
+    return ppu.output.dirty_rows;
 }
 
-static uint16_t
-ppu_nametable_address() {
-    return 0x2000 | (ppu.v_address.r & 0xFFF);
+void
+ppu_get_change_stats(ppu_change_stats_t *stats) {
+    *stats = ppu.output.changes;
 }
 
-static uint16_t
-at_address() {
-    return 0x23C0 | (ppu.v_address.nametable << 10) | ((ppu.v_address.coarse_y / 4) << 3) | (ppu.v_address.coarse_x / 4);
+void
+ppu_get_debug(ppu_debug_t *debug) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        if (ppu.pages[i] != NULL) {
+            memcpy(debug->chr + i * 0x400, ppu.pages[i], 0x400);
+        }
+        else {
+            memset(debug->chr + i * 0x400, 0, 0x400);
+        }
+    }
+    for (i = 0; i < 4; i++) {
+        memcpy(debug->nametables[i], ppu.pages[8 + i], 0x400);
+    }
 
+    memcpy(debug->palette, ppu.cg, sizeof(debug->palette));
+    for (i = 0; i < 0x20; i++) {
+        debug->colors[i] = nes_rgb_emphasis[ppu.palette[i]];
+    }
+    memcpy(debug->oam, ppu.oam, sizeof(debug->oam));
+
+    //what the next frame will start from, the games have set it up by now
+    debug->scroll_x = (ppu.t_address.nametable & 0x01) * 256 + ppu.t_address.coarse_x * 8 + ppu.fine_x;
+    debug->scroll_y = (ppu.t_address.nametable >> 1) * 240 + ppu.t_address.coarse_y * 8 + ppu.t_address.fine_y;
+    debug->background_table = ppu.control.background_pattern_table;
+    debug->sprite_table = ppu.control.sprite_pattern_table;
+    debug->sprites_8x16 = ppu.control.sprite_size;
 }
-static uint16_t
-bg_address() {
-    return (ppu.control.background_pattern_table * 0x1000) + (ppu.latch_nametable * 16) + ppu.v_address.fine_y;
+
+void
+ppu_set_chr_page(int page, uint8_t *data) {
+    if (ppu.pages[page] != data && page / 4 == ppu.control.background_pattern_table) {
+        ppu_invalidate_patterns((page % 4) * 64, 64);
+    }
+
+    ppu.pages[page] = data;
+}
+
+void
+ppu_set_invalidation_log(bool enabled) {
+    ppu.invalidation_log_enabled = enabled;
+    ppu.invalidation_log_count = 0;
+    ppu.invalidations_dropped = 0;
+}
+
+int
+ppu_read_invalidation_log(ppu_invalidation_t *entries, int max, unsigned int *dropped) {
+    int count;
+
+    count = ppu.invalidation_log_count < max ? ppu.invalidation_log_count : max;
+    memcpy(entries, ppu.invalidation_log, count * sizeof(ppu_invalidation_t));
+
+    if (dropped != NULL) {
+        *dropped = ppu.invalidations_dropped + (ppu.invalidation_log_count - count);
+    }
+
+    ppu.invalidation_log_count = 0;
+    ppu.invalidations_dropped = 0;
+
+    return count;
+}
+
+void
+ppu_set_mirroring(ppu_mirroring_t mirroring) {
+    static const uint16_t layouts[][4] = {
+        [PPU_MIRRORING_NONE]       = {0x000, 0x400, 0x800, 0xC00},
+        [PPU_MIRRORING_VERTICAL]   = {0x000, 0x400, 0x000, 0x400},
+        [PPU_MIRRORING_HORIZONTAL] = {0x000, 0x000, 0x400, 0x400}
+    };
+    int i;
+
+    ppu.mirroring = mirroring;
+
+    //$3000-$3EFF mirrors $2000-$2EFF
+    for (i = 0; i < 4; i++) {
+        ppu.pages[8 + i] = ppu.ci + layouts[mirroring][i];
+        ppu.pages[12 + i] = ppu.ci + layouts[mirroring][i];
+    }
+
+    ppu_invalidate_all();
 }
 
 static uint8_t
 ppu_read(uint16_t address) {
-    if (address >= 0x0000 && address <= 0x1FFF) {
-        return cartridge_read_chr(address);
-    }
-    else if (address >= 0x2000 && address <= 0x3EFF) {
-        return ppu.ci[ppu_nametable_mirroring_address(address)];
+    if (address <= 0x3EFF) {
+        return ppu_fetch(address);
     }
     else if (address >= 0x3F00 && address <= 0x3FFF) {
         if ((address & 0x13) == 0x10) {
@@ -208,9 +890,16 @@ static void
 ppu_write(uint16_t address, uint8_t value) {
     if (address >= 0x0000 && address <= 0x1FFF) {
         cartridge_write_chr(address, value);
+
+        if (address / 0x1000 == ppu.control.background_pattern_table) {
+            ppu_invalidate_patterns((address & 0xFFF) / 16, 1);
+        }
     }
     else if (address >= 0x2000 && address <= 0x3EFF) {
-        ppu.ci[ppu_nametable_mirroring_address(address)] = value;
+        if (ppu_fetch(address) != value) {
+            ppu_fetch(address) = value;
+            ppu_invalidate_nametable_byte(address);
+        }
     }
     else if (address >= 0x3F00 && address <= 0x3FFF) {
         if ((address & 0x13) == 0x10) {
@@ -218,12 +907,91 @@ ppu_write(uint16_t address, uint8_t value) {
         }
 
         ppu.cg[address & 0x1F] = value;
+        ppu_update_palette_entry(address & 0x1F);
     }
     else {
         log_err(MODULE, "Attempt to write at invalid address 0x%04X", address);
     }
 }
 
+//adds or removes sprite n from every scanline it covers in the sprite index
+static void
+ppu_sprite_index_update(int n, uint8_t y, bool add) {
+    int line, end;
+    uint64_t bit;
+
+    bit = (uint64_t)1 << n;
+    end = y + ppu.sprite_index_height;
+    if (end > PPU_VISIBLE_SCANLINES) {
+        end = PPU_VISIBLE_SCANLINES;
+    }
+
+    for (line = y; line < end; line++) {
+        if (add) {
+            ppu.sprite_index[line] |= bit;
+        }
+        else {
+            ppu.sprite_index[line] &= ~bit;
+        }
+    }
+}
+
+static void
+ppu_sprite_index_rebuild() {
+    int i;
+#if defined(PPU_SSE2)
+    uint8_t y[64];
+    __m128i ys[4], above[4], height, line_v, diff;
+    int line;
+    uint64_t mask;
+#endif
+
+    ppu.sprite_index_height = ppu_sprite_height();
+
+#if defined(PPU_SSE2)
+    for (i = 0; i < 64; i++) {
+        y[i] = ppu.oam[i * 4];
+    }
+    for (i = 0; i < 4; i++) {
+        ys[i] = _mm_loadu_si128((const __m128i *)(y + i * 16));
+    }
+
+    height = _mm_set1_epi8(ppu.sprite_index_height - 1);
+
+    //a sprite is on the line if y <= line and line - y < height, 16 sprites at a time
+    for (line = 0; line < PPU_VISIBLE_SCANLINES; line++) {
+        line_v = _mm_set1_epi8((char)line);
+        mask = 0;
+
+        for (i = 0; i < 4; i++) {
+            above[i] = _mm_cmpeq_epi8(_mm_min_epu8(ys[i], line_v), ys[i]);
+            diff = _mm_sub_epi8(line_v, ys[i]);
+            above[i] = _mm_and_si128(above[i], _mm_cmpeq_epi8(_mm_min_epu8(diff, height), diff));
+            mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(above[i]) << (i * 16);
+        }
+
+        ppu.sprite_index[line] = mask;
+    }
+#else
+    memset(ppu.sprite_index, 0, sizeof(ppu.sprite_index));
+
+    for (i = 0; i < 64; i++) {
+        ppu_sprite_index_update(i, ppu.oam[i * 4], true);
+    }
+#endif
+}
+
+static void
+ppu_write_oam(uint8_t value) {
+    //only a sprite's Y byte moves it between scanlines
+    if ((ppu.oam_address & 3) == 0 && ppu.sprite_index_height != 0 && ppu.oam[ppu.oam_address] != value) {
+        ppu_sprite_index_update(ppu.oam_address / 4, ppu.oam[ppu.oam_address], false);
+        ppu_sprite_index_update(ppu.oam_address / 4, value, true);
+    }
+
+    ppu.oam[ppu.oam_address++] = value;
+}
+
 static uint8_t res = 0;
 static uint8_t buffer = 0;
 static bool latch = false;
@@ -263,17 +1031,33 @@ ppu_write_register(uint16_t index, uint8_t value) {
 
     switch (index) {
         case 0:
+            if ((ppu.control.value ^ value) & 0x10) {
+                //the background switched pattern tables
+                ppu_invalidate_all();
+            }
+
             ppu.control.value = value;
             ppu.t_address.nametable = ppu.control.nt;
+
+            if (ppu.sprite_index_height != ppu_sprite_height()) {
+                ppu.sprite_index_height = 0;
+            }
             break;
         case 1:
-            ppu.mask.value = value;
+            //only the grayscale and emphasis bits change the resolved palette
+            if ((ppu.mask.value ^ value) & 0xE1) {
+                ppu.mask.value = value;
+                ppu_update_palette();
+            }
+            else {
+                ppu.mask.value = value;
+            }
             break;
         case 3:
             ppu.oam_address = value;
             break;
         case 4:
-            ppu.oam[ppu.oam_address++] = value;
+            ppu_write_oam(value);
             break;
         case 5:
             if (!latch) {
@@ -307,6 +1091,23 @@ ppu_write_register(uint16_t index, uint8_t value) {
     }
 }
 
+void
+ppu_write_oam_dma(const uint8_t *data) {
+    int i;
+
+    res = data[0xFF];
+
+    if (ppu.oam_address == 0) {
+        memcpy(ppu.oam, data, sizeof(ppu.oam));
+        ppu.sprite_index_height = 0;
+        return;
+    }
+
+    for (i = 0; i < 0x100; i++) {
+        ppu_write_oam(data[i]);
+    }
+}
+
 static void
 ppu_clear_oam2() {
     int i;
@@ -322,14 +1123,6 @@ ppu_clear_oam2() {
     }
 }
 
-static void
-ppu_reload_shift() {
-    ppu.bg_shift_low = (ppu.bg_shift_low & 0xFF00) | ppu.latch_background_low;
-    ppu.bg_shift_high = (ppu.bg_shift_high & 0xFF00) | ppu.latch_background_high;
-
-    ppu.at_latch_low = (ppu.latch_at & 1);
-    ppu.at_shift_high = (ppu.latch_at & 2);
-}
 static void
 ppu_horizontal_scroll() {
     if (!ppu_rendering()) {
@@ -388,28 +1181,33 @@ ppu_vertical_scroll_update() {
 
 static void
 ppu_evaluate_sprites() {
-    int i, line, count = 0;
+    int i, count = 0;
+    uint64_t sprites;
 
-    for (i = 0; i < 64; i++) {
-        line = ppu.scanline;
+    //the pre-render line is line -1, no sprite can start above it
+    if (ppu.scanline >= PPU_VISIBLE_SCANLINES) {
+        return;
+    }
 
-        if (line == 261) {
-            line = -1;
-        }
+    if (ppu.sprite_index_height == 0) {
+        ppu_sprite_index_rebuild();
+    }
 
-        line -= ppu.oam[i * 4];
+    sprites = ppu.sprite_index[ppu.scanline];
 
-        if (line >= 0 && line < ppu_sprite_height()) {
-            ppu.sprites2[count].id    = i;
-            ppu.sprites2[count].y     = ppu.oam[i * 4 + 0];
-            ppu.sprites2[count].title = ppu.oam[i * 4 + 1];
-            ppu.sprites2[count].attr  = ppu.oam[i * 4 + 2];
-            ppu.sprites2[count].x     = ppu.oam[i * 4 + 3];
+    while (sprites != 0) {
+        i = ppu_lowest_bit(sprites);
+        sprites &= sprites - 1;
 
-            if (++count >= PPU_SPRITES) {
-                ppu.status.sprite_overflow = 1;
-                break;
-            }
+        ppu.sprites2[count].id    = i;
+        ppu.sprites2[count].y     = ppu.oam[i * 4 + 0];
+        ppu.sprites2[count].title = ppu.oam[i * 4 + 1];
+        ppu.sprites2[count].attr  = ppu.oam[i * 4 + 2];
+        ppu.sprites2[count].x     = ppu.oam[i * 4 + 3];
+
+        if (++count >= PPU_SPRITES) {
+            ppu.status.sprite_overflow = 1;
+            break;
         }
     }
 }
@@ -438,8 +1236,8 @@ ppu_load_sprites() {
 
         address += sprite_y + (sprite_y & 8);
 
-        ppu.sprites[i].data_low = ppu_read(address);
-        ppu.sprites[i].data_high = ppu_read(address + 8);
+        ppu.sprites[i].data_low = ppu_fetch(address);
+        ppu.sprites[i].data_high = ppu_fetch(address + 8);
     }
 }
 
@@ -447,22 +1245,19 @@ static void
 ppu_process_pixel() {
     uint8_t palette = 0, obj_palette = 0, sprite_palette;
     int i, x;
-    bool obj_priority;
+    bool obj_priority = false;
     unsigned int sprite_x;
 
     x = ppu.dot - 2;
 
     if (ppu.scanline < 240 && x >= 0 && x < 256) {
         if (ppu.mask.show_background && !(!ppu.mask.show_background_left && x < 8)) {
-            palette = (NTH_BIT(ppu.bg_shift_high, 15 - ppu.fine_x) << 1) | NTH_BIT(ppu.bg_shift_low, 15 - ppu.fine_x);
-
-            if (palette > 0) {
-                palette |= ((NTH_BIT(ppu.at_shift_high, 7 - ppu.fine_x) << 1) | NTH_BIT(ppu.at_shift_low, 7 - ppu.fine_x)) << 2;
-            }
+            palette = ppu.line_background[x];
         }
 
         if (ppu.mask.show_sprites && !(!ppu.mask.show_sprites_left && x < 8)) {
-            for (i = 7; i >= 0; i--) {
+            //without video only sprite 0 matters, and it's always the first sprite when it's on the line
+            for (i = ppu.video ? 7 : 0; i >= 0; i--) {
                 if (ppu.sprites[i].id == 64) {
                     //void entry
                     continue;
@@ -501,155 +1296,335 @@ ppu_process_pixel() {
             palette = obj_palette;
         }
 
-        ppu.pixels[ppu.scanline * 256 + x] = nes_rgb[ppu_read(0x3F00 + (ppu_rendering() ? palette : 0))];
+        if (ppu.video) {
+            ppu.line[x] = ppu.palette[ppu_rendering() ? palette : 0];
+        }
+    }
+}
+
+//converts the whole frame in one pass so the per-pixel work during rendering stays a 16 bit store
+static void
+ppu_convert_frame(void *out, int pitch) {
+    uint8_t *row;
+    int y;
+
+    for (y = 0; y < PPU_VISIBLE_SCANLINES; y++) {
+        row = (uint8_t *)out + y * pitch;
+
+        switch (ppu.output.format) {
+            case PPU_FORMAT_ARGB8888:
+                ppu_converters.row32((uint32_t *)row, ppu.pixels + y * 256, nes_rgb_emphasis);
+                break;
+            case PPU_FORMAT_RGB565:
+                ppu_converters.row16((uint16_t *)row, ppu.pixels + y * 256, nes_rgb565_emphasis);
+                break;
+            default:
+                //rendered straight into the framebuffer
+                break;
+        }
+    }
+}
+
+const uint16_t *
+ppu_get_indices(int index, int *pitch) {
+    if (ppu.output.format == PPU_FORMAT_INDEXED && ppu.output.framebuffers[index] != NULL) {
+        *pitch = ppu.output.pitches[index];
+        return ppu.output.framebuffers[index];
     }
 
-    ppu.bg_shift_low <<= 1;
-    ppu.bg_shift_high <<= 1;
+    *pitch = 256 * sizeof(uint16_t);
+    return ppu.pixels;
+}
+
+void
+ppu_convert_indices(uint32_t *out, const uint16_t *in) {
+    ppu_converters.row32(out, in, nes_rgb_emphasis);
+}
 
-    ppu.at_shift_low = (ppu.at_shift_low << 1) | ppu.at_latch_low;
-    ppu.at_shift_high = (ppu.at_shift_high << 1) | ppu.at_latch_high;
+//row y of the frame that was just rendered
+static const uint16_t *
+ppu_frame_row(int y) {
+    void *framebuffer;
+
+    framebuffer = ppu.output.framebuffers[ppu.output.framebuffer];
+    if (ppu.output.format == PPU_FORMAT_INDEXED && framebuffer != NULL) {
+        return (const uint16_t *)((const uint8_t *)framebuffer + y * ppu.output.pitches[ppu.output.framebuffer]);
+    }
+
+    return ppu.pixels + y * 256;
 }
 
+//a full width row of luminance or palette indices
 static void
-ppu_cycle_execute(ppu_scanline_type_t type) {
-    static uint16_t address = 0;
-    int ret;
+ppu_observation_row(uint8_t *out, const uint16_t *in) {
+    int x;
 
-    switch (type) {
-        case PPU_SCANLINE_TYPE_VBLANK:
-            if (ppu.dot == 1) {
-                ppu.status.vblank = 1;
-                if (ppu.control.nmi) {
-                    cpu_set_nmi();
-                }
-            }
-            break;
-        case PPU_SCANLINE_TYPE_POST:
-            if (ppu.dot == 0) {
-                ret = SDL_UpdateTexture(ppu.texture, NULL, ppu.pixels, 256 * sizeof(uint32_t));
-                if (ret == -1) {
-                    log_err(MODULE, "Error updating texture: %s", SDL_GetError());
-                }
-            }
-            break;
-        case PPU_SCANLINE_TYPE_PRE:
-        case PPU_SCANLINE_TYPE_VISIBLE:
-            //sprites
-            if (ppu.dot == 1) {
-               ppu_clear_oam2();
-
-                if (type == PPU_SCANLINE_TYPE_PRE) {
-                    ppu.status.sprite_overflow = 0; 
-                    ppu.status.sprite0_hit = 0;
-                }
-            }
-            else if (ppu.dot == 257) {
-                ppu_evaluate_sprites();
-            }
-            else if (ppu.dot == 321) {
-                ppu_load_sprites();
-            }
+    if (ppu.output.observation.format == PPU_OBSERVATION_INDEXED) {
+#if defined(PPU_SSE2)
+        __m128i mask = _mm_set1_epi16(0x3F);
 
-            //background
-            if (ppu.dot == 1) {
-                address = ppu_nametable_address();
-                if (type == PPU_SCANLINE_TYPE_PRE) {
-                    ppu.status.vblank = 0;
-                }
-            }
-            else if ((ppu.dot >= 2 && ppu.dot <= 255) || (ppu.dot >= 322 && ppu.dot <= 337)) {
-                ppu_process_pixel();
-
-                //nametable
-                switch (ppu.dot % 8) {
-                    case 1:
-                        address = ppu_nametable_address();
-                        ppu_reload_shift();
-                        break;
-                    case 2:
-                        ppu.latch_nametable = ppu_read(address);
-                        break;
-                    case 3:
-                        address = at_address();
-                        break;
-                    case 4:
-                        ppu.latch_at = ppu_read(address);
-                        if (ppu.v_address.coarse_y & 2) {
-                            ppu.latch_at >>= 4;
-                        }
-                        if (ppu.v_address.coarse_x & 2) {
-                            ppu.latch_at >>= 2;
-                        }
-                        break;
-                    case 5:
-                        address = bg_address();
-                        break;
-                    case 6:
-                        ppu.latch_background_low = ppu_read(address);
-                        break;
-                    case 7:
-                        address += 8;
-                        break;
-                    case 0:
-                        ppu.latch_background_high = ppu_read(address);
-                        ppu_horizontal_scroll();
-                        break;
+        for (x = 0; x < 256; x += 16) {
+            _mm_storeu_si128((__m128i *)(out + x), _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i *)(in + x)), mask),
+                                                                   _mm_and_si128(_mm_loadu_si128((const __m128i *)(in + x + 8)), mask)));
+        }
+#else
+        for (x = 0; x < 256; x++) {
+            out[x] = in[x] & 0x3F;
+        }
+#endif
+    }
+    else {
+        ppu_converters.luma(out, in);
+    }
+}
 
-                }
-            }
-            else if (ppu.dot == 256) {
-                ppu_process_pixel();
-                ppu.latch_background_high = ppu_read(address);
-                ppu_vertical_scroll();
-            }
-            else if (ppu.dot == 257) {
-                ppu_process_pixel();
-                ppu_reload_shift();
-                ppu_horizontal_scroll_update();
+static void
+ppu_observation_accumulate(uint16_t *sums, const uint8_t *row) {
+    int x;
+
+#if defined(PPU_SSE2)
+    __m128i zero, bytes;
+
+    zero = _mm_setzero_si128();
+    for (x = 0; x < 256; x += 16) {
+        bytes = _mm_loadu_si128((const __m128i *)(row + x));
+        _mm_storeu_si128((__m128i *)(sums + x), _mm_add_epi16(_mm_loadu_si128((const __m128i *)(sums + x)), _mm_unpacklo_epi8(bytes, zero)));
+        _mm_storeu_si128((__m128i *)(sums + x + 8), _mm_add_epi16(_mm_loadu_si128((const __m128i *)(sums + x + 8)), _mm_unpackhi_epi8(bytes, zero)));
+    }
+#else
+    for (x = 0; x < 256; x++) {
+        sums[x] += row[x];
+    }
+#endif
+}
+
+static void
+ppu_observe() {
+    ppu_output_t *output = &ppu.output;
+    ppu_observation_t *observation = &output->observation;
+    uint8_t row[256], *out;
+    uint16_t sums[256];
+    unsigned int sum;
+    int x, y, i, area, size;
+
+    size = observation->width * observation->height;
+    out = observation->ring + (output->observations % observation->frames) * size;
+
+    //same frame, same observation
+    if (!output->changed && output->observations > 0) {
+        memcpy(out, observation->ring + ((output->observations - 1) % observation->frames) * size, size);
+        output->observations++;
+        return;
+    }
+
+    for (y = 0; y < observation->height; y++, out += observation->width) {
+        if (observation->filter == PPU_FILTER_BOX) {
+            memset(sums, 0, sizeof(sums));
+            for (i = output->observation_y[y]; i < output->observation_y_end[y]; i++) {
+                ppu_observation_row(row, ppu_frame_row(i));
+                ppu_observation_accumulate(sums, row);
             }
-            else if (ppu.dot >= 280 && ppu.dot <= 304) {
-                if (type == PPU_SCANLINE_TYPE_PRE) {
-                    ppu_vertical_scroll_update();
+
+            for (x = 0; x < observation->width; x++) {
+                sum = 0;
+                for (i = output->observation_x[x]; i < output->observation_x_end[x]; i++) {
+                    sum += sums[i];
                 }
+
+                area = (output->observation_x_end[x] - output->observation_x[x]) * (output->observation_y_end[y] - output->observation_y[y]);
+                out[x] = sum / area;
             }
-            else if (ppu.dot == 321 || ppu.dot == 339) {
-                address = ppu_nametable_address();
-            }
-            else if (ppu.dot == 338) {
-                ppu.latch_nametable = ppu_read(address);
-            }
-            else if (ppu.dot == 340) {
-                ppu.latch_nametable = ppu_read(address);
-                if (type == PPU_SCANLINE_TYPE_PRE && ppu_rendering() && ppu.odd_frame) {
-                    ++ppu.dot;
-                }
+        }
+        else {
+            ppu_observation_row(row, ppu_frame_row(output->observation_y[y]));
+            for (x = 0; x < observation->width; x++) {
+                out[x] = row[output->observation_x[x]];
             }
+        }
+    }
 
-            if (ppu.dot == 260 && ppu_rendering()) {
-                cartridge_signal_scanline();
-            }
+    output->observations++;
+}
 
-            break;
+static bool
+ppu_row_changed(const uint16_t *row, const uint16_t *previous) {
+#if defined(PPU_SSE2)
+    __m128i diff;
+    int x;
+
+    diff = _mm_setzero_si128();
+    for (x = 0; x < 256; x += 8) {
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(row + x)), _mm_loadu_si128((const __m128i *)(previous + x))));
     }
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF;
+#else
+    return memcmp(row, previous, 256 * sizeof(uint16_t)) != 0;
+#endif
 }
 
-void
-ppu_cycle() {
-    if (ppu.scanline >= 0 && ppu.scanline <= 239) {
-        ppu_cycle_execute(PPU_SCANLINE_TYPE_VISIBLE);
+//compares the frame that was just rendered with the last one row by row, and keeps the rows that changed for next time
+static bool
+ppu_detect_changes() {
+    ppu_output_t *output = &ppu.output;
+    const uint16_t *row;
+    uint16_t *previous;
+    bool changed;
+    int y;
+
+    memset(output->dirty_rows, 0, sizeof(output->dirty_rows));
+    changed = false;
+
+    for (y = 0; y < PPU_VISIBLE_SCANLINES; y++) {
+        row = ppu_frame_row(y);
+        previous = output->previous + y * 256;
+
+        if (output->previous_valid && !ppu_row_changed(row, previous)) {
+            output->changes.unchanged_rows++;
+            continue;
+        }
+
+        memcpy(previous, row, 256 * sizeof(uint16_t));
+        output->dirty_rows[y / 32] |= 1u << (y % 32);
+        changed = true;
+    }
+
+    output->previous_valid = true;
+    output->changes.frames++;
+    output->changes.rows += PPU_VISIBLE_SCANLINES;
+    if (!changed) {
+        output->changes.unchanged_frames++;
+    }
+
+    return changed;
+}
+
+static void
+ppu_frame_end() {
+    void *framebuffer;
+    int index;
+
+    index = ppu.output.framebuffer;
+    framebuffer = ppu.output.framebuffers[index];
+
+    //without video there's no picture, and without a framebuffer or observation nowhere to put it. the host still
+    //learns the frame is over
+    if (!ppu.video || (ppu.output.observation.ring == NULL && framebuffer == NULL)) {
+        if (ppu.output.frame_ready != NULL) {
+            ppu.output.frame_ready(index, NULL, ppu.output.frame_ready_data);
+        }
+        return;
+    }
+
+    ppu.output.changed = ppu.output.previous == NULL || ppu_detect_changes();
+
+    if (ppu.output.observation.ring != NULL) {
+        ppu_observe();
+    }
+
+    //nothing to convert or swap, the host still has this frame
+    if (!ppu.output.changed) {
+        if (ppu.output.frame_ready != NULL) {
+            ppu.output.frame_ready(index, NULL, ppu.output.frame_ready_data);
+        }
+        return;
+    }
+
+    //without a framebuffer only the observation is produced
+    if (framebuffer != NULL) {
+        ppu_convert_frame(framebuffer, ppu.output.pitches[index]);
+    }
+
+    //the next frame goes to the other framebuffer so the host can present this one while we render
+    if (ppu.output.framebuffers[index ^ 1] != NULL) {
+        ppu.output.framebuffer = index ^ 1;
+    }
+
+    if (ppu.output.frame_ready != NULL) {
+        ppu.output.frame_ready(index, framebuffer, ppu.output.frame_ready_data);
+    }
+}
+
+static void
+ppu_scanline_start() {
+    ppu.line = (uint16_t *)ppu_frame_row(ppu.scanline);
+}
+
+static void
+ppu_cycle_execute(uint32_t actions) {
+    if (actions & PPU_ACTION_VBLANK_SET) {
+        ppu.status.vblank = 1;
+        if (ppu.control.nmi) {
+            cpu_set_nmi();
+        }
+    }
+
+    if (actions & PPU_ACTION_FRAME_END) {
+        ppu_frame_end();
+    }
+
+    //sprites
+    if (actions & PPU_ACTION_CLEAR_OAM2) {
+        ppu_clear_oam2();
+    }
+    if (actions & PPU_ACTION_CLEAR_FLAGS) {
+        ppu.status.sprite_overflow = 0;
+        ppu.status.sprite0_hit = 0;
+        ppu.status.vblank = 0;
+
+        ppu.video = ppu.video_next;
+        ppu.mode = ppu.video ? PPU_MODE_FULL : PPU_MODE_TIMING;
     }
-    else if (ppu.scanline == 240) {
-        ppu_cycle_execute(PPU_SCANLINE_TYPE_POST);
+    if (actions & PPU_ACTION_EVALUATE_SPRITES) {
+        ppu_evaluate_sprites();
+
+        //without video, the background is only drawn for lines where sprite 0 can hit it
+        if (!ppu.video) {
+            ppu.mode = ppu.sprites2[0].id == 0 ? PPU_MODE_FULL : PPU_MODE_TIMING;
+        }
+    }
+    if (actions & PPU_ACTION_LOAD_SPRITES) {
+        ppu_load_sprites();
+    }
+
+    //background
+    if (actions & PPU_ACTION_BACKGROUND_LINE) {
+        ppu_scanline_start();
+        ppu_background_line();
+    }
+    if (actions & PPU_ACTION_PIXEL) {
+        ppu_process_pixel();
+    }
+    if (actions & PPU_ACTION_HSCROLL) {
+        ppu_horizontal_scroll();
     }
-    else if (ppu.scanline == 241) {
-        ppu_cycle_execute(PPU_SCANLINE_TYPE_VBLANK);
+    if (actions & PPU_ACTION_VSCROLL) {
+        ppu_vertical_scroll();
     }
-    else if (ppu.scanline == 261) {
-        ppu_cycle_execute(PPU_SCANLINE_TYPE_PRE);
+    if (actions & PPU_ACTION_HSCROLL_UPDATE) {
+        ppu_horizontal_scroll_update();
     }
+    if (actions & PPU_ACTION_VSCROLL_UPDATE) {
+        ppu_vertical_scroll_update();
+    }
+    if (actions & PPU_ACTION_ODD_FRAME_SKIP) {
+        if (ppu_rendering() && ppu.odd_frame) {
+            ++ppu.dot;
+        }
+    }
+
+    if (actions & PPU_ACTION_SCANLINE_SIGNAL) {
+        if (ppu_rendering()) {
+            cartridge_signal_scanline();
+        }
+    }
+}
 
-    if (++ppu.dot > 340) {
+static void
+ppu_advance(int dots) {
+    ppu.dot += dots;
+
+    if (ppu.dot > 340) {
         ppu.dot %= 341;
 
         if (++ppu.scanline > 261) {
@@ -657,4 +1632,36 @@ ppu_cycle() {
             ppu.odd_frame = !ppu.odd_frame;
         }
     }
+}
+
+void
+ppu_cycle() {
+    ppu_run(1);
+}
+
+void
+ppu_run(int dots) {
+    uint32_t actions;
+    int type, idle;
+
+    while (dots > 0) {
+        type = ppu_scanline_types[ppu.scanline];
+        actions = ppu_actions[ppu.mode][type][ppu.dot];
+
+        if (actions == 0) {
+            //nothing happens until the next dot with work, jump straight to it
+            idle = ppu_idle_dots[ppu.mode][type][ppu.dot];
+            if (idle > dots) {
+                idle = dots;
+            }
+
+            ppu_advance(idle);
+            dots -= idle;
+        }
+        else {
+            ppu_cycle_execute(actions);
+            ppu_advance(1);
+            --dots;
+        }
+    }
 }
\ No newline at end of file
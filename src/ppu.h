@@ -1,7 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
-#include <SDL2/SDL.h>
 
 typedef enum {
     PPU_MIRRORING_NONE,
@@ -9,15 +9,115 @@ typedef enum {
     PPU_MIRRORING_HORIZONTAL
 } ppu_mirroring_t;
 
+typedef enum {
+    PPU_FORMAT_ARGB8888,                    //32 bits per pixel
+    PPU_FORMAT_RGB565,                      //16 bits per pixel
+    PPU_FORMAT_INDEXED                      //16 bits per pixel, (emphasis << 6) | color, bit 6 is the red emphasis
+} ppu_format_t;
+
+typedef enum {
+    PPU_OBSERVATION_LUMA,                   //8 bit luminance
+    PPU_OBSERVATION_INDEXED                 //8 bit palette color without emphasis, always sampled with PPU_FILTER_NEAREST
+} ppu_observation_format_t;
+
+typedef enum {
+    PPU_FILTER_NEAREST,
+    PPU_FILTER_BOX                          //average of every source pixel an observation pixel covers
+} ppu_filter_t;
+
+//a downscaled copy of every frame, e.g. 84x84 or 128x120, written one after another into a host owned ring of
+//frames * width * height bytes so the last frames can be stacked without copying
+typedef struct {
+    int width;                              //1-256
+    int height;                             //1-240
+    ppu_observation_format_t format;
+    ppu_filter_t filter;
+    uint8_t *ring;
+    int frames;
+} ppu_observation_t;
+
+//called at the end of every rendered frame with the framebuffer that was just completed, the next frame goes to the
+//other one so it stays untouched until the frame after. framebuffer is NULL without video, if there's no framebuffer,
+//if only an observation is produced or, with change detection, if the frame didn't change
+typedef void (*ppu_frame_ready_t)(int index, void *framebuffer, void *data);
+
+typedef struct {
+    unsigned int frames;                    //frames compared
+    unsigned int unchanged_frames;          //frames identical to the one before
+    unsigned int rows;
+    unsigned int unchanged_rows;
+} ppu_change_stats_t;
+
+//what the debug viewers show, copied out of the PPU at the end of a frame
+typedef struct {
+    uint8_t chr[0x2000];                    //both pattern tables with the CHR banks currently mapped
+    uint8_t nametables[4][0x400];           //logical nametables 0-3 after mirroring, attribute tables included
+    uint8_t palette[0x20];                  //palette RAM
+    uint32_t colors[0x20];                  //palette RAM as ARGB8888 with the current grayscale and emphasis
+    uint8_t oam[0x100];
+    int scroll_x;                           //top left of the screen in the 512x480 space of the 4 nametables
+    int scroll_y;
+    int background_table;                   //pattern table 0-1 the background is drawn from
+    int sprite_table;                       //same for 8x8 sprites, 8x16 sprites pick theirs with bit 0 of the tile
+    bool sprites_8x16;
+} ppu_debug_t;
+
+typedef enum {
+    PPU_INVALIDATION_NAMETABLE,             //the tile's nametable byte was written
+    PPU_INVALIDATION_ATTRIBUTE,             //the attribute byte covering the tile was written
+    PPU_INVALIDATION_CHR,                   //the tile's pattern was written or its CHR bank switched
+    PPU_INVALIDATION_ALL                    //mirroring, pattern table or reset, every tile of every nametable
+} ppu_invalidation_reason_t;
+
+typedef struct {
+    ppu_invalidation_reason_t reason;
+    uint8_t nametable;                      //logical nametable 0-3
+    uint8_t x;                              //tile column 0-31
+    uint8_t y;                              //tile row 0-31, 30 and 31 are the attribute table
+} ppu_invalidation_t;
+
 void ppu_init();
 void ppu_free();
 
 void ppu_reset();
 
-void ppu_set_texture(SDL_Texture *texture);
+//index is 0 or 1, without a framebuffer 1 every frame goes to 0 and the host swaps it from the frame ready callback
+void ppu_set_framebuffer(int index, void *framebuffer, int pitch);
+void ppu_set_frame_ready(ppu_frame_ready_t callback, void *data);
+void ppu_set_video(bool enabled);
+void ppu_set_format(ppu_format_t format);
+bool ppu_set_observation(const ppu_observation_t *observation);
+unsigned int ppu_get_observations();
+
+//compares every frame with the one before. a frame that didn't change isn't converted, doesn't swap framebuffers and
+//reaches the frame ready callback with a NULL framebuffer, the host already has it
+bool ppu_set_change_detection(bool enabled);
+
+//bit y % 32 of [y / 32] is set if row y of the last frame differs from the frame before, every bit is set without
+//change detection
+const uint32_t * ppu_get_dirty_rows();
+void ppu_get_change_stats(ppu_change_stats_t *stats);
+
+//PPU_FORMAT_INDEXED pixels of the frame that was just completed in framebuffer index, whatever the format, only valid
+//until the frame ready callback returns
+const uint16_t * ppu_get_indices(int index, int *pitch);
+
+//a 256 pixel row of PPU_FORMAT_INDEXED pixels to ARGB8888
+void ppu_convert_indices(uint32_t *out, const uint16_t *in);
+
+void ppu_get_debug(ppu_debug_t *debug);
+
+void ppu_set_chr_page(int page, uint8_t *data);
 void ppu_set_mirroring(ppu_mirroring_t mirroring);
 
+//records which background tiles the layer cache decodes again and why, for debugging it. reading hands back and clears
+//what was recorded, dropped counts the entries that didn't fit in the log or in max
+void ppu_set_invalidation_log(bool enabled);
+int ppu_read_invalidation_log(ppu_invalidation_t *entries, int max, unsigned int *dropped);
+
 uint8_t ppu_read_register(uint16_t index);
 void ppu_write_register(uint16_t index, uint8_t value);
+void ppu_write_oam_dma(const uint8_t *data);
 
-void ppu_cycle();
\ No newline at end of file
+void ppu_cycle();
+void ppu_run(int dots);
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "log.h"
+#include "cartridge.h"
+#include "cpu.h"
+#include "ppu.h"
+#include "ppu_test.h"
+
+#define MODULE "PPUT"
+
+#define PPU_TEST_RING_FRAMES 4
+
+typedef struct {
+    ppu_observation_t observation;
+    uint8_t *ring;
+    uint8_t plane[256 * 240];               //luminance or palette index of every pixel of the frame
+    uint8_t expected[256 * 240];
+    uint32_t argb[256];
+    int frame;
+    bool match;
+} ppu_test_t;
+
+static ppu_test_t ppu_test;
+
+//the sizes and filters hosts ask for, a full size one has to be the frame itself
+static const ppu_observation_t observations[] = {
+    {84, 84, PPU_OBSERVATION_LUMA, PPU_FILTER_BOX, NULL, PPU_TEST_RING_FRAMES},
+    {84, 84, PPU_OBSERVATION_LUMA, PPU_FILTER_NEAREST, NULL, PPU_TEST_RING_FRAMES},
+    {128, 120, PPU_OBSERVATION_INDEXED, PPU_FILTER_NEAREST, NULL, PPU_TEST_RING_FRAMES},
+    {256, 240, PPU_OBSERVATION_LUMA, PPU_FILTER_BOX, NULL, PPU_TEST_RING_FRAMES}
+};
+
+void
+ppu_test_init() {
+    memset(&ppu_test, 0, sizeof(ppu_test));
+}
+
+void
+ppu_test_free() {
+    free(ppu_test.ring);
+}
+
+//the frame the slow way, luminance from the ARGB colors with the same weights the PPU uses
+static void
+ppu_test_build_plane(const uint16_t *indices, int pitch) {
+    const uint16_t *in;
+    uint8_t *out;
+    uint32_t argb;
+    int x, y;
+
+    for (y = 0; y < 240; y++) {
+        in = (const uint16_t *)((const uint8_t *)indices + y * pitch);
+        out = ppu_test.plane + y * 256;
+
+        if (ppu_test.observation.format == PPU_OBSERVATION_INDEXED) {
+            for (x = 0; x < 256; x++) {
+                out[x] = in[x] & 0x3F;
+            }
+            continue;
+        }
+
+        ppu_convert_indices(ppu_test.argb, in);
+        for (x = 0; x < 256; x++) {
+            argb = ppu_test.argb[x];
+            out[x] = (((argb >> 16) & 0xFF) * 77 + ((argb >> 8) & 0xFF) * 150 + (argb & 0xFF) * 29) >> 8;
+        }
+    }
+}
+
+//downscales the frame pixel by pixel, a nearest sample is the source pixel under the observation pixel's center
+static void
+ppu_test_expect(const uint16_t *indices, int pitch) {
+    const ppu_observation_t *observation = &ppu_test.observation;
+    unsigned int sum;
+    int x, y, sx, sy, x0, x1, y0, y1;
+
+    ppu_test_build_plane(indices, pitch);
+
+    for (y = 0; y < observation->height; y++) {
+        for (x = 0; x < observation->width; x++) {
+            if (observation->filter == PPU_FILTER_BOX && observation->format == PPU_OBSERVATION_LUMA) {
+                x0 = x * 256 / observation->width;
+                x1 = (x + 1) * 256 / observation->width;
+                y0 = y * 240 / observation->height;
+                y1 = (y + 1) * 240 / observation->height;
+
+                sum = 0;
+                for (sy = y0; sy < y1; sy++) {
+                    for (sx = x0; sx < x1; sx++) {
+                        sum += ppu_test.plane[sy * 256 + sx];
+                    }
+                }
+                ppu_test.expected[y * observation->width + x] = sum / ((x1 - x0) * (y1 - y0));
+            }
+            else {
+                sy = (y * 2 + 1) * 240 / (observation->height * 2);
+                sx = (x * 2 + 1) * 256 / (observation->width * 2);
+                ppu_test.expected[y * observation->width + x] = ppu_test.plane[sy * 256 + sx];
+            }
+        }
+    }
+}
+
+static void
+ppu_test_frame_ready(int index, void *framebuffer, void *data) {
+    const ppu_observation_t *observation = &ppu_test.observation;
+    const uint16_t *indices;
+    const uint8_t *out;
+    int pitch, size;
+
+    if (!ppu_test.match) {
+        return;
+    }
+
+    //the observation of this frame is the last one written to the ring
+    size = observation->width * observation->height;
+    out = ppu_test.ring + ((ppu_get_observations() - 1) % observation->frames) * size;
+
+    indices = ppu_get_indices(index, &pitch);
+    ppu_test_expect(indices, pitch);
+
+    if (memcmp(out, ppu_test.expected, size) != 0) {
+        log_err(MODULE, "%dx%d %s observation of frame %d doesn't match the frame", observation->width, observation->height,
+                observation->format == PPU_OBSERVATION_INDEXED ? "indexed" : observation->filter == PPU_FILTER_BOX ? "box filtered" : "nearest",
+                ppu_test.frame);
+        ppu_test.match = false;
+    }
+
+    ppu_test.frame++;
+}
+
+bool
+ppu_test_observations(const char *path, int frames) {
+    bool success = true;
+    int i, j;
+
+    ppu_test.ring = realloc(ppu_test.ring, 256 * 240 * PPU_TEST_RING_FRAMES);
+    if (ppu_test.ring == NULL) {
+        log_err(MODULE, "Out of memory");
+        return false;
+    }
+
+    for (i = 0; success && i < (int)(sizeof(observations) / sizeof(observations[0])); i++) {
+        ppu_test.observation = observations[i];
+        ppu_test.observation.ring = ppu_test.ring;
+        ppu_test.frame = 0;
+        ppu_test.match = true;
+
+        if (!cartridge_load(path, CARTRIDGE_LOAD_NO_SAVE)) {
+            return false;
+        }
+
+        cpu_power();
+        ppu_reset();
+        ppu_set_observation(&ppu_test.observation);
+        ppu_set_frame_ready(ppu_test_frame_ready, NULL);
+
+        for (j = 0; j < frames; j++) {
+            cpu_run_frame();
+        }
+
+        success = ppu_test.match && ppu_get_observations() > 0;
+
+        ppu_set_frame_ready(NULL, NULL);
+        ppu_set_observation(NULL);
+        cartridge_unload();
+    }
+
+    if (success) {
+        log_info(MODULE, "%s: %d frames of every observation match", path, frames);
+    }
+
+    return success;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdbool.h>
+
+void ppu_test_init();
+void ppu_test_free();
+
+//runs a ROM for frames with every kind of observation, checking each one against the frame it was taken from
+bool ppu_test_observations(const char *path, int frames);
\ No newline at end of file
@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define STREAM_SSE2
+#endif
+#if !defined(_WIN32)
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+#endif
+#include "log.h"
+#include "string.h"
+#include "stream.h"
+
+#define MODULE "Stream"
+
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+# define MSG_NOSIGNAL 0
+#endif
+
+typedef struct {
+    int listener;
+    int client;
+    char path[108];
+    uint16_t previous[256 * 240];           //the frame the client has
+    uint8_t packet[STREAM_PACKET_MAX];
+    unsigned int frame;
+    bool keyframe;                          //the client needs every tile, it just connected or missed a packet
+    stream_stats_t stats;
+} stream_t;
+
+static stream_t stream;
+
+void
+stream_init() {
+    memset(&stream, 0, sizeof(stream));
+    stream.listener = -1;
+    stream.client = -1;
+}
+
+void
+stream_free() {
+    stream_close();
+}
+
+static void
+stream_put16(uint8_t *out, unsigned int value) {
+    out[0] = value;
+    out[1] = value >> 8;
+}
+
+static unsigned int
+stream_get16(const uint8_t *in) {
+    return in[0] | (in[1] << 8);
+}
+
+static const uint16_t *
+stream_row(const uint16_t *pixels, int pitch, int y) {
+    return (const uint16_t *)((const uint8_t *)pixels + y * pitch);
+}
+
+//whether any of the 8 rows of a tile differ, a tile row is exactly one SSE2 register
+static bool
+stream_tile_changed(const uint16_t *pixels, int pitch, const uint16_t *previous) {
+    int y;
+#if defined(STREAM_SSE2)
+    __m128i same;
+
+    same = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)pixels), _mm_loadu_si128((const __m128i *)previous));
+    for (y = 1; y < 8; y++) {
+        same = _mm_and_si128(same, _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)stream_row(pixels, pitch, y)),
+                                                   _mm_loadu_si128((const __m128i *)(previous + y * 256))));
+    }
+
+    return _mm_movemask_epi8(same) != 0xFFFF;
+#else
+    for (y = 0; y < 8; y++) {
+        if (memcmp(stream_row(pixels, pitch, y), previous + y * 256, 8 * sizeof(uint16_t)) != 0) {
+            return true;
+        }
+    }
+
+    return false;
+#endif
+}
+
+size_t
+stream_encode(uint8_t *out, unsigned int frame, const uint16_t *pixels, int pitch, uint16_t *previous, const uint32_t *dirty_rows, bool keyframe) {
+    const uint16_t *in;
+    uint16_t *old, tile[64];
+    uint64_t now;
+    uint8_t *p;
+    int tx, ty, y, i, run, tiles;
+
+    now = SDL_GetPerformanceCounter();
+    for (i = 0; i < 4; i++) {
+        out[i] = frame >> (i * 8);
+    }
+    for (i = 0; i < 8; i++) {
+        out[4 + i] = now >> (i * 8);
+    }
+
+    p = out + STREAM_HEADER_SIZE;
+    tiles = 0;
+
+    for (ty = 0; ty < 30; ty++) {
+        //none of the tile row's 8 rows changed since the last frame
+        if (!keyframe && dirty_rows != NULL && ((dirty_rows[ty / 4] >> ((ty % 4) * 8)) & 0xFF) == 0) {
+            continue;
+        }
+
+        for (tx = 0; tx < 32; tx++) {
+            in = stream_row(pixels, pitch, ty * 8) + tx * 8;
+            old = previous + ty * 8 * 256 + tx * 8;
+
+            if (!keyframe && !stream_tile_changed(in, pitch, old)) {
+                continue;
+            }
+
+            for (y = 0; y < 8; y++) {
+                memcpy(tile + y * 8, stream_row(in, pitch, y), 8 * sizeof(uint16_t));
+                memcpy(old + y * 256, tile + y * 8, 8 * sizeof(uint16_t));
+            }
+
+            stream_put16(p, ty * 32 + tx);
+            p += 2;
+
+            for (i = 0; i < 64; i += run) {
+                for (run = 1; i + run < 64 && tile[i + run] == tile[i]; run++);
+
+                p[0] = (run - 1) | ((tile[i] >> 8) & 0x01) << 6;
+                p[1] = tile[i];
+                p += 2;
+            }
+
+            tiles++;
+        }
+    }
+
+    stream_put16(out + 12, tiles);
+
+    return p - out;
+}
+
+bool
+stream_decode(uint16_t *pixels, const uint8_t *packet, size_t size) {
+    const uint8_t *p, *end;
+    uint16_t *out, value;
+    unsigned int index;
+    int tiles, i, run;
+
+    if (size < STREAM_HEADER_SIZE) {
+        return false;
+    }
+
+    p = packet + STREAM_HEADER_SIZE;
+    end = packet + size;
+
+    for (tiles = stream_get16(packet + 12); tiles > 0; tiles--) {
+        if (end - p < 2) {
+            return false;
+        }
+
+        index = stream_get16(p);
+        p += 2;
+        if (index >= STREAM_TILES) {
+            return false;
+        }
+
+        out = pixels + (index / 32) * 8 * 256 + (index % 32) * 8;
+        i = 0;
+        while (i < 64) {
+            if (end - p < 2) {
+                return false;
+            }
+
+            run = (p[0] & 0x3F) + 1;
+            value = ((p[0] & 0x40) << 2) | p[1];
+            p += 2;
+            if (i + run > 64) {
+                return false;
+            }
+
+            for (; run > 0; run--, i++) {
+                out[(i / 8) * 256 + i % 8] = value;
+            }
+        }
+    }
+
+    return p == end;
+}
+
+bool
+stream_open(const char *path) {
+#if defined(_WIN32)
+    log_err(MODULE, "Streaming needs Unix sockets");
+    return false;
+#else
+    struct sockaddr_un addr;
+
+    stream_close();
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        log_err(MODULE, "Socket path '%s' is too long", path);
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+    strlcpy(stream.path, path, sizeof(stream.path));
+
+    //packets keep their boundaries, so a frame is either sent whole or not at all
+    stream.listener = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (stream.listener == -1) {
+        log_err(MODULE, "Failed to create socket: %s", strerror(errno));
+        return false;
+    }
+
+    unlink(path);
+    if (bind(stream.listener, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(stream.listener, 1) == -1) {
+        log_err(MODULE, "Failed to listen on '%s': %s", path, strerror(errno));
+        stream_close();
+        return false;
+    }
+
+    //clients are picked up between frames, never waited for
+    fcntl(stream.listener, F_SETFL, fcntl(stream.listener, F_GETFL) | O_NONBLOCK);
+
+    stream.frame = 0;
+    memset(&stream.stats, 0, sizeof(stream.stats));
+
+    return true;
+#endif
+}
+
+void
+stream_close() {
+#if !defined(_WIN32)
+    if (stream.client != -1) {
+        close(stream.client);
+        stream.client = -1;
+    }
+    if (stream.listener != -1) {
+        close(stream.listener);
+        unlink(stream.path);
+        stream.listener = -1;
+    }
+#endif
+}
+
+void
+stream_frame(const uint16_t *pixels, int pitch, const uint32_t *dirty_rows) {
+#if !defined(_WIN32)
+    uint64_t start;
+    size_t size;
+    int fd, buffer;
+
+    if (stream.listener == -1) {
+        return;
+    }
+
+    if (stream.client == -1) {
+        fd = accept(stream.listener, NULL, NULL);
+        if (fd == -1) {
+            return;
+        }
+
+        //room for a few full packets before a slow client starts missing frames
+        buffer = STREAM_PACKET_MAX * 4;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+
+        stream.client = fd;
+        stream.keyframe = true;
+        log_info(MODULE, "Client connected");
+    }
+
+    start = SDL_GetPerformanceCounter();
+    size = stream_encode(stream.packet, stream.frame++, pixels, pitch, stream.previous, dirty_rows, stream.keyframe);
+    stream.stats.encode_us = (SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+
+    if (send(stream.client, stream.packet, size, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)size) {
+        //the client missed this frame, so it gets every tile with the next one
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            stream.keyframe = true;
+            return;
+        }
+
+        log_info(MODULE, "Client disconnected");
+        close(stream.client);
+        stream.client = -1;
+        return;
+    }
+
+    stream.keyframe = false;
+    stream.stats.frame = stream.frame - 1;
+    stream.stats.tiles = stream_get16(stream.packet + 12);
+    stream.stats.bytes = size;
+#endif
+}
+
+void
+stream_get_stats(stream_stats_t *stats) {
+    *stats = stream.stats;
+}
+
+bool
+stream_client_connect(stream_client_t *client, const char *path) {
+#if defined(_WIN32)
+    log_err(MODULE, "Streaming needs Unix sockets");
+    return false;
+#else
+    struct sockaddr_un addr;
+
+    memset(client, 0, sizeof(*client));
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        log_err(MODULE, "Socket path '%s' is too long", path);
+        client->fd = -1;
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+    client->fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (client->fd == -1) {
+        log_err(MODULE, "Failed to create socket: %s", strerror(errno));
+        return false;
+    }
+
+    if (connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        log_err(MODULE, "Failed to connect to '%s': %s", path, strerror(errno));
+        stream_client_close(client);
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+void
+stream_client_close(stream_client_t *client) {
+#if !defined(_WIN32)
+    if (client->fd != -1) {
+        close(client->fd);
+        client->fd = -1;
+    }
+#endif
+}
+
+bool
+stream_client_receive(stream_client_t *client) {
+#if defined(_WIN32)
+    return false;
+#else
+    uint64_t sent;
+    ssize_t size;
+    int i;
+
+    size = recv(client->fd, client->packet, sizeof(client->packet), 0);
+    if (size <= 0) {
+        if (size == -1) {
+            log_err(MODULE, "Failed to receive: %s", strerror(errno));
+        }
+        return false;
+    }
+
+    if (!stream_decode(client->pixels, client->packet, size)) {
+        log_err(MODULE, "Malformed packet of %d bytes", (int)size);
+        return false;
+    }
+
+    sent = 0;
+    for (i = 0; i < 8; i++) {
+        sent |= (uint64_t)client->packet[4 + i] << (i * 8);
+    }
+
+    client->stats.frame = client->packet[0] | (client->packet[1] << 8) | (client->packet[2] << 16) | ((unsigned int)client->packet[3] << 24);
+    client->stats.tiles = stream_get16(client->packet + 12);
+    client->stats.bytes = size;
+    client->stats.latency_us = (SDL_GetPerformanceCounter() - sent) * 1000000.0 / SDL_GetPerformanceFrequency();
+
+    return true;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STREAM_TILES            (32 * 30)   //8x8 tiles of a frame
+#define STREAM_HEADER_SIZE      14
+#define STREAM_PACKET_MAX       (STREAM_HEADER_SIZE + STREAM_TILES * (2 + 64 * 2))
+
+//a frame is sent as the 8x8 tiles that changed since the previous one sent:
+//  uint32 frame, uint64 performance counter when encoding started, uint16 tiles, then for every tile
+//  uint16 tile index (row * 32 + column), then runs covering its 64 pixels in row order, each
+//  uint8 (run - 1) | bit 8 of the pixel << 6, uint8 low 8 bits of the PPU_FORMAT_INDEXED pixel
+//all little endian
+typedef struct {
+    unsigned int frame;
+    int tiles;                              //tiles sent
+    size_t bytes;                           //size of the packet
+    double encode_us;                       //time spent comparing and encoding
+    double latency_us;                      //client only, from the start of encoding to the end of decoding
+} stream_stats_t;
+
+typedef struct {
+    int fd;
+    uint16_t pixels[256 * 240];             //PPU_FORMAT_INDEXED frame built up from the packets
+    uint8_t packet[STREAM_PACKET_MAX];
+    stream_stats_t stats;                   //of the last packet received
+} stream_client_t;
+
+void stream_init();
+void stream_free();
+
+//encodes the tiles of pixels that differ from previous into out, previous becomes pixels. only rows set in dirty_rows,
+//as returned by ppu_get_dirty_rows(), are compared, all of them if it's NULL. keyframe sends every tile
+size_t stream_encode(uint8_t *out, unsigned int frame, const uint16_t *pixels, int pitch, uint16_t *previous, const uint32_t *dirty_rows, bool keyframe);
+bool stream_decode(uint16_t *pixels, const uint8_t *packet, size_t size);
+
+//serves frames to one client at a time over a Unix socket
+bool stream_open(const char *path);
+void stream_close();
+
+//runs on the emulation thread with the frame's PPU_FORMAT_INDEXED pixels, does nothing if no client is connected
+void stream_frame(const uint16_t *pixels, int pitch, const uint32_t *dirty_rows);
+
+//of the last frame sent
+void stream_get_stats(stream_stats_t *stats);
+
+bool stream_client_connect(stream_client_t *client, const char *path);
+void stream_client_close(stream_client_t *client);
+
+//waits for a packet and decodes it into client->pixels
+bool stream_client_receive(stream_client_t *client);
\ No newline at end of file
@@ -0,0 +1,932 @@
+#include <stdlib.h>
+#include <string.h>
+#include "zstd.h"
+
+#define ZSTD_SKIPPABLE_MAGIC    0x184D2A50  //the low 4 bits can be anything
+#define ZSTD_BLOCK_MAX          (128 * 1024)
+#define ZSTD_HUFFMAN_MAX_BITS   11
+#define ZSTD_FSE_MAX_LOG        9
+
+//a state of an FSE table, the next one is base plus the next bits bits of the stream
+typedef struct {
+    uint8_t symbol;
+    uint8_t bits;
+    uint16_t base;
+} zstd_fse_state_t;
+
+typedef struct {
+    zstd_fse_state_t states[1 << ZSTD_FSE_MAX_LOG];
+    int log;                                //-1 until a block describes the table
+} zstd_fse_t;
+
+//indexed by the next max_bits bits of the stream
+typedef struct {
+    uint8_t symbols[1 << ZSTD_HUFFMAN_MAX_BITS];
+    uint8_t bits[1 << ZSTD_HUFFMAN_MAX_BITS];
+    int max_bits;                           //0 until a block describes the tree
+} zstd_huffman_t;
+
+//read from the end back to the start, offset is how many bits are left
+typedef struct {
+    const uint8_t *data;
+    int64_t offset;
+} zstd_stream_t;
+
+typedef struct {
+    size_t header_size;                     //everything before the first block, the whole frame if it's skippable
+    bool skippable;
+    bool has_content_size;
+    uint64_t content_size;
+    bool checksum;
+} zstd_frame_t;
+
+//what's kept from one block to the next in a frame
+typedef struct {
+    uint8_t *out;
+    uint8_t *out_start;                     //of the frame, matches can't reach back past it
+    uint8_t *out_end;
+    uint32_t repeats[3];                    //the last offsets, most recent first
+    zstd_huffman_t huffman;
+    zstd_fse_t literal_lengths;
+    zstd_fse_t offsets;
+    zstd_fse_t match_lengths;
+    size_t literals_size;
+    uint8_t literals[ZSTD_BLOCK_MAX];
+} zstd_t;
+
+static const int16_t zstd_literal_lengths_default[36] = {
+    4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1
+};
+static const int16_t zstd_match_lengths_default[53] = {
+    1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1
+};
+static const int16_t zstd_offsets_default[29] = {
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+static const uint32_t zstd_literal_length_base[36] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024,
+    2048, 4096, 8192, 16384, 32768, 65536
+};
+static const uint8_t zstd_literal_length_bits[36] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+};
+static const uint32_t zstd_match_length_base[53] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33,
+    34, 35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051, 4099, 8195, 16387, 32771, 65539
+};
+static const uint8_t zstd_match_length_bits[53] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3,
+    3, 4, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+};
+
+static int
+zstd_highest_bit(uint32_t value) {
+    int bit = -1;
+
+    for (; value != 0; value >>= 1) {
+        bit++;
+    }
+
+    return bit;
+}
+
+static uint32_t
+zstd_get16(const uint8_t *in) {
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t
+zstd_get32(const uint8_t *in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+//n bits starting bit offset of in, which has size bytes. bits past the end read as 0
+static uint32_t
+zstd_peek_forward(const uint8_t *in, size_t size, size_t offset, int n) {
+    uint64_t value = 0;
+    size_t byte;
+    int i;
+
+    byte = offset / 8;
+    for (i = 0; i < 5 && byte + i < size; i++) {
+        value |= (uint64_t)in[byte + i] << (i * 8);
+    }
+
+    return (uint32_t)((value >> (offset % 8)) & ((1ull << n) - 1));
+}
+
+//the stream starts below the highest set bit of its last byte
+static bool
+zstd_stream_init(zstd_stream_t *stream, const uint8_t *data, size_t size) {
+    if (size == 0 || data[size - 1] == 0) {
+        return false;
+    }
+
+    stream->data = data;
+    stream->offset = (int64_t)size * 8 - 8 + zstd_highest_bit(data[size - 1]);
+
+    return true;
+}
+
+//the next n bits without using them, bits before the start of the stream read as 0
+static uint32_t
+zstd_stream_peek(const zstd_stream_t *stream, int n) {
+    uint64_t value = 0;
+    int64_t start, byte;
+    int missing = 0;
+
+    if (n == 0 || stream->offset <= 0) {
+        return 0;
+    }
+
+    start = stream->offset - n;
+    if (start < 0) {
+        missing = (int)-start;
+        start = 0;
+    }
+
+    for (byte = (stream->offset - 1) / 8; byte >= start / 8; byte--) {
+        value = (value << 8) | stream->data[byte];
+    }
+
+    value = (value >> (start % 8)) & ((1ull << (n - missing)) - 1);
+
+    return (uint32_t)(value << missing);
+}
+
+static uint32_t
+zstd_stream_read(zstd_stream_t *stream, int n) {
+    uint32_t value;
+
+    value = zstd_stream_peek(stream, n);
+    stream->offset -= n;
+
+    return value;
+}
+
+static bool
+zstd_build_fse(zstd_fse_t *fse, const int16_t *counts, int symbols, int log) {
+    uint16_t next[256];
+    int size, high, position, step, symbol, i, state, bits;
+
+    size = 1 << log;
+    high = size;
+
+    //symbols less likely than 1 / size get a state each at the top
+    for (symbol = 0; symbol < symbols; symbol++) {
+        if (counts[symbol] == -1) {
+            fse->states[--high].symbol = symbol;
+            next[symbol] = 1;
+        }
+    }
+
+    position = 0;
+    step = (size >> 1) + (size >> 3) + 3;
+    for (symbol = 0; symbol < symbols; symbol++) {
+        if (counts[symbol] <= 0) {
+            continue;
+        }
+
+        next[symbol] = counts[symbol];
+        for (i = 0; i < counts[symbol]; i++) {
+            fse->states[position].symbol = symbol;
+            do {
+                position = (position + step) & (size - 1);
+            } while (position >= high);
+        }
+    }
+
+    if (position != 0) {
+        return false;
+    }
+
+    for (i = 0; i < size; i++) {
+        state = next[fse->states[i].symbol]++;
+        bits = log - zstd_highest_bit(state);
+        fse->states[i].bits = bits;
+        fse->states[i].base = (state << bits) - size;
+    }
+
+    fse->log = log;
+
+    return true;
+}
+
+//an FSE table description, the probability of each symbol out of 1 << log
+static bool
+zstd_read_fse(zstd_fse_t *fse, const uint8_t *in, size_t size, int max_log, int max_symbol, size_t *used) {
+    int16_t counts[256];
+    uint32_t value, lower_mask, threshold;
+    size_t offset;
+    int log, remaining, symbol, bits, count, repeat, i;
+
+    if (size < 1) {
+        return false;
+    }
+
+    log = (in[0] & 0x0F) + 5;
+    if (log > max_log) {
+        return false;
+    }
+
+    offset = 4;
+    remaining = 1 << log;
+    symbol = 0;
+    while (remaining > 0 && symbol <= max_symbol) {
+        //values that need one bit less are the ones that can't be too big
+        bits = zstd_highest_bit(remaining + 1) + 1;
+        value = zstd_peek_forward(in, size, offset, bits);
+        lower_mask = (1u << (bits - 1)) - 1;
+        threshold = (1u << bits) - 1 - (remaining + 1);
+
+        if ((value & lower_mask) < threshold) {
+            value &= lower_mask;
+            offset += bits - 1;
+        }
+        else if (value > lower_mask) {
+            value -= threshold;
+            offset += bits;
+        }
+        else {
+            offset += bits;
+        }
+
+        count = (int)value - 1;
+        remaining -= count < 0 ? -count : count;
+        counts[symbol++] = count;
+
+        //a run of symbols that never show up
+        if (count == 0) {
+            do {
+                repeat = zstd_peek_forward(in, size, offset, 2);
+                offset += 2;
+                for (i = 0; i < repeat && symbol <= max_symbol; i++) {
+                    counts[symbol++] = 0;
+                }
+            } while (repeat == 3);
+        }
+    }
+
+    if (remaining != 0 || offset > size * 8) {
+        return false;
+    }
+
+    *used = (offset + 7) / 8;
+
+    return zstd_build_fse(fse, counts, symbol, log);
+}
+
+static bool
+zstd_read_table(zstd_fse_t *fse, int mode, const uint8_t *in, size_t size, size_t *used, const int16_t *defaults, int symbols,
+                int log, int max_log) {
+    *used = 0;
+
+    switch (mode) {
+        case 0:
+            return zstd_build_fse(fse, defaults, symbols, log);
+        case 1:
+            //one symbol over and over
+            if (size < 1) {
+                return false;
+            }
+            fse->states[0].symbol = in[0];
+            fse->states[0].bits = 0;
+            fse->states[0].base = 0;
+            fse->log = 0;
+            *used = 1;
+            return true;
+        case 2:
+            return zstd_read_fse(fse, in, size, max_log, 255, used);
+        default:
+            //the one the block before used
+            return fse->log >= 0;
+    }
+}
+
+static bool
+zstd_read_huffman(zstd_huffman_t *huffman, const uint8_t *in, size_t size, size_t *used) {
+    uint8_t weights[256];
+    uint16_t ranks[ZSTD_HUFFMAN_MAX_BITS + 2];
+    zstd_fse_t fse;
+    zstd_stream_t stream;
+    uint32_t states[2], sum, left;
+    size_t description;
+    int count, i, max_bits, bits, length, turn;
+
+    if (size < 1) {
+        return false;
+    }
+
+    count = 0;
+    if (in[0] < 128) {
+        //weights are FSE compressed, two states take turns over one stream
+        if (size < 1 + (size_t)in[0] || !zstd_read_fse(&fse, in + 1, in[0], 6, 255, &description) ||
+            !zstd_stream_init(&stream, in + 1 + description, in[0] - description)) {
+            return false;
+        }
+
+        states[0] = zstd_stream_read(&stream, fse.log);
+        states[1] = zstd_stream_read(&stream, fse.log);
+        for (turn = 0; ; turn ^= 1) {
+            if (count >= 255) {
+                return false;
+            }
+            weights[count++] = fse.states[states[turn]].symbol;
+            states[turn] = fse.states[states[turn]].base + zstd_stream_read(&stream, fse.states[states[turn]].bits);
+
+            //the other state still has a symbol when the stream runs out
+            if (stream.offset < 0) {
+                if (count >= 255) {
+                    return false;
+                }
+                weights[count++] = fse.states[states[turn ^ 1]].symbol;
+                break;
+            }
+        }
+
+        *used = 1 + in[0];
+    }
+    else {
+        count = in[0] - 127;
+        if (size < 1 + (size_t)(count + 1) / 2) {
+            return false;
+        }
+
+        for (i = 0; i < count; i++) {
+            weights[i] = i % 2 == 0 ? in[1 + i / 2] >> 4 : in[1 + i / 2] & 0x0F;
+        }
+
+        *used = 1 + (count + 1) / 2;
+    }
+
+    //the last weight isn't stored, it's what makes the rest add up to a power of 2
+    sum = 0;
+    for (i = 0; i < count; i++) {
+        if (weights[i] > ZSTD_HUFFMAN_MAX_BITS) {
+            return false;
+        }
+        if (weights[i] > 0) {
+            sum += 1 << (weights[i] - 1);
+        }
+    }
+    if (sum == 0) {
+        return false;
+    }
+
+    max_bits = zstd_highest_bit(sum) + 1;
+    left = (1u << max_bits) - sum;
+    if (max_bits > ZSTD_HUFFMAN_MAX_BITS || (left & (left - 1)) != 0) {
+        return false;
+    }
+    weights[count++] = zstd_highest_bit(left) + 1;
+
+    //the longest codes come first, each symbol fills every entry that starts with its code
+    memset(ranks, 0, sizeof(ranks));
+    for (i = 0; i < count; i++) {
+        if (weights[i] > 0) {
+            ranks[max_bits + 1 - weights[i]]++;
+        }
+    }
+
+    length = 0;
+    for (bits = max_bits; bits >= 1; bits--) {
+        i = ranks[bits];
+        ranks[bits] = length;
+        length += i << (max_bits - bits);
+    }
+
+    for (i = 0; i < count; i++) {
+        if (weights[i] == 0) {
+            continue;
+        }
+
+        bits = max_bits + 1 - weights[i];
+        length = 1 << (max_bits - bits);
+        memset(huffman->symbols + ranks[bits], i, length);
+        memset(huffman->bits + ranks[bits], bits, length);
+        ranks[bits] += length;
+    }
+
+    huffman->max_bits = max_bits;
+
+    return true;
+}
+
+static bool
+zstd_decode_huffman(const zstd_huffman_t *huffman, const uint8_t *in, size_t size, uint8_t *out, size_t count) {
+    zstd_stream_t stream;
+    uint32_t index;
+    size_t i;
+
+    if (!zstd_stream_init(&stream, in, size)) {
+        return false;
+    }
+
+    for (i = 0; i < count; i++) {
+        index = zstd_stream_peek(&stream, huffman->max_bits);
+        out[i] = huffman->symbols[index];
+        stream.offset -= huffman->bits[index];
+    }
+
+    return stream.offset == 0;
+}
+
+static bool
+zstd_read_literals(zstd_t *zstd, const uint8_t *in, size_t size, size_t *used) {
+    size_t header, regenerated, compressed, total, tree, sizes[4], segment;
+    const uint8_t *p;
+    int type, format, streams, i;
+
+    if (size < 1) {
+        return false;
+    }
+
+    type = in[0] & 0x03;
+    format = (in[0] >> 2) & 0x03;
+
+    //raw and RLE
+    if (type < 2) {
+        switch (format) {
+            case 1:
+                header = 2;
+                regenerated = size < header ? 0 : (in[0] >> 4) | (in[1] << 4);
+                break;
+            case 3:
+                header = 3;
+                regenerated = size < header ? 0 : (in[0] >> 4) | (in[1] << 4) | ((size_t)in[2] << 12);
+                break;
+            default:
+                header = 1;
+                regenerated = in[0] >> 3;
+                break;
+        }
+
+        if (regenerated > ZSTD_BLOCK_MAX || size < header + (type == 0 ? regenerated : 1)) {
+            return false;
+        }
+
+        if (type == 0) {
+            memcpy(zstd->literals, in + header, regenerated);
+            *used = header + regenerated;
+        }
+        else {
+            memset(zstd->literals, in[header], regenerated);
+            *used = header + 1;
+        }
+
+        zstd->literals_size = regenerated;
+
+        return true;
+    }
+
+    //Huffman coded, with a tree of their own or the last block's
+    streams = format == 0 ? 1 : 4;
+    header = format < 2 ? 3 : format + 2;
+    if (size < header) {
+        return false;
+    }
+
+    switch (format) {
+        case 0:
+        case 1:
+            regenerated = ((in[0] >> 4) | (in[1] << 4)) & 0x3FF;
+            compressed = (in[1] >> 6) | (in[2] << 2);
+            break;
+        case 2:
+            regenerated = ((in[0] >> 4) | (in[1] << 4) | (in[2] << 12)) & 0x3FFF;
+            compressed = (in[2] >> 2) | (in[3] << 6);
+            break;
+        default:
+            regenerated = ((in[0] >> 4) | (in[1] << 4) | ((size_t)in[2] << 12)) & 0x3FFFF;
+            compressed = (in[2] >> 6) | (in[3] << 2) | ((size_t)in[4] << 10);
+            break;
+    }
+
+    if (regenerated > ZSTD_BLOCK_MAX || size < header + compressed) {
+        return false;
+    }
+
+    total = header + compressed;
+    p = in + header;
+    if (type == 2) {
+        if (!zstd_read_huffman(&zstd->huffman, p, compressed, &tree)) {
+            return false;
+        }
+        p += tree;
+        compressed -= tree;
+    }
+    else if (zstd->huffman.max_bits == 0) {
+        return false;
+    }
+
+    if (streams == 1) {
+        if (!zstd_decode_huffman(&zstd->huffman, p, compressed, zstd->literals, regenerated)) {
+            return false;
+        }
+    }
+    else {
+        //a jump table of the first 3 streams' sizes, each regenerates a quarter rounded up
+        if (compressed < 6) {
+            return false;
+        }
+        sizes[0] = zstd_get16(p);
+        sizes[1] = zstd_get16(p + 2);
+        sizes[2] = zstd_get16(p + 4);
+        if (sizes[0] + sizes[1] + sizes[2] > compressed - 6) {
+            return false;
+        }
+        sizes[3] = compressed - 6 - sizes[0] - sizes[1] - sizes[2];
+
+        segment = (regenerated + 3) / 4;
+        if (segment * 3 > regenerated) {
+            return false;
+        }
+
+        p += 6;
+        for (i = 0; i < 4; i++) {
+            if (!zstd_decode_huffman(&zstd->huffman, p, sizes[i], zstd->literals + segment * i, i < 3 ? segment : regenerated - segment * 3)) {
+                return false;
+            }
+            p += sizes[i];
+        }
+    }
+
+    zstd->literals_size = regenerated;
+    *used = total;
+
+    return true;
+}
+
+static bool
+zstd_decode_sequences(zstd_t *zstd, const uint8_t *in, size_t size) {
+    zstd_stream_t stream;
+    const uint8_t *literals;
+    uint32_t literal_length, match_length, offset, value, states[3];
+    size_t p, used, left;
+    int count, i, modes, literal_code, offset_code, match_code, index;
+
+    if (size < 1) {
+        return false;
+    }
+
+    //how many sequences there are takes 1 to 3 bytes
+    if (in[0] < 128) {
+        count = in[0];
+        p = 1;
+    }
+    else if (in[0] < 255) {
+        if (size < 2) {
+            return false;
+        }
+        count = ((in[0] - 128) << 8) + in[1];
+        p = 2;
+    }
+    else {
+        if (size < 3) {
+            return false;
+        }
+        count = in[1] + (in[2] << 8) + 0x7F00;
+        p = 3;
+    }
+
+    literals = zstd->literals;
+    left = zstd->literals_size;
+
+    if (count > 0) {
+        if (size < p + 1 || (in[p] & 0x03) != 0) {
+            return false;
+        }
+        modes = in[p++];
+
+        if (!zstd_read_table(&zstd->literal_lengths, modes >> 6, in + p, size - p, &used, zstd_literal_lengths_default, 36, 6, 9)) {
+            return false;
+        }
+        p += used;
+        if (!zstd_read_table(&zstd->offsets, (modes >> 4) & 0x03, in + p, size - p, &used, zstd_offsets_default, 29, 5, 8)) {
+            return false;
+        }
+        p += used;
+        if (!zstd_read_table(&zstd->match_lengths, (modes >> 2) & 0x03, in + p, size - p, &used, zstd_match_lengths_default, 53, 6, 9)) {
+            return false;
+        }
+        p += used;
+
+        if (!zstd_stream_init(&stream, in + p, size - p)) {
+            return false;
+        }
+
+        states[0] = zstd_stream_read(&stream, zstd->literal_lengths.log);
+        states[1] = zstd_stream_read(&stream, zstd->offsets.log);
+        states[2] = zstd_stream_read(&stream, zstd->match_lengths.log);
+
+        for (i = 0; i < count; i++) {
+            literal_code = zstd->literal_lengths.states[states[0]].symbol;
+            offset_code = zstd->offsets.states[states[1]].symbol;
+            match_code = zstd->match_lengths.states[states[2]].symbol;
+            if (literal_code > 35 || offset_code > 31 || match_code > 52) {
+                return false;
+            }
+
+            //the extra bits of the offset, then the match length, then the literal length
+            value = (1u << offset_code) + zstd_stream_read(&stream, offset_code);
+            match_length = zstd_match_length_base[match_code] + zstd_stream_read(&stream, zstd_match_length_bits[match_code]);
+            literal_length = zstd_literal_length_base[literal_code] + zstd_stream_read(&stream, zstd_literal_length_bits[literal_code]);
+
+            if (value > 3) {
+                offset = value - 3;
+                zstd->repeats[2] = zstd->repeats[1];
+                zstd->repeats[1] = zstd->repeats[0];
+                zstd->repeats[0] = offset;
+            }
+            else {
+                //one of the last offsets, shifted by one when there are no literals
+                index = value - (literal_length == 0 ? 0 : 1);
+                if (index == 0) {
+                    offset = zstd->repeats[0];
+                }
+                else {
+                    offset = index == 3 ? zstd->repeats[0] - 1 : zstd->repeats[index];
+                    if (index > 1) {
+                        zstd->repeats[2] = zstd->repeats[1];
+                    }
+                    zstd->repeats[1] = zstd->repeats[0];
+                    zstd->repeats[0] = offset;
+                }
+            }
+
+            if (i + 1 < count) {
+                states[0] = zstd->literal_lengths.states[states[0]].base + zstd_stream_read(&stream, zstd->literal_lengths.states[states[0]].bits);
+                states[2] = zstd->match_lengths.states[states[2]].base + zstd_stream_read(&stream, zstd->match_lengths.states[states[2]].bits);
+                states[1] = zstd->offsets.states[states[1]].base + zstd_stream_read(&stream, zstd->offsets.states[states[1]].bits);
+            }
+
+            if (literal_length > left || (size_t)(zstd->out_end - zstd->out) < (size_t)literal_length + match_length ||
+                offset == 0 || offset > (size_t)(zstd->out - zstd->out_start) + literal_length) {
+                return false;
+            }
+
+            memcpy(zstd->out, literals, literal_length);
+            zstd->out += literal_length;
+            literals += literal_length;
+            left -= literal_length;
+
+            //a byte at a time, the match can overlap what it's writing
+            for (; match_length > 0; match_length--, zstd->out++) {
+                *zstd->out = *(zstd->out - offset);
+            }
+        }
+
+        if (stream.offset != 0) {
+            return false;
+        }
+    }
+    else if (p < size) {
+        return false;
+    }
+
+    //the literals after the last match
+    if ((size_t)(zstd->out_end - zstd->out) < left) {
+        return false;
+    }
+    memcpy(zstd->out, literals, left);
+    zstd->out += left;
+
+    return true;
+}
+
+static bool
+zstd_read_frame(const uint8_t *in, size_t size, zstd_frame_t *frame) {
+    static const int dictionary_sizes[4] = { 0, 1, 2, 4 };
+    uint32_t magic, dictionary;
+    size_t p;
+    int descriptor, content_bytes, i;
+
+    memset(frame, 0, sizeof(*frame));
+
+    if (size < 8) {
+        return false;
+    }
+
+    magic = zstd_get32(in);
+    if ((magic & 0xFFFFFFF0) == ZSTD_SKIPPABLE_MAGIC) {
+        frame->skippable = true;
+        frame->header_size = 8 + (size_t)zstd_get32(in + 4);
+        return frame->header_size <= size;
+    }
+
+    if (magic != ZSTD_MAGIC) {
+        return false;
+    }
+
+    descriptor = in[4];
+    if (descriptor & 0x08) {
+        return false;
+    }
+    frame->checksum = (descriptor >> 2) & 0x01;
+
+    //a window descriptor unless the frame is a single segment, it's all in out so it doesn't matter how big it is
+    p = (descriptor & 0x20) ? 5 : 6;
+
+    dictionary = 0;
+    for (i = 0; i < dictionary_sizes[descriptor & 0x03]; i++) {
+        dictionary |= (p + i < size ? in[p + i] : 0) << (i * 8);
+    }
+    if (dictionary != 0) {
+        return false;
+    }
+    p += dictionary_sizes[descriptor & 0x03];
+
+    switch (descriptor >> 6) {
+        case 0:
+            content_bytes = (descriptor & 0x20) ? 1 : 0;
+            break;
+        case 1:
+            content_bytes = 2;
+            break;
+        case 2:
+            content_bytes = 4;
+            break;
+        default:
+            content_bytes = 8;
+            break;
+    }
+
+    if (size < p + content_bytes) {
+        return false;
+    }
+
+    frame->has_content_size = content_bytes > 0;
+    for (i = 0; i < content_bytes; i++) {
+        frame->content_size |= (uint64_t)in[p + i] << (i * 8);
+    }
+    if (content_bytes == 2) {
+        frame->content_size += 256;
+    }
+
+    frame->header_size = p + content_bytes;
+
+    return true;
+}
+
+//the size of a frame's blocks and checksum
+static bool
+zstd_skip_blocks(const uint8_t *in, size_t size, const zstd_frame_t *frame, size_t *blocks_size) {
+    uint32_t header;
+    size_t p, block_size;
+
+    p = 0;
+    do {
+        if (size - p < 3) {
+            return false;
+        }
+
+        header = in[p] | (in[p + 1] << 8) | (in[p + 2] << 16);
+        block_size = ((header >> 1) & 0x03) == 1 ? 1 : header >> 3;
+        p += 3;
+        if (size - p < block_size) {
+            return false;
+        }
+        p += block_size;
+    } while (!(header & 0x01));
+
+    if (frame->checksum) {
+        if (size - p < 4) {
+            return false;
+        }
+        p += 4;
+    }
+
+    *blocks_size = p;
+
+    return true;
+}
+
+bool
+zstd_get_size(const uint8_t *data, size_t size, size_t *content_size) {
+    zstd_frame_t frame;
+    size_t p, blocks_size;
+
+    *content_size = 0;
+    for (p = 0; p < size; p += frame.header_size + blocks_size) {
+        if (!zstd_read_frame(data + p, size - p, &frame)) {
+            return false;
+        }
+
+        blocks_size = 0;
+        if (frame.skippable) {
+            continue;
+        }
+
+        if (!frame.has_content_size || !zstd_skip_blocks(data + p + frame.header_size, size - p - frame.header_size, &frame, &blocks_size)) {
+            return false;
+        }
+        *content_size += frame.content_size;
+    }
+
+    return true;
+}
+
+static bool
+zstd_decode_frame(zstd_t *zstd, const uint8_t *in, size_t size, const zstd_frame_t *frame, size_t *used) {
+    uint32_t header;
+    size_t p, block_size, literals;
+    int type;
+
+    zstd->out_start = zstd->out;
+    zstd->repeats[0] = 1;
+    zstd->repeats[1] = 4;
+    zstd->repeats[2] = 8;
+    zstd->huffman.max_bits = 0;
+    zstd->literal_lengths.log = -1;
+    zstd->offsets.log = -1;
+    zstd->match_lengths.log = -1;
+
+    p = 0;
+    do {
+        if (size - p < 3) {
+            return false;
+        }
+
+        header = in[p] | (in[p + 1] << 8) | (in[p + 2] << 16);
+        type = (header >> 1) & 0x03;
+        block_size = header >> 3;
+        p += 3;
+
+        switch (type) {
+            case 0:
+                if (size - p < block_size || (size_t)(zstd->out_end - zstd->out) < block_size) {
+                    return false;
+                }
+                memcpy(zstd->out, in + p, block_size);
+                p += block_size;
+                break;
+            case 1:
+                if (size - p < 1 || (size_t)(zstd->out_end - zstd->out) < block_size) {
+                    return false;
+                }
+                memset(zstd->out, in[p], block_size);
+                p += 1;
+                break;
+            case 2:
+                if (size - p < block_size || block_size > ZSTD_BLOCK_MAX ||
+                    !zstd_read_literals(zstd, in + p, block_size, &literals) ||
+                    !zstd_decode_sequences(zstd, in + p + literals, block_size - literals)) {
+                    return false;
+                }
+                p += block_size;
+                break;
+            default:
+                return false;
+        }
+
+        if (type != 2) {
+            zstd->out += block_size;
+        }
+    } while (!(header & 0x01));
+
+    if (frame->checksum) {
+        if (size - p < 4) {
+            return false;
+        }
+        p += 4;
+    }
+
+    *used = p;
+
+    return !frame->has_content_size || (uint64_t)(zstd->out - zstd->out_start) == frame->content_size;
+}
+
+bool
+zstd_decode(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size) {
+    zstd_frame_t frame;
+    zstd_t *zstd;
+    size_t p, used;
+    bool success = true;
+
+    //the literals of a block are too big for the stack
+    zstd = malloc(sizeof(zstd_t));
+    if (zstd == NULL) {
+        return false;
+    }
+
+    zstd->out = out;
+    zstd->out_end = out + out_size;
+
+    for (p = 0; success && p < in_size; p += used) {
+        success = zstd_read_frame(in + p, in_size - p, &frame);
+        if (success && frame.skippable) {
+            used = frame.header_size;
+        }
+        else if (success) {
+            success = zstd_decode_frame(zstd, in + p + frame.header_size, in_size - p - frame.header_size, &frame, &used);
+            used += frame.header_size;
+        }
+    }
+
+    success = success && zstd->out == zstd->out_end;
+    free(zstd);
+
+    return success;
+}
\ No newline at end of file
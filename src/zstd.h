@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ZSTD_MAGIC              0xFD2FB528
+
+//what the frames in data decode to, false if one of them doesn't say
+bool zstd_get_size(const uint8_t *data, size_t size, size_t *content_size);
+
+//decodes zstd frames into out, which has to be exactly the size zstd_get_size() gives. dictionaries aren't supported
+//and content checksums aren't checked
+bool zstd_decode(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size);
\ No newline at end of file